@@ -1,14 +1,29 @@
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "ai.h"
 #include "game.h"
-#include "list.h"
+#include "dist.h"
+#include "influence.h"
+#include "mcts.h"
+#include "rng.h"
+#include "spatial.h"
+#include "trace.h"
+#include "tool.h"
 
 extern player *players[MAX_PLAYERS];
-static ai _ai[4];
+static ai _ai[MAX_PLAYERS];
 static int num_humans;
 static int num_ais;
+static ai_config _defaults;
+static int _have_defaults;
+static int _influence;  /* holds the influence maps, see _theirs() */
+
+static void _resume_clear(void);
+static void _trace_clear(void);
 
 #ifdef DEBUG_AI
 #define DBG printf
@@ -26,12 +41,6 @@ static const char *_object_names[] = {
 	"INVALID OBJECT"
 };
 
-struct pq {
-	int x;
-	int y;
-	int d;
-	struct pq *next;
-};
 
 /*
  *  0123456789ABCDE
@@ -53,119 +62,81 @@ struct pq {
  *  0123456789ABCDE
  */
 
-#define MIN(a,b) ((a) < (b) ? (a) : (b))
-#define MAX(a,b) ((a) > (b) ? (a) : (b))
-
-static void _debug_path(ai_path*);
-static struct pq* _safe_location(const int, const int, const int);
-
-object* ai_find_closest(const object_type type, const int x, const int y)
-{
-	extern object *objects[WIDTH][HEIGHT];
-	int dia;
-	int dir;
-
-	for(dia = 1; dia < MAX(WIDTH, HEIGHT) - 2; dia++) {
-		int lx, ly, ux, uy;
-		int tx, ty;
-
-		/* prevent oob accesses to the objects array */
-		lx = MAX(x - dia, 0);
-		ly = MAX(y - dia, 0);
-		ux = MIN(x + dia, WIDTH);
-		uy = MIN(y + dia, HEIGHT);
-
-		/*
-		 * #### U
-		 * #  #
-		 * #  #
-		 * #### D
-		 */
-
-		/* #### U */
-		for(tx = lx; tx <= ux; tx++) {
-			object *o;
-
-			o = objects[tx][ly];
-
-			if(o && o->type == type) {
-				return(o);
-			}
-		}
+/* in the order of the AI_STEP_* bits */
+static const int _step_dx[] = { 0, -1, 1, 0 };
+static const int _step_dy[] = { -1, 0, 0, 1 };
 
-		/*
-		 * #  #
-		 * #  #
-		 */
-		for(ty = ly + 1; ty < uy; ty++) {
-			object *o;
-
-			o = objects[lx][ty];
+#define STEP_TICKS 32  /* players move a pixel per tick, and tiles are 32 pixels */
 
-			if(o && o->type == type) {
-				return(o);
-			}
-
-			o = objects[ux][ty];
-
-			if(o && o->type == type) {
-				return(o);
-			}
-		}
+#if (WIDTH - 2) * (HEIGHT - 2) > AI_PATH_MAX
+#error "AI_PATH_MAX is too small for the field"
+#endif
 
-		/* #### D */
-		for(tx = lx; tx < ux; tx++) {
-			object *o;
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
 
-			o = objects[tx][uy];
 
-			if(o && o->type == type) {
-				return(o);
-			}
-		}
-	}
+static inline int _num_steps(const int ax, const int ay, const int bx, const int by)
+{
+	return((ax < bx ? bx - ax : ax - bx) +
+		(ay < by ? by - ay : ay - by));
+}
 
-	return(NULL);
+/*
+ * The closest object of a type, by steps. This used to search rings of
+ * cells, it asks the index now, see spatial.h.
+ */
+object* ai_find_closest(const object_type type, const int x, const int y)
+{
+	return(spatial_nearest(type, x, y));
 }
 
 #define IN_BOUNDS(_a,_b) (((_a) > 0 && (_a) < WIDTH) && \
 						  ((_b) > 0 && (_b) < HEIGHT))
 
-object* ai_find_closest2(const object_type type, const int x, const int y)
+/*
+ * The damage at every cell, the way game_location_dangerous() adds it up,
+ * from the bombs in the index instead of the rows and columns of each
+ * cell that is asked about.
+ */
+static void _bomb_damage(int dmg[WIDTH][HEIGHT])
 {
-	extern object* objects[WIDTH][HEIGHT];
-	int dist;
+	spatial_iter it;
+	object *o;
 
-	for(dist = 1; dist < WIDTH + HEIGHT; dist++) {
-		int a, b;
+	memset(dmg, 0, sizeof(int) * WIDTH * HEIGHT);
+	spatial_begin(&it, OBJECT_TYPE_BOMB, 0, 0, WIDTH - 1, HEIGHT - 1);
 
-		for(a = dist, b = 0; a >= 0; a--, b++) {
-#define CHECK(_a,_b) do {							\
-				if(IN_BOUNDS((_a), (_b))) {			\
-					object *o = objects[_a][_b];	\
-					if(o && o->type == type) {		\
-						return(o);					\
-					}								\
-				}								\
-			} while(0)
+	while((o = spatial_next(&it))) {
+		int bx, by, d;
 
-			CHECK(x + a, y + b);
-			CHECK(x + a, y - b);
-			CHECK(x - a, y + b);
-			CHECK(x - a, y - b);
+		bx = obj_x(o);
+		by = obj_y(o);
+		dmg[bx][by] += bomb_strength_at((bomb*)o, bx, by);
 
-#undef CHECK
+		for(d = 0; d < 4; d++) {
+			int tx, ty, n;
+
+			for(tx = bx + _step_dx[d], ty = by + _step_dy[d];
+				tx >= 0 && ty >= 0 && tx < WIDTH && ty < HEIGHT &&
+					(n = bomb_strength_at((bomb*)o, tx, ty)) > 0;
+				tx += _step_dx[d], ty += _step_dy[d]) {
+				dmg[tx][ty] += n;
+			}
 		}
 	}
 
-	return(NULL);
+	return;
 }
 
 int ai_find_refugee(const int x, const int y, const int tolerance, int *dx, int *dy)
 {
 	extern object* objects[WIDTH][HEIGHT];
+	int dmg[WIDTH][HEIGHT];
 	int dist;
 
+	_bomb_damage(dmg);
+
 	for(dist = 1; dist < WIDTH + HEIGHT; dist++) {
 		int a, b;
 
@@ -175,7 +146,7 @@ int ai_find_refugee(const int x, const int y, const int tolerance, int *dx, int
 					object *o = objects[_a][_b];						\
 					if(!o || (o->passable &&							\
 							  o->type != OBJECT_TYPE_BOMB)) {			\
-						if(!game_location_dangerous((_a), (_b), tolerance)) { \
+						if(dmg[_a][_b] <= tolerance) {					\
 							*dx = (_a);									\
 							*dy = (_b);									\
 							return(0);									\
@@ -196,501 +167,2285 @@ int ai_find_refugee(const int x, const int y, const int tolerance, int *dx, int
 	return(-ENOENT);
 }
 
-int ai_path_length(ai_path *p)
+int ai_path_length(const ai_path *p)
 {
-	int ret_val;
-
-	ret_val = -EINVAL;
+	return(p ? AI_PATH_MAX - p->first : -EINVAL);
+}
 
-	if(p) {
-		ret_val = 0;
+struct dijkstra_state {
+	int x;
+	int y;
+	int d;
+};
 
-		while(p) {
-			p = p->next;
-			ret_val++;
-		}
-	}
+/*
+ * Scratch memory of ai_find_path(), so that searching doesn't allocate.
+ * All steps cost the same, so instead of a sorted list, the queue is an
+ * array of buckets, one per value of g + h, each a stack of cells. The
+ * heuristic is consistent, so g + h never decreases while searching and
+ * the buckets are taken in order; every cell is expanded at most once,
+ * which bounds the number of entries to four per cell.
+ */
+#define SEARCH_BUCKETS (WIDTH * HEIGHT + DIST_INF)
+#define SEARCH_ENTRIES (4 * WIDTH * HEIGHT + 1)
 
-	return(ret_val);
-}
+struct search_entry {
+	int x;
+	int y;
+	int next;  /* next entry in the same bucket, plus one */
+};
 
-void pq_insert(struct pq **head, const int x, const int y, const int d)
+static struct {
+	struct dijkstra_state state[WIDTH][HEIGHT];
+	int bucket[SEARCH_BUCKETS];  /* first entry plus one, 0 if empty */
+	struct search_entry entry[SEARCH_ENTRIES];
+	int entries;
+	int first;  /* no bucket before this one has entries */
+	int last;   /* nor after this one */
+} _search;
+
+static void _search_push(const int x, const int y, int f)
 {
-	struct pq *item;
+	struct search_entry *e;
 
-	item = malloc(sizeof(*item));
-
-	if(item) {
-		struct pq *cur;
+	/* can't happen with a consistent heuristic, but stay correct anyway */
+	if(f < _search.first) {
+		f = _search.first;
+	}
 
-		item->x = x;
-		item->y = y;
-		item->d = d;
+	assert(f < SEARCH_BUCKETS && _search.entries < SEARCH_ENTRIES);
 
-		while(*head && (*head)->d < d) {
-			head = &((*head)->next);
-		}
+	e = &(_search.entry[_search.entries]);
+	e->x = x;
+	e->y = y;
+	e->next = _search.bucket[f];
+	_search.bucket[f] = ++_search.entries;
 
-		item->next = *head;
-		*head = item;
+	if(f > _search.last) {
+		_search.last = f;
 	}
 
 	return;
 }
 
-struct pq* pq_head(struct pq **head)
+static int _search_pop(int *x, int *y, int *f)
 {
-	struct pq *item;
+	struct search_entry *e;
 
-	item = *head;
+	while(_search.first <= _search.last && !_search.bucket[_search.first]) {
+		_search.first++;
+	}
 
-	if(item) {
-		*head = item->next;
+	if(_search.first > _search.last) {
+		return(0);
 	}
 
-	return(item);
+	e = &(_search.entry[_search.bucket[_search.first] - 1]);
+	_search.bucket[_search.first] = e->next;
+
+	*x = e->x;
+	*y = e->y;
+	*f = _search.first;
+
+	return(1);
 }
 
-void pq_free(struct pq **head)
+/* leave the buckets empty for the next search */
+static void _search_clear(void)
 {
-	while(*head) {
-		struct pq *next;
-
-		next = (*head)->next;
-		free(*head);
-		*head = next;
+	if(_search.first <= _search.last) {
+		memset(&(_search.bucket[_search.first]), 0,
+			   (_search.last - _search.first + 1) * sizeof(_search.bucket[0]));
 	}
 
+	_search.entries = 0;
+	_search.first = 0;
+	_search.last = -1;
+
 	return;
 }
 
-struct dijkstra_state {
-	int x;
-	int y;
-	int d;
-};
-
-ai_path* ai_find_path(const int sx, const int sy,
-					  const int dx, const int dy,
-					  const int opts)
+/*
+ * Searches from (sx, sy) to (dx, dy) and returns the last cell of the
+ * path in (ex, ey), which is (dx, dy) or, if opts is set, the cell before
+ * it. The way back is in the search state.
+ */
+static int _astar(const int sx, const int sy,
+				  const int dx, const int dy,
+				  const int opts, int *ex, int *ey)
 {
 	extern object *objects[WIDTH][HEIGHT];
 
-	struct dijkstra_state state[WIDTH][HEIGHT];
-	ai_path *ret_val;
-	ai_path **next;
-	struct pq *q;
-	struct pq *cq;
-	int x, y;
+	struct dijkstra_state (*state)[HEIGHT];
+	int table;
+	int cx, cy, cf;
 
 	if(sx < 0 || sy < 0 || dx < 0 || dy < 0 ||
 	   sx >= WIDTH || sy >= HEIGHT ||
 	   dx >= WIDTH || dy >= HEIGHT) {
-		return(NULL);
+		return(-EINVAL);
 	}
 
-	for(x = 0; x < WIDTH; x++) {
-		for(y = 0; y < HEIGHT; y++) {
-			state[x][y].x = -1;
-			state[x][y].y = -1;
-			state[x][y].d = -1;
-		}
-	}
+	state = _search.state;
+
+	/* all fields -1 */
+	memset(state, 0xff, sizeof(_search.state));
+	_search_clear();
 
-	q = NULL;
-	ret_val = NULL;
-	next = &(ret_val);
+	/*
+	 * A* search. The distances on the static layout are a consistent
+	 * heuristic, so the queue is ordered by g + h and the first time the
+	 * destination is taken from the queue, we have a shortest path. If
+	 * the destination is a wall or pillar, the table doesn't know it and
+	 * we fall back to the Manhattan distance.
+	 */
+	table = dist_static(sx, sy, dx, dy) != DIST_INF;
 
-	pq_insert(&q, sx, sy, 0);
+#define H(_x, _y) (table ? dist_static((_x), (_y), dx, dy) :		\
+				   _num_steps((_x), (_y), dx, dy))
+
+	_search_push(sx, sy, H(sx, sy));
 	state[sx][sy].x = sx;
 	state[sx][sy].y = sy;
 	state[sx][sy].d = 0;
 
 	/* while the queue isn't empty */
-	while((cq = pq_head(&q))) {
-		int tx, ty;
-		int cx, cy, cd;
+	while(_search_pop(&cx, &cy, &cf)) {
+		int cd;
 
-		cx = cq->x;
-		cy = cq->y;
-		cd = cq->d;
+		cd = cf - H(cx, cy);
 
-		if(cx == dx && cy == dy) {
+		if(cd != state[cx][cy].d) {
+			/* a shorter way to this cell was found after it was queued */
 			continue;
 		}
 
+		if(cx == dx && cy == dy) {
+			break;
+		}
+
 #define CHECK_NEIGHBOR(_x, _y) do {									\
 			if(!objects[_x][_y] || objects[_x][_y]->passable ||		\
 			   (opts && ((_x) == dx && (_y) == dy))) {				\
-				if(state[_x][_y].d == -1) {							\
+				int h = H((_x), (_y));								\
+				if(h != DIST_INF && (state[_x][_y].d == -1 ||		\
+									 state[_x][_y].d > cd + 1)) {	\
 					state[_x][_y].x = cx;							\
 					state[_x][_y].y = cy;							\
 					state[_x][_y].d = cd + 1;						\
-					pq_insert(&q, _x, _y, cd + 1);					\
+					_search_push(_x, _y, cd + 1 + h);				\
 				}													\
 			}														\
 		} while(0)
 
-		CHECK_NEIGHBOR(cq->x, cq->y - 1);
-		CHECK_NEIGHBOR(cq->x - 1, cq->y);
-		CHECK_NEIGHBOR(cq->x + 1, cq->y);
-		CHECK_NEIGHBOR(cq->x, cq->y + 1);
+		CHECK_NEIGHBOR(cx, cy - 1);
+		CHECK_NEIGHBOR(cx - 1, cy);
+		CHECK_NEIGHBOR(cx + 1, cy);
+		CHECK_NEIGHBOR(cx, cy + 1);
 
 #undef CHECK_NEIGHBOR
 	}
 
-	if(state[dx][dy].d >= 0) {
-		/* destination is reachable */
-		ai_path *path;
-
-		path = NULL;
-
-		/* omit last step if opts is set */
-		if(!opts) {
-			x = dx;
-			y = dy;
-		} else {
-			x = state[dx][dy].x;
-			y = state[dx][dy].y;
-		}
-
-		do {
-			ai_path *segm;
-			int tx, ty;
-
-			segm = malloc(sizeof(*segm));
-			assert(segm);
-
-			segm->x = x;
-			segm->y = y;
-
-			segm->next = path;
-			path = segm;
-
-			tx = state[x][y].x;
-			ty = state[x][y].y;
-
-			x = tx;
-			y = ty;
-		} while(!(x == sx && y == sy));
-
-#if 0
-		while(path) {
-			ai_path *next;
+#undef H
 
-			next = path->next;
-
-			printf("(%02d,%02d)%s", path->x, path->y, next ? "->" : "\n");
-
-			free(path);
-			path = next;
-		}
-
-		for(y = 0; y < HEIGHT; y++) {
-			for(x = 0; x < WIDTH; x++) {
-				printf("(%02d,%02d) ", state[x][y].x, state[x][y].y);
-			}
-			printf("\n");
-		}
-#endif
-
-		ret_val = path;
+	if(state[dx][dy].d < 0) {
+		return(-ENOENT);
 	}
 
-	pq_free(&q);
+	/* omit last step if opts is set */
+	if(!opts) {
+		*ex = dx;
+		*ey = dy;
+	} else {
+		*ex = state[dx][dy].x;
+		*ey = state[dx][dy].y;
+	}
 
-	return(ret_val);
+	return(0);
 }
 
-int ai_init(int n, int first)
+/*
+ * A shortest path from (sx, sy) to (dx, dy), not counting the start. If
+ * opts is set, the destination may be a cell that can't be entered, and
+ * the path ends next to it. The path is written back to front into the
+ * caller's buffer, so no memory is allocated. Returns the number of steps
+ * or a negative error number.
+ */
+int ai_find_path(const int sx, const int sy,
+				 const int dx, const int dy,
+				 const int opts, ai_path *path)
 {
+	TRACE_SCOPE("ai_find_path");
 	int ret_val;
-	int i;
-
-	ret_val = -EINVAL;
-
-	if(n < 4 && n >= 0) {
-		num_ais = n;
-		num_humans = first;
-
-		for(i = 0; i < n; i++) {
-			_ai[i].self = first + i;
-			_ai[i].have_obj = 0;
-			_ai[i].tolerance = AI_DEFAULT_TOLERANCE;
-		}
+	int x, y;
 
-		ret_val = 0;
+	if((ret_val = _astar(sx, sy, dx, dy, opts, &x, &y)) < 0) {
+		return(ret_val);
 	}
 
-	return(ret_val);
-}
+	path->first = AI_PATH_MAX;
 
-#define PLAYER_MOVING(pid) (players[pid]->dx || players[pid]->dy)
+	while(!(x == sx && y == sy)) {
+		int tx, ty;
 
-static inline int _num_steps(const int ax, const int ay, const int bx, const int by)
-{
-	return((ax < bx ? bx - ax : ax - bx) +
-		(ay < by ? by - ay : ay - by));
-}
+		path->first--;
+		path->x[path->first] = x;
+		path->y[path->first] = y;
 
-static void _debug_path(ai_path *path)
-{
-	int n;
+		tx = _search.state[x][y].x;
+		ty = _search.state[x][y].y;
 
-	for(n = 0; path; n++, path = path->next) {
-		printf("%d: (%02d, %02d)\n", n, path->x, path->y);
+		x = tx;
+		y = ty;
 	}
 
-	return;
+	return(ai_path_length(path));
 }
 
-struct pq* _safe_locations(const int px, const int py, const int risk)
+/*
+ * Only the first step of the path that ai_find_path() would return, or
+ * (sx, sy) if the path has no steps. Returns the number of steps.
+ */
+int ai_find_step(const int sx, const int sy,
+				 const int dx, const int dy,
+				 const int opts, int *nx, int *ny)
 {
-	extern object *objects[WIDTH][HEIGHT];
-	struct pq *ret_val;
+	TRACE_SCOPE("ai_find_path");
+	int ret_val;
 	int x, y;
 
-	ret_val = NULL;
+	if((ret_val = _astar(sx, sy, dx, dy, opts, &x, &y)) < 0) {
+		return(ret_val);
+	}
 
-	for(x = 1; x < WIDTH - 1; x++) {
-		for(y = 1; y < HEIGHT - 1; y++) {
-			object *o;
+	*nx = x;
+	*ny = y;
 
-			o = objects[x][y];
+	while(!(x == sx && y == sy)) {
+		int tx, ty;
 
-			if(o && !o->passable) {
-				continue;
-			}
+		*nx = x;
+		*ny = y;
 
-			if(!game_location_dangerous(x, y, risk)) {
-				pq_insert(&ret_val, x, y, _num_steps(px, py, x, y));
-			}
-		}
+		tx = _search.state[x][y].x;
+		ty = _search.state[x][y].y;
+
+		x = tx;
+		y = ty;
+		ret_val++;
 	}
 
 	return(ret_val);
 }
 
-list* _targets_within(const int self, const int x, const int y, const int steps)
+/*
+ * Distance fields
+ *
+ * A breadth-first search from the tile a player stands on gives the
+ * number of steps to every cell and the way back to the player. One such
+ * field answers all "how far" and "which way" questions about that player
+ * in O(path length), for its own AI as well as for the others. Fields are
+ * computed when they are first asked for and kept until the player is on
+ * another tile or an object was added to or removed from the field.
+ *
+ * Cells that can't be entered get the distance of a step into them from
+ * the closest neighbor that can, but aren't searched any further. That's
+ * how far it is to stand next to them.
+ */
+#define FIELD_CELLS (WIDTH * HEIGHT)
+#define FIELD_CELL(x,y) ((x) * HEIGHT + (y))
+
+struct field {
+	int valid;
+	unsigned long generation;  /* of the world the field was computed for */
+	int x;
+	int y;
+	short dist[FIELD_CELLS];   /* -1 if unreachable */
+	short from[FIELD_CELLS];   /* the previous cell on a shortest path */
+	char open[FIELD_CELLS];    /* the search went through this cell */
+	short order[FIELD_CELLS];  /* reachable cells by distance */
+	int reached;               /* number of cells in order */
+};
+
+static struct field _fields[MAX_PLAYERS];
+
+static void _field_compute(struct field *f, const int sx, const int sy)
 {
+	TRACE_SCOPE("ai_field");
 	extern object *objects[WIDTH][HEIGHT];
-	int lx, ly, ux, uy, tx, ty;
-	list *ret_val;
+	int head;
 
-	ret_val = NULL;
-
-	/*
-	 * The list that is returned contains pointers to the object table
-	 * or player array. This has the advantage that we don't have to deal
-	 * with objects that have been removed from the object table between
-	 * the invocation of this function and the time the list is checked.
-	 * Also, if an object is removed from the object table but another
-	 * object is inserted in the same location, the list will still
-	 * correctly refer to a valid object (since the distance is still the
-	 * same). [This may happen in some rare cases, like a player dying
-	 * and dropping a life while collecting an item, causing the item
-	 * to be replaced with a life.]
-	 */
+	memset(f->dist, 0xff, sizeof(f->dist));
+	memset(f->open, 0, sizeof(f->open));
 
-	lx = MAX(x - steps, 1);
-	ly = MAX(y - steps, 1);
-	ux = MIN(x + steps, WIDTH - 1);
-	uy = MIN(y + steps, WIDTH - 1);
+	f->x = sx;
+	f->y = sy;
+	f->generation = game_generation();
+	f->valid = 1;
 
-	for(tx = lx; tx < ux; tx++) {
-		for(ty = ly; ty < uy; ty++) {
-			object *o;
+	/* cells are searched in the order they are reached */
+	head = 0;
+	f->reached = 0;
 
-			if(_num_steps(x, y, tx, ty) > steps) {
-				continue;
-			}
+	f->dist[FIELD_CELL(sx, sy)] = 0;
+	f->from[FIELD_CELL(sx, sy)] = FIELD_CELL(sx, sy);
+	f->order[f->reached++] = FIELD_CELL(sx, sy);
 
-			o = objects[tx][ty];
+	while(head < f->reached) {
+		int c, cx, cy, cd;
 
-			if(o && (o->type == OBJECT_TYPE_BOULDER ||
-					 o->type == OBJECT_TYPE_ITEM)) {
-				/*
-				 * add a pointer to the pointer to the object
-				 * instead of a pointer to the object, so we
-				 * can forget about mutexes and synchronization
-				 */
-				list_append(&ret_val, &(objects[tx][ty]));
-			}
-		}
-	}
+		c = f->order[head++];
+		cx = c / HEIGHT;
+		cy = c % HEIGHT;
+		cd = f->dist[c];
 
-	for(tx = 0; tx < game_num_players(); tx++) {
-		if(tx == self) {
-			/* don't include oneself in the list of targets */
+		/* the player can always leave the tile it's standing on */
+		if(cd > 0 && objects[cx][cy] && !objects[cx][cy]->passable) {
 			continue;
 		}
 
-		lx = obj_x(players[tx]);
-		ly = obj_x(players[tx]);
+		f->open[c] = 1;
 
-		if(_num_steps(x, y, lx, ly) < steps) {
-			list_append(&ret_val, &(players[tx]));
-		}
+#define VISIT(_x, _y) do {									\
+			int n = FIELD_CELL((_x), (_y));					\
+			if(f->dist[n] < 0) {							\
+				f->dist[n] = cd + 1;						\
+				f->from[n] = c;								\
+				f->order[f->reached++] = n;					\
+			}												\
+		} while(0)
+
+		/* the border is all walls, so neighbors are never out of bounds */
+		VISIT(cx, cy - 1);
+		VISIT(cx - 1, cy);
+		VISIT(cx + 1, cy);
+		VISIT(cx, cy + 1);
+
+#undef VISIT
 	}
 
-	return(ret_val);
+	return;
 }
 
-void _ai_think(ai *me)
+static struct field* _field(const int p)
 {
-	int d;
-	list *targets;
+	struct field *f;
 	int x, y;
-	int risk;
 
-	if(game_player_moving(me->self)) {
-		/* don't waste CPU cycles while we can't do anything anyways */
-		return;
+	if(p < 0 || p >= MAX_PLAYERS ||
+	   game_player_location(p, &x, &y) < 0 ||
+	   x <= 0 || y <= 0 || x >= WIDTH - 1 || y >= HEIGHT - 1) {
+		return(NULL);
 	}
 
-	game_player_location(me->self, &x, &y);
-	risk = (int)((float)players[me->self]->health * me->tolerance);
-
-	/* first of all, make sure we're not in danger */
+	f = &(_fields[p]);
 
-	if(game_location_dangerous(x, y, risk)) {
-		struct pq *locs;
-		int dx, dy;
+	if(!f->valid || f->x != x || f->y != y ||
+	   f->generation != game_generation()) {
+		_field_compute(f, x, y);
+	}
 
-		DBG("Need to flee from (%02d, %02d)\n", x, y);
+	return(f);
+}
 
-		locs = _safe_locations(x, y, risk);
+/*
+ * The cell a path from player p to (x, y) ends in, or -1 if there is no
+ * such path. If adjacent is set, the path ends next to (x, y), which may
+ * then be a cell that can't be entered, like a boulder.
+ */
+static int _field_end(const struct field *f, const int x, const int y, const int adjacent)
+{
+	int c;
 
-		while(locs) {
-			ai_path *path;
+	if(x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) {
+		return(-1);
+	}
 
-			DBG("Found safe location (%02d, %02d)\n", locs->x, locs->y);
+	c = FIELD_CELL(x, y);
 
-			path = ai_find_path(x, y, locs->x, locs->y, 0);
+	if(f->dist[c] < 0) {
+		return(-1);
+	}
 
-			if(path) {
-				DBG("Found a path to (%02d, %02d) via (%02d, %02d)\n",
-					locs->x, locs->y, path->x, path->y);
-				_debug_path(path);
+	if(adjacent) {
+		/* the origin has no cell before it */
+		return(f->dist[c] > 0 ? f->from[c] : -1);
+	}
 
-				game_player_move_abs(me->self, path->x, path->y);
-				ai_path_free(&path);
-				pq_free(&locs);
+	return(f->open[c] ? c : -1);
+}
 
-				return;
-			} else {
-				struct pq *free_me;
+/* number of steps from player p to (x, y), see ai_next_step() */
+int ai_distance(const int p, const int x, const int y, const int adjacent)
+{
+	struct field *f;
+	int c;
 
-				free_me = locs;
-				locs = locs->next;
-				free(free_me);
-			}
-		}
+	if(!(f = _field(p))) {
+		return(-EINVAL);
+	}
 
-		/*
-		 * Couldn't find a place to flee to - continue as usual
-		 * since there's nothing we can do anyways
-		 */
+	if((c = _field_end(f, x, y, adjacent)) < 0) {
+		return(-ENOENT);
 	}
 
-	for(d = 1; d < MAX(WIDTH, HEIGHT); d++) {
-		object **o;
-		int done;
+	return(f->dist[c]);
+}
 
-		done = 0;
-		targets = _targets_within(me->self, x, y, d);
+/*
+ * The first step of a shortest path from player p to (x, y), like the
+ * first element of ai_find_path() from the player's tile. If the path has
+ * no steps, the step is the player's own tile. Returns the length of the
+ * path, or -ENOENT if there is none.
+ */
+int ai_next_step(const int p, const int x, const int y, const int adjacent,
+				 int *nx, int *ny)
+{
+	struct field *f;
+	int c, origin;
+	int ret_val;
 
-		if(!targets) {
-			/* no targets within `d' steps */
-			DBG("No targets within %d steps\n", d);
-			continue;
-		}
+	if(!(f = _field(p))) {
+		return(-EINVAL);
+	}
 
-		DBG("Have targets within %d steps\n", d);
+	if((c = _field_end(f, x, y, adjacent)) < 0) {
+		return(-ENOENT);
+	}
 
-		while((o = (object**)list_pop(&targets)) && !done) {
-			ai_path *path;
+	ret_val = f->dist[c];
+	origin = FIELD_CELL(f->x, f->y);
 
-			if(*o) {
-				object_type ot;
-				int ox, oy;
+	while(c != origin && f->from[c] != origin) {
+		c = f->from[c];
+	}
 
-				ox = (*o)->x;
-				oy = (*o)->y;
-				ot = (*o)->type;
+	*nx = c / HEIGHT;
+	*ny = c % HEIGHT;
 
-				path = ai_find_path(x, y, ox, oy,
-									ot == OBJECT_TYPE_BOULDER ? 1 : 0);
+	return(ret_val);
+}
 
-				if(path) {
-					/* if we have a path, walk it */
+/* marks the cells that shortest paths from the origin to cell c go through */
+static void _field_dag(const struct field *f, const int c, char *seen)
+{
+	short stack[FIELD_CELLS];
+	int n;
 
-					if(!game_location_dangerous(path->x, path->y, risk)) {
-						DBG("Next step in path: (%02d,%02d)\n", path->x, path->y);
+	memset(seen, 0, FIELD_CELLS);
+	seen[c] = 1;
+	stack[0] = c;
+	n = 1;
 
-						if(path->x == x && path->y == y) {
-							/* this happens with boulders */
-							game_player_action(me->self);
-						} else {
-							game_player_move_abs(me->self, path->x, path->y);
-						}
+	/* walk back along every cell that is one step closer to the player */
+	while(n > 0) {
+		int cur, d;
 
-						done = 1;
-					}
+		cur = stack[--n];
+		d = f->dist[cur];
 
-					ai_path_free(&path);
-				} else {
-					/*
-					 * If we don't have a path it may be because there is none, or
-					 * because we have already arrived (this is the case with boulders,
-					 * where the last step in the path is not the location of the target)
-					 */
+		if(d <= 1) {
+			continue;
+		}
 
-					DBG("Target at (%02d,%02d) is a %s\n",
-						ox, oy,	_object_names[ot]);
+#define BACK(_n) do {												\
+			int b = (_n);											\
+			if(!seen[b] && f->open[b] && f->dist[b] == d - 1) {		\
+				seen[b] = 1;										\
+				stack[n++] = b;										\
+			}														\
+		} while(0)
 
-					if(_num_steps(x, y, ox, oy) <= 1) {
-						/* place bomb */
-						DBG("Close enough, place bomb\n");
-						game_player_action(me->self);
-						done = 1;
-					} else {
-						/* there really is no path */
-						DBG("Found a target, but no path to it\n");
-					}
-				}
-			}
-		}
+		BACK(cur - 1);
+		BACK(cur - HEIGHT);
+		BACK(cur + HEIGHT);
+		BACK(cur + 1);
 
-		while(list_pop(&targets));
+#undef BACK
 	}
 
 	return;
 }
 
-void ai_path_free(ai_path **path)
+/* in the order of the AI_STEP_* bits */
+static const int _step_cell[] = { -1, -HEIGHT, HEIGHT, 1 };
+
+/*
+ * All first steps that shortest paths from player p to (x, y) can take,
+ * as a set of AI_STEP_* bits, so that the caller can choose among equally
+ * short ways. The set is empty if the path has no steps. Returns the
+ * length of the paths, or -ENOENT if there are none.
+ */
+int ai_first_steps(const int p, const int x, const int y, const int adjacent,
+				   unsigned *steps)
 {
-	while(*path) {
-		ai_path *free_me;
+	char seen[FIELD_CELLS];
+	struct field *f;
+	int c, i, origin;
 
-		free_me = *path;
-		*path = free_me->next;
-		free(free_me);
+	if(!(f = _field(p))) {
+		return(-EINVAL);
 	}
 
-	return;
-}
+	if((c = _field_end(f, x, y, adjacent)) < 0) {
+		return(-ENOENT);
+	}
 
-void ai_tick(void)
+	*steps = 0;
+	origin = FIELD_CELL(f->x, f->y);
+
+	if(c == origin) {
+		return(0);
+	}
+
+	_field_dag(f, c, seen);
+
+	for(i = 0; i < 4; i++) {
+		if(seen[origin + _step_cell[i]] && f->dist[origin + _step_cell[i]] == 1) {
+			*steps |= 1 << i;
+		}
+	}
+
+	return(f->dist[c]);
+}
+
+/*
+ * A shortest path from the origin of f to cell c that, wherever it has
+ * a choice, takes the first step that isn't dangerous. Returns the
+ * number of steps.
+ */
+static int _field_path(const struct field *f, const int c, const int risk, ai_path *path)
+{
+	char seen[FIELD_CELLS];
+	int cur, i, n;
+
+	_field_dag(f, c, seen);
+
+	n = f->dist[c];
+	cur = FIELD_CELL(f->x, f->y);
+	path->first = AI_PATH_MAX - n;
+
+	for(i = 0; i < n; i++) {
+		int k, next;
+
+		for(next = -1, k = 0; k < 4; k++) {
+			int s;
+
+			s = cur + _step_cell[k];
+
+			if(!seen[s] || f->dist[s] != i + 1) {
+				continue;
+			}
+
+			if(next < 0) {
+				next = s;
+			}
+
+			if(!game_location_dangerous(s / HEIGHT, s % HEIGHT, risk)) {
+				next = s;
+				break;
+			}
+		}
+
+		ai_path_x(path, i) = next / HEIGHT;
+		ai_path_y(path, i) = next % HEIGHT;
+		cur = next;
+	}
+
+	return(n);
+}
+
+int ai_init(int n, int first)
+{
+	int ret_val;
+	int i;
+
+	ret_val = -EINVAL;
+
+	if(n <= MAX_PLAYERS && n >= 0) {
+		ai_cleanup();
+		num_ais = n;
+		num_humans = first;
+
+		_resume_clear();
+		_trace_clear();
+
+		if(n > 0) {
+			influence_acquire();
+			_influence = 1;
+		}
+
+		for(i = 0; i < n; i++) {
+			_ai[i].self = first + i;
+			_ai[i].have_obj = 0;
+			_ai[i].rng = rng_seed(game_rng_state() + first + i);
+
+			if(_have_defaults) {
+				_ai[i].cfg = _defaults;
+			} else {
+				ai_config_default(&(_ai[i].cfg));
+			}
+		}
+
+		ret_val = 0;
+	}
+
+	return(ret_val);
+}
+
+/* free what the AIs of the last match allocated; ai_init() does it too */
+void ai_cleanup(void)
+{
+	int i;
+
+	for(i = 0; i < MAX_PLAYERS; i++) {
+		mcts_free(_ai[i].search);
+		_ai[i].search = NULL;
+	}
+
+	if(_influence) {
+		influence_release();
+		_influence = 0;
+	}
+
+	return;
+}
+
+void ai_config_default(ai_config *cfg)
+{
+	memset(cfg, 0, sizeof(*cfg));
+
+	cfg->tolerance = AI_DEFAULT_TOLERANCE;
+	cfg->radius = MAX(WIDTH, HEIGHT);
+
+	return;
+}
+
+/*
+ * Parse a configuration like "hunter,tolerance=0.3,radius=8" into cfg.
+ * Presets set the priorities, everything else is a key=value pair.
+ * Settings that aren't mentioned are left as they are. "difficulty" is
+ * easy, normal or hard and turns on tree search with that many playouts.
+ */
+int ai_config_parse(ai_config *cfg, const char *str)
+{
+	char buf[256];
+	char *tok;
+	char *ctx;
+
+	if(strlen(str) >= sizeof(buf)) {
+		return(-EINVAL);
+	}
+
+	strcpy(buf, str);
+
+	for(tok = strtok_r(buf, ", \t\r\n", &ctx); tok;
+		tok = strtok_r(NULL, ", \t\r\n", &ctx)) {
+		char *val;
+
+		val = strchr(tok, '=');
+
+		if(!val) {
+			if(!strcmp(tok, "default")) {
+				memset(cfg->priority, 0, sizeof(cfg->priority));
+			} else if(!strcmp(tok, "hunter")) {
+				memset(cfg->priority, 0, sizeof(cfg->priority));
+				cfg->priority[AI_TARGET_PLAYER] = 4;
+			} else if(!strcmp(tok, "gatherer")) {
+				memset(cfg->priority, 0, sizeof(cfg->priority));
+				cfg->priority[AI_TARGET_ITEM] = 4;
+			} else {
+				return(-EINVAL);
+			}
+
+			continue;
+		}
+
+		*val++ = 0;
+
+		if(!strcmp(tok, "tolerance")) {
+			cfg->tolerance = strtof(val, NULL);
+		} else if(!strcmp(tok, "radius")) {
+			cfg->radius = atoi(val);
+		} else if(!strcmp(tok, "boulder")) {
+			cfg->priority[AI_TARGET_BOULDER] = atoi(val);
+		} else if(!strcmp(tok, "item")) {
+			cfg->priority[AI_TARGET_ITEM] = atoi(val);
+		} else if(!strcmp(tok, "player")) {
+			cfg->priority[AI_TARGET_PLAYER] = atoi(val);
+		} else if(!strcmp(tok, "playouts")) {
+			cfg->playouts = atoi(val);
+
+			if(cfg->playouts < 0 || cfg->playouts > MCTS_MAX_PLAYOUTS) {
+				return(-EINVAL);
+			}
+		} else if(!strcmp(tok, "difficulty")) {
+			if(!strcmp(val, "easy")) {
+				cfg->playouts = MCTS_EASY;
+			} else if(!strcmp(val, "normal")) {
+				cfg->playouts = MCTS_NORMAL;
+			} else if(!strcmp(val, "hard")) {
+				cfg->playouts = MCTS_HARD;
+			} else {
+				return(-EINVAL);
+			}
+		} else {
+			return(-EINVAL);
+		}
+	}
+
+	return(0);
+}
+
+/*
+ * Read a configuration file: one or more lines in the format understood
+ * by ai_config_parse(); everything after a '#' is a comment.
+ */
+int ai_config_load(ai_config *cfg, const char *path)
+{
+	char line[256];
+	FILE *fd;
+	int ret_val;
+
+	fd = fopen(path, "r");
+
+	if(!fd) {
+		return(-errno);
+	}
+
+	ret_val = 0;
+
+	while(fgets(line, sizeof(line), fd)) {
+		char *hash;
+
+		if((hash = strchr(line, '#'))) {
+			*hash = 0;
+		}
+
+		if((ret_val = ai_config_parse(cfg, line)) < 0) {
+			break;
+		}
+	}
+
+	fclose(fd);
+
+	return(ret_val);
+}
+
+int ai_config_save(const ai_config *cfg, const char *path)
+{
+	FILE *fd;
+	int ret_val;
+
+	fd = fopen(path, "w");
+
+	if(!fd) {
+		return(-errno);
+	}
+
+	fprintf(fd,
+			"tolerance=%g\n"
+			"radius=%d\n"
+			"boulder=%d\n"
+			"item=%d\n"
+			"player=%d\n"
+			"playouts=%d\n",
+			cfg->tolerance, cfg->radius,
+			cfg->priority[AI_TARGET_BOULDER],
+			cfg->priority[AI_TARGET_ITEM],
+			cfg->priority[AI_TARGET_PLAYER],
+			cfg->playouts);
+
+	ret_val = ferror(fd) ? -EIO : 0;
+
+	if(fclose(fd) != 0 && ret_val == 0) {
+		ret_val = -errno;
+	}
+
+	return(ret_val);
+}
+
+/* configuration that ai_init() gives to all CPU players from now on */
+void ai_set_defaults(const ai_config *cfg)
+{
+	if(cfg) {
+		_defaults = *cfg;
+		_have_defaults = 1;
+	} else {
+		_have_defaults = 0;
+	}
+
+	return;
+}
+
+int ai_configure(const int p, const ai_config *cfg)
+{
+	int i;
+
+	i = p - num_humans;
+
+	if(i < 0 || i >= num_ais) {
+		return(-EINVAL);
+	}
+
+	_ai[i].cfg = *cfg;
+
+	return(0);
+}
+
+/* configuration of player p, if it is a CPU player */
+int ai_get_config(const int p, ai_config *cfg)
+{
+	int i;
+
+	i = p - num_humans;
+
+	if(i < 0 || i >= num_ais) {
+		return(-EINVAL);
+	}
+
+	*cfg = _ai[i].cfg;
+
+	return(0);
+}
+
+/* the reverse of ai_config_parse() */
+int ai_config_format(const ai_config *cfg, char *buf, const size_t size)
+{
+	int n;
+
+	n = snprintf(buf, size, "tolerance=%g,radius=%d,boulder=%d,item=%d,player=%d",
+				 cfg->tolerance, cfg->radius,
+				 cfg->priority[AI_TARGET_BOULDER],
+				 cfg->priority[AI_TARGET_ITEM],
+				 cfg->priority[AI_TARGET_PLAYER]);
+
+	/* rule based configurations look like they always did */
+	if(cfg->playouts > 0 && n >= 0 && (size_t)n < size) {
+		n += snprintf(buf + n, size - n, ",playouts=%d", cfg->playouts);
+	}
+
+	return(n);
+}
+
+#define PLAYER_MOVING(pid) (players[pid]->dx || players[pid]->dy)
+
+/*
+ * Space-time search
+ *
+ * A breadth-first search over (cell, step): in every step the AI either
+ * moves to a neighbor or stays where it is for a step's time. The AI
+ * stands on the tile it moves to for the whole step, so (c, l) can only
+ * be entered if the bombs that go off during step l do no more damage at
+ * c than the AI tolerates. Blasts are traced the way bomb_detonate()
+ * does it, so walls and pillars cover the tiles behind them, and bombs
+ * only count when they go off: a corridor that is clear by the time the
+ * AI gets there is fine, a tile that is about to blow up isn't.
+ *
+ * After the last bomb went off time doesn't matter anymore, and the
+ * search goes on over cells alone. The damage profile is kept until the
+ * field changes or a tick passes, and visited states carry the number of
+ * the search, so nothing needs to be cleared between searches. Every
+ * player has its own, so that AIs can search at the same time.
+ */
+#define ST_LAYERS 32  /* steps; bombs that go off later count for the last */
+#define ST_STATES ((ST_LAYERS + 1) * FIELD_CELLS)
+
+/* states are numbered in a short, and so are the cells of a field */
+#if ST_STATES > SHRT_MAX
+#error "too many space-time states for the field"
+#endif
+
+struct st {
+	int valid;
+	unsigned long generation;          /* of the world the profile is for */
+	unsigned long tick;
+	int layers;                        /* steps until the last bomb went off */
+	int dmg[ST_LAYERS][FIELD_CELLS];   /* by bombs going off during a step */
+	int rest[ST_LAYERS + 1][FIELD_CELLS];  /* from the start of a step on */
+	unsigned stamp;
+	unsigned seen[ST_STATES];          /* == stamp once a state was reached */
+	short from[ST_STATES];
+	short queue[ST_STATES];
+};
+
+static struct st _st[MAX_PLAYERS];
+
+/*
+ * Call f(x, y, dmg, arg) for every tile the blast of bomb b reaches, the
+ * same tiles bomb_detonate() damages players on.
+ */
+static void _blast(bomb *b, void (*f)(const int, const int, const int, void*), void *arg)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	int bx, by;
+	int d;
+
+	bx = obj_x(b);
+	by = obj_y(b);
+
+	f(bx, by, b->strength, arg);
+
+	for(d = 0; d < 4; d++) {
+		int tx, ty;
+
+		for(tx = bx + _step_dx[d], ty = by + _step_dy[d];
+			tx > 0 && ty > 0 && tx < WIDTH && ty < HEIGHT;
+			tx += _step_dx[d], ty += _step_dy[d]) {
+			object *o;
+			int dmg;
+
+			if((dmg = bomb_strength_at(b, tx, ty)) <= 0) {
+				break;
+			}
+
+			f(tx, ty, dmg, arg);
+			o = objects[tx][ty];
+
+			if(o && (o->type == OBJECT_TYPE_WALL || o->type == OBJECT_TYPE_PILLAR)) {
+				break;
+			}
+		}
+	}
+
+	return;
+}
+
+/* the step during which a bomb goes off, counted from now */
+static int _st_layer(const bomb *b)
+{
+	int l;
+
+	/* it goes off in the timeout-th game_logic() from now */
+	l = (b->timeout - 1) / STEP_TICKS;
+
+	return(l < 0 ? 0 : (l >= ST_LAYERS ? ST_LAYERS - 1 : l));
+}
+
+struct st_hit {
+	struct st *st;
+	int layer;
+};
+
+static void _st_add(const int x, const int y, const int dmg, void *arg)
+{
+	struct st_hit *h;
+
+	h = (struct st_hit*)arg;
+	h->st->dmg[h->layer][FIELD_CELL(x, y)] += dmg;
+
+	return;
+}
+
+/* what staying on a tile from a step on costs */
+static void _st_rest(struct st *s)
+{
+	int l, c;
+
+	memset(s->rest[s->layers], 0, sizeof(s->rest[s->layers]));
+
+	for(l = s->layers - 1; l >= 0; l--) {
+		for(c = 0; c < FIELD_CELLS; c++) {
+			s->rest[l][c] = s->rest[l + 1][c] + s->dmg[l][c];
+		}
+	}
+
+	return;
+}
+
+static void _st_profile(struct st *s)
+{
+	TRACE_SCOPE("ai_st_profile");
+	struct st_hit h;
+	spatial_iter it;
+	object *o;
+
+	if(s->valid && s->generation == game_generation() && s->tick == game_ticks()) {
+		return;
+	}
+
+	s->valid = 1;
+	s->generation = game_generation();
+	s->tick = game_ticks();
+	s->layers = 0;
+	h.st = s;
+
+	memset(s->dmg, 0, sizeof(s->dmg));
+
+	spatial_begin(&it, OBJECT_TYPE_BOMB, 1, 1, WIDTH - 2, HEIGHT - 2);
+
+	while((o = spatial_next(&it))) {
+		h.layer = _st_layer((bomb*)o);
+		_blast((bomb*)o, _st_add, &h);
+
+		if(h.layer + 1 > s->layers) {
+			s->layers = h.layer + 1;
+		}
+	}
+
+	_st_rest(s);
+
+	return;
+}
+
+/*
+ * The fastest way for player p from (sx, sy) to cell `goal', or with
+ * goal < 0 to the closest tile, that is safe at every tick and ends where
+ * the player can stay for good. Steps that stay in place are part of the
+ * path, as the same tile twice. Returns the number of steps, or -ENOENT.
+ */
+static int _st_path(const int p, const int sx, const int sy, const int goal,
+					const int risk, ai_path *path)
+{
+	TRACE_SCOPE("ai_st_path");
+	extern object *objects[WIDTH][HEIGHT];
+	struct st *s;
+	int head, tail;
+	int origin;
+
+	s = &(_st[p]);
+	_st_profile(s);
+
+	/* a new stamp; only once in four billion searches do they all wrap */
+	if(++s->stamp == 0) {
+		memset(s->seen, 0, sizeof(s->seen));
+		s->stamp = 1;
+	}
+
+	origin = FIELD_CELL(sx, sy);
+	s->seen[origin] = s->stamp;
+	s->from[origin] = -1;
+	s->queue[0] = origin;
+	head = 0;
+	tail = 1;
+
+	while(head < tail) {
+		int state, c, l, nl, k;
+
+		state = s->queue[head++];
+		c = state % FIELD_CELLS;
+		l = state / FIELD_CELLS;
+
+		/* where the AI ends up, it has to be able to stay */
+		if((goal < 0 || c == goal) && s->rest[l][c] <= risk) {
+			int n, i;
+
+			for(n = 0, i = state; s->from[i] >= 0; i = s->from[i], n++);
+
+			if(n > AI_PATH_MAX) {
+				return(-ENOENT);
+			}
+
+			path->first = AI_PATH_MAX;
+
+			for(i = state; s->from[i] >= 0; i = s->from[i]) {
+				path->first--;
+				path->x[path->first] = (i % FIELD_CELLS) / HEIGHT;
+				path->y[path->first] = (i % FIELD_CELLS) % HEIGHT;
+			}
+
+			return(n);
+		}
+
+		nl = l < s->layers ? l + 1 : l;
+
+		/* staying only makes sense while bombs are ticking */
+		for(k = l < s->layers ? -1 : 0; k < 4; k++) {
+			int n, next;
+
+			n = k < 0 ? c : c + _step_cell[k];
+			next = nl * FIELD_CELLS + n;
+
+			if(s->seen[next] == s->stamp ||
+			   (l < s->layers && s->dmg[l][n] > risk)) {
+				continue;
+			}
+
+			if(k >= 0 && objects[n / HEIGHT][n % HEIGHT] &&
+			   !objects[n / HEIGHT][n % HEIGHT]->passable) {
+				continue;
+			}
+
+			s->seen[next] = s->stamp;
+			s->from[next] = state;
+			s->queue[tail++] = next;
+		}
+	}
+
+	return(-ENOENT);
+}
+
+/*
+ * The fastest path for player p from where it is to (x, y), or with x < 0
+ * to the closest tile it can stay on, that is never hit by more than
+ * `risk' damage at once. Returns the number of steps, or -ENOENT.
+ */
+int ai_safe_path(const int p, const int x, const int y, const int risk, ai_path *path)
+{
+	int sx, sy;
+
+	if(p < 0 || p >= MAX_PLAYERS || game_player_location(p, &sx, &sy) < 0 ||
+	   (x >= 0 && (x <= 0 || y <= 0 || x >= WIDTH - 1 || y >= HEIGHT - 1))) {
+		return(-EINVAL);
+	}
+
+	return(_st_path(p, sx, sy, x < 0 ? -1 : FIELD_CELL(x, y), risk, path));
+}
+
+static void _st_sub(const int x, const int y, const int dmg, void *arg)
+{
+	_st_add(x, y, -dmg, arg);
+
+	return;
+}
+
+/*
+ * Whether player p gets away if it plants a bomb at (x, y), from the
+ * bombs that are there now and its own. Targets further away are checked
+ * against the bombs as they are now, the AI looks again when it's there.
+ */
+static int _st_escape(const int p, const int x, const int y, const int risk)
+{
+	TRACE_SCOPE("ai_st_escape");
+	struct st *s;
+	struct st_hit h;
+	ai_path path;
+	bomb b;
+	int layers;
+	int ret_val;
+
+	s = &(_st[p]);
+	_st_profile(s);
+
+	memset(&b, 0, sizeof(b));
+	b.__parent.type = OBJECT_TYPE_BOMB;
+	b.__parent.x = x;
+	b.__parent.y = y;
+	b.strength = players[p]->bomb_strength;
+	b.timeout = players[p]->bomb_timeout * FPS;
+
+	layers = s->layers;
+	h.st = s;
+	h.layer = _st_layer(&b);
+	_blast(&b, _st_add, &h);
+	s->layers = MAX(layers, h.layer + 1);
+	_st_rest(s);
+
+	ret_val = _st_path(p, x, y, -1, risk, &path) >= 0;
+
+	/* and back to the field as it is */
+	_blast(&b, _st_sub, &h);
+	s->layers = layers;
+	_st_rest(s);
+
+	return(ret_val);
+}
+
+/* damage of bomb b at (x, y), unless a wall or pillar is in between */
+static int _blast_at(bomb *b, const int x, const int y)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	int bx, by, dx, dy, tx, ty;
+
+	bx = obj_x(b);
+	by = obj_y(b);
+
+	if(bx != x && by != y) {
+		return(0);
+	}
+
+	dx = (x > bx) - (x < bx);
+	dy = (y > by) - (y < by);
+
+	for(tx = bx + dx, ty = by + dy; tx != x || ty != y; tx += dx, ty += dy) {
+		object *o;
+
+		o = objects[tx][ty];
+
+		if(o && (o->type == OBJECT_TYPE_WALL || o->type == OBJECT_TYPE_PILLAR)) {
+			return(0);
+		}
+	}
+
+	return(bomb_strength_at(b, x, y));
+}
+
+/*
+ * Damage at (x, y) by the bombs that go off within `ticks', with blasts
+ * stopping at walls and pillars, unlike game_location_dangerous().
+ */
+static int _blast_damage(const int x, const int y, const int ticks)
+{
+	spatial_iter it;
+	object *o;
+	int dmg;
+
+	dmg = 0;
+	spatial_begin(&it, OBJECT_TYPE_BOMB, 1, y, WIDTH - 2, y);
+
+	while((o = spatial_next(&it))) {
+		if(((bomb*)o)->timeout <= ticks) {
+			dmg += _blast_at((bomb*)o, x, y);
+		}
+	}
+
+	spatial_begin(&it, OBJECT_TYPE_BOMB, x, 1, x, HEIGHT - 2);
+
+	while((o = spatial_next(&it))) {
+		if(obj_y(o) != y && ((bomb*)o)->timeout <= ticks) {
+			dmg += _blast_at((bomb*)o, x, y);
+		}
+	}
+
+	return(dmg);
+}
+
+/*
+ * Targets in the order the AI considers them: by the number of steps to
+ * them, minus the priority of their kind. Every kind is a stream in the
+ * order of the distance field, and the next target is taken from the
+ * stream whose next target is closest, so the search ends as soon as the
+ * AI has found something to do. Boulders that another player gets to
+ * first are left out, see _theirs().
+ */
+struct target {
+	object_type type;
+	int x;
+	int y;
+	int dist;
+};
+
+struct target_iter {
+	const struct field *field;
+	const int *prio;
+	int self;
+	int radius;
+	int next[AI_TARGET_NUM];      /* in field->order, or in enemies */
+	int enemies[MAX_PLAYERS];     /* by distance */
+	int nenemies;
+};
+
+static const object_type _target_types[AI_TARGET_NUM] = {
+	OBJECT_TYPE_BOULDER,
+	OBJECT_TYPE_ITEM,
+	OBJECT_TYPE_PLAYER
+};
+
+static void _targets_begin(struct target_iter *it, ai *me)
+{
+	const struct field *f;
+	int i, j;
+
+	f = _field(me->self);
+
+	it->field = f;
+	it->prio = me->cfg.priority;
+	it->self = me->self;
+	it->radius = me->cfg.radius;
+	it->nenemies = 0;
+
+	/* the first cell in the order is our own */
+	it->next[AI_TARGET_BOULDER] = 1;
+	it->next[AI_TARGET_ITEM] = 1;
+	it->next[AI_TARGET_PLAYER] = 0;
+
+	if(!f) {
+		return;
+	}
+
+	for(i = 0; i < game_num_players(); i++) {
+		int d;
+
+		if(i == me->self || !players[i]->alive) {
+			continue;
+		}
+
+		d = f->dist[FIELD_CELL(obj_x(players[i]), obj_y(players[i]))];
+
+		if(d < 0) {
+			continue;
+		}
+
+		for(j = it->nenemies; j > 0; j--) {
+			player *o;
+
+			o = players[it->enemies[j - 1]];
+
+			if(f->dist[FIELD_CELL(obj_x(o), obj_y(o))] <= d) {
+				break;
+			}
+
+			it->enemies[j] = it->enemies[j - 1];
+		}
+
+		it->enemies[j] = i;
+		it->nenemies++;
+	}
+
+	return;
+}
+
+/*
+ * Whether a boulder is left to another player, who gets to it first with
+ * nobody close behind: racing for it would be lost, and the AI had better
+ * clear the boulders on its own side of the field.
+ */
+static int _theirs(const struct target_iter *it, const int c)
+{
+	int owner;
+
+	owner = influence_owner(c / HEIGHT, c % HEIGHT);
+
+	return(owner >= 0 && owner != it->self &&
+		   !influence_contested(c / HEIGHT, c % HEIGHT));
+}
+
+/* the cell of the next target of a kind, or -1 if there are no more */
+static int _targets_peek(struct target_iter *it, const ai_target kind)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	const struct field *f;
+
+	f = it->field;
+
+	if(kind == AI_TARGET_PLAYER) {
+		player *p;
+
+		if(it->next[kind] >= it->nenemies) {
+			return(-1);
+		}
+
+		p = players[it->enemies[it->next[kind]]];
+
+		return(FIELD_CELL(obj_x(p), obj_y(p)));
+	}
+
+	for(; it->next[kind] < f->reached; it->next[kind]++) {
+		object *o;
+		int c;
+
+		c = f->order[it->next[kind]];
+		o = objects[c / HEIGHT][c % HEIGHT];
+
+		if(o && o->type == _target_types[kind] &&
+		   (kind != AI_TARGET_BOULDER || !_theirs(it, c))) {
+			return(c);
+		}
+	}
+
+	return(-1);
+}
+
+static int _targets_next(struct target_iter *it, struct target *t)
+{
+	int kind, best, best_cell, best_steps;
+
+	if(!it->field) {
+		return(0);
+	}
+
+	best = -1;
+	best_cell = -1;
+	best_steps = 0;
+
+	for(kind = 0; kind < AI_TARGET_NUM; kind++) {
+		int c, steps;
+
+		if((c = _targets_peek(it, kind)) < 0) {
+			continue;
+		}
+
+		/* targets with a higher priority count as closer than they are */
+		steps = it->field->dist[c] - it->prio[kind];
+
+		if(best < 0 || steps < best_steps) {
+			best = kind;
+			best_cell = c;
+			best_steps = steps;
+		}
+	}
+
+	if(best < 0 || best_steps >= it->radius) {
+		return(0);
+	}
+
+	it->next[best]++;
+
+	t->type = _target_types[best];
+	t->x = best_cell / HEIGHT;
+	t->y = best_cell % HEIGHT;
+	t->dist = it->field->dist[best_cell];
+
+	return(1);
+}
+
+/*
+ * Time budget
+ *
+ * The AIs that decide something in a tick share a budget of wall time,
+ * split evenly between them.
+ * An AI that runs out of its share stops searching and goes on where it
+ * left off in the next tick, as long as it's still where it was and the
+ * field didn't change: the rules look at the targets they didn't get to
+ * yet, the tree search adds playouts to its tree. The tree search only
+ * carries over for AI_RESUME_TICKS, then the best action so far is taken.
+ * Fleeing always finishes, it's a single search. There is no budget
+ * unless one is set, so that headless matches play out the same on any
+ * machine; the game sets AI_DEFAULT_BUDGET.
+ */
+#define AI_RESUME_TICKS 4
+
+struct resume {
+	int targets;               /* the iterator holds the rest of a plan */
+	int search;                /* the tree search is under way */
+	int hint;                  /* what the rules would do for their objective, -1 if nothing */
+	int x;                     /* where the AI was */
+	int y;
+	unsigned long generation;  /* game_generation() then */
+	unsigned long began;       /* game_ticks() when the tree search began */
+	struct target_iter it;
+};
+
+static struct resume _resume[MAX_PLAYERS];
+static double _budget;
+static double _slice;  /* of the current tick, per AI */
+
+/* seconds the AIs may think per tick, 0 for as long as they like */
+int ai_set_budget(const double seconds)
+{
+	if(seconds < 0) {
+		return(-EINVAL);
+	}
+
+	_budget = seconds;
+
+	return(0);
+}
+
+static void _resume_clear(void)
+{
+	memset(_resume, 0, sizeof(_resume));
+	return;
+}
+
+/* whether the AI's share would be used up after `more' seconds */
+static int _out_of_time(const ai *me, const double more)
+{
+	return(me->deadline > 0 && tool_now() + more >= me->deadline);
+}
+
+/* whether what was left over from an earlier tick still applies */
+static int _resume_valid(const struct resume *r, const int x, const int y)
+{
+	return(r->x == x && r->y == y && r->generation == game_generation());
+}
+
+static void _resume_mark(struct resume *r, const int x, const int y)
+{
+	r->x = x;
+	r->y = y;
+	r->generation = game_generation();
+
+	return;
+}
+
+/*
+ * Decision trace
+ *
+ * Every decision of an AI leaves a note in the AI as it is made: the
+ * damage it saw where it stood, the target it went for, the targets it
+ * passed over, and which way out it took when there was no good choice.
+ * With tracing on, _ai_apply() copies the note and the action into a
+ * ring of the last AI_TRACE_RECORDS of that AI. Taking notes costs a few
+ * stores either way. Given a file, the ring of an AI is dumped there
+ * whenever it kills itself, which is when one would like to know what it
+ * was thinking.
+ */
+static struct {
+	ai_trace_record rec[AI_TRACE_RECORDS];
+	unsigned long n;           /* records ever written */
+	int suicides;              /* of the player when it was last looked at */
+} _trace[MAX_PLAYERS];
+
+static int _trace_on;
+static FILE *_trace_fd;
+
+static const char *_trace_objectives[] = {
+	"kill", "bomb", "item", "hide", "wait"
+};
+
+static const char *_trace_targets[] = {
+	"wall", "pillar", "boulder", "item", "bomb", "player"
+};
+
+static const char *_trace_fallbacks[AI_FALLBACK_NUM] = {
+	"none", "trapped", "idle", "deferred", "no bombs", "hold", "no escape"
+};
+
+static const char *_trace_actions[] = {
+	"none", "move", "plant"
+};
+
+/* record decisions while on, and dump them to fd on suicides if it's set */
+void ai_set_trace(const int on, FILE *fd)
+{
+	_trace_on = on;
+	_trace_fd = fd;
+
+	return;
+}
+
+static void _trace_clear(void)
+{
+	memset(_trace, 0, sizeof(_trace));
+	return;
+}
+
+static void _trace_begin(ai *me, const int x, const int y, const int risk)
+{
+	ai_trace_record *n;
+
+	n = &(me->note);
+	n->tick = game_ticks();
+	n->player = me->self;
+	n->x = x;
+	n->y = y;
+	n->risk = risk;
+	n->damage = -1;
+	n->target = AI_TRACE_NONE;
+	n->fallback = AI_FALLBACK_NONE;
+	n->skipped = 0;
+
+	return;
+}
+
+/* the first way out an AI took is the one that matters */
+static inline void _trace_fallback(ai *me, const ai_fallback f)
+{
+	if(me->note.fallback == AI_FALLBACK_NONE) {
+		me->note.fallback = f;
+	}
+
+	return;
+}
+
+static void _trace_commit(ai *me)
+{
+	ai_trace_record *n;
+	int i;
+
+	if(!_trace_on) {
+		return;
+	}
+
+	n = &(me->note);
+	n->objective = me->have_obj ? me->obj.type : AI_TRACE_NONE;
+	n->tx = me->have_obj ? me->obj.x : -1;
+	n->ty = me->have_obj ? me->obj.y : -1;
+	n->path = me->have_obj ? ai_path_length(&(me->obj.path)) : -1;
+	n->action = me->intent.type;
+	n->ax = me->intent.type == AI_INTENT_MOVE ? me->intent.x : n->x;
+	n->ay = me->intent.type == AI_INTENT_MOVE ? me->intent.y : n->y;
+	n->playouts = MIN(me->intent.playouts, UINT16_MAX);
+	n->flags = (me->intent.planned ? AI_TRACE_PLANNED : 0) |
+		(me->intent.resumed ? AI_TRACE_RESUMED : 0) |
+		(me->cfg.playouts > 0 ? AI_TRACE_TREE : 0);
+
+	i = me - _ai;
+	_trace[i].rec[_trace[i].n++ % AI_TRACE_RECORDS] = *n;
+
+	return;
+}
+
+/*
+ * The last records of player p, at most max of them, oldest first.
+ * Returns how many there were or a negative error number.
+ */
+int ai_trace_get(const int p, ai_trace_record *rec, const int max)
+{
+	unsigned long first;
+	int i, j, n;
+
+	i = p - num_humans;
+
+	if(i < 0 || i >= num_ais || max < 0) {
+		return(-EINVAL);
+	}
+
+	n = (int)MIN(_trace[i].n, (unsigned long)MIN(max, AI_TRACE_RECORDS));
+	first = _trace[i].n - n;
+
+	for(j = 0; j < n; j++) {
+		rec[j] = _trace[i].rec[(first + j) % AI_TRACE_RECORDS];
+	}
+
+	return(n);
+}
+
+int ai_trace_format(const ai_trace_record *r, char *buf, const size_t size)
+{
+	char danger[32];
+	char target[48];
+	char tree[32];
+
+	if(r->damage < 0) {
+		snprintf(danger, sizeof(danger), "-");
+	} else {
+		snprintf(danger, sizeof(danger), "%d/%d", r->damage, r->risk);
+	}
+
+	tree[0] = '\0';
+
+	if(r->flags & AI_TRACE_TREE) {
+		snprintf(tree, sizeof(tree), ", %d playouts", r->playouts);
+	}
+
+	if(r->objective == AI_TRACE_NONE) {
+		snprintf(target, sizeof(target), "none");
+	} else {
+		snprintf(target, sizeof(target), "%s %s (%d,%d) %d steps",
+				 _trace_objectives[r->objective],
+				 r->target == AI_TRACE_NONE ? "-" : _trace_targets[r->target],
+				 r->tx, r->ty, r->path);
+	}
+
+	return(snprintf(buf, size, "%6lu P%d (%d,%d) danger %s%s%s%s, objective %s, "
+					"skipped %d, fallback %s, %s (%d,%d)",
+					(unsigned long)r->tick, r->player, r->x, r->y, danger,
+					r->flags & AI_TRACE_PLANNED ? ", planned" : "",
+					r->flags & AI_TRACE_RESUMED ? ", resumed" : "", tree,
+					target, r->skipped,
+					r->fallback < AI_FALLBACK_NUM ? _trace_fallbacks[r->fallback] : "?",
+					r->action <= AI_INTENT_PLANT ? _trace_actions[r->action] : "?",
+					r->ax, r->ay));
+}
+
+/* the records of player p as text, one per line; returns how many */
+int ai_trace_dump(const int p, FILE *fd)
+{
+	ai_trace_record rec[AI_TRACE_RECORDS];
+	char line[256];
+	int i, n;
+
+	if((n = ai_trace_get(p, rec, AI_TRACE_RECORDS)) < 0) {
+		return(n);
+	}
+
+	for(i = 0; i < n; i++) {
+		ai_trace_format(&(rec[i]), line, sizeof(line));
+		fprintf(fd, "%s\n", line);
+	}
+
+	return(n);
+}
+
+/*
+ * Dump the records of AIs that killed themselves since the last call.
+ * ai_tick() calls it, and game_logic() once more when the match is over.
+ */
+void ai_trace_suicides(void)
 {
 	int i;
 
 	for(i = 0; i < num_ais; i++) {
-		if(!players[num_humans + i]->alive) {
+		player *pl;
+
+		pl = players[_ai[i].self];
+
+		if(pl->suicides == _trace[i].suicides) {
+			continue;
+		}
+
+		_trace[i].suicides = pl->suicides;
+
+		if(_trace_on && _trace_fd) {
+			fprintf(_trace_fd, "P%d killed itself at tick %lu, its last decisions:\n",
+					_ai[i].self, game_ticks());
+			ai_trace_dump(_ai[i].self, _trace_fd);
+			fflush(_trace_fd);
+		}
+	}
+
+	return;
+}
+
+/*
+ * Objectives
+ *
+ * Once the AI has picked a target, it keeps walking the path it planned
+ * instead of searching again at every step. The plan is checked again
+ * only when an object was added to or removed from the field since the
+ * last check; it's dropped if the target is gone, a cell of the path
+ * can't be entered or is in the range of a bomb, or the AI isn't where
+ * the path continues (e.g. after dying). Danger at the AI's own tile and
+ * a timeout also make it plan again. When there was nothing to do, the AI
+ * waits for the field to change, or a step's time for enemies to move.
+ */
+#define OBJECTIVE_TICKS (8 * STEP_TICKS)
+
+static int _persistent = 1;
+static ai_stats _stats;
+
+/* with persistent objectives turned off, the AI plans again at every step */
+void ai_set_persistent(const int on)
+{
+	_persistent = on;
+	return;
+}
+
+void ai_get_stats(ai_stats *stats)
+{
+	*stats = _stats;
+	return;
+}
+
+void ai_reset_stats(void)
+{
+	memset(&_stats, 0, sizeof(_stats));
+	return;
+}
+
+static void _objective_set(ai *me, const objective_type type, const int target,
+						   const int x, const int y)
+{
+	me->obj.type = type;
+	me->obj.target = target;
+	me->obj.x = x;
+	me->obj.y = y;
+	me->obj.checked = game_generation();
+	me->obj.expires = game_ticks() + OBJECTIVE_TICKS;
+	me->obj.hold = 0;
+	me->have_obj = 1;
+
+	return;
+}
+
+/* enemies move without changing the field, so don't wait for too long */
+static void _objective_wait(ai *me, const int x, const int y)
+{
+	me->obj.path.first = AI_PATH_MAX;
+	_objective_set(me, OBJECTIVE_WAIT, -1, x, y);
+	me->obj.expires = game_ticks() + STEP_TICKS;
+
+	return;
+}
+
+static int _objective_valid(ai *me, const int x, const int y, const int risk)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	objective *obj;
+	object *o;
+	int i, n;
+
+	obj = &(me->obj);
+
+	if(!me->have_obj || !_persistent || game_ticks() >= obj->expires) {
+		return(0);
+	}
+
+	n = ai_path_length(&(obj->path));
+
+	/* the path has to continue from here, or stay here for a step */
+	if(n > 0 && _num_steps(x, y, ai_path_x(&(obj->path), 0),
+						   ai_path_y(&(obj->path), 0)) > 1) {
+		return(0);
+	}
+
+	if(obj->type == OBJECTIVE_KILL) {
+		player *p;
+
+		p = game_player_num(obj->target);
+
+		if(!p || !p->alive || obj_x(p) != obj->x || obj_y(p) != obj->y) {
+			return(0);
+		}
+	}
+
+	if(obj->checked == game_generation()) {
+		/* the path was planned around the fuses of exactly these bombs */
+		return(obj->type != OBJECTIVE_HIDE || n > 0);
+	}
+
+	/* something changed, see whether it concerns us */
+	if(obj->type == OBJECTIVE_HIDE || obj->type == OBJECTIVE_WAIT ||
+	   _blast_damage(x, y, INT_MAX) > risk) {
+		return(0);
+	}
+
+	o = objects[obj->x][obj->y];
+
+	if((obj->type == OBJECTIVE_BOMB && (!o || o->type != OBJECT_TYPE_BOULDER)) ||
+	   (obj->type == OBJECTIVE_ITEM && (!o || o->type != OBJECT_TYPE_ITEM))) {
+		return(0);
+	}
+
+	for(i = 0; i < n; i++) {
+		int px, py;
+
+		px = ai_path_x(&(obj->path), i);
+		py = ai_path_y(&(obj->path), i);
+		o = objects[px][py];
+
+		if((o && !o->passable) || _blast_damage(px, py, INT_MAX) > risk) {
+			return(0);
+		}
+	}
+
+	obj->checked = game_generation();
+
+	return(1);
+}
+
+static const objective_type _target_objectives[AI_TARGET_NUM] = {
+	OBJECTIVE_BOMB,
+	OBJECTIVE_ITEM,
+	OBJECTIVE_KILL
+};
+
+/* pick a new objective, returns 0 if there is nothing to do for now */
+static int _plan(ai *me, const int x, const int y, const int risk)
+{
+	TRACE_SCOPE("ai_plan");
+	struct target_iter *it;
+	struct target t;
+	struct resume *r;
+	struct st *s;
+	int danger;
+
+	me->intent.planned = 1;
+	me->have_obj = 0;
+	r = &(_resume[me->self]);
+
+	s = &(_st[me->self]);
+	_st_profile(s);
+	me->note.damage = s->rest[0][FIELD_CELL(x, y)];
+	danger = me->note.damage > risk;
+
+	/* first of all, make sure we're not in danger */
+
+	if(danger) {
+		DBG("Need to flee from (%02d, %02d)\n", x, y);
+
+		if(_st_path(me->self, x, y, -1, risk, &(me->obj.path)) >= 0) {
+			DBG("Fleeing via (%02d, %02d)\n",
+				ai_path_x(&(me->obj.path), 0), ai_path_y(&(me->obj.path), 0));
+			_objective_set(me, OBJECTIVE_HIDE, -1, x, y);
+
+			return(1);
+		}
+
+		/*
+		 * Couldn't find a place to flee to - continue as usual
+		 * since there's nothing we can do anyways
+		 */
+		_trace_fallback(me, AI_FALLBACK_TRAPPED);
+	}
+
+	it = &(r->it);
+
+	if(r->targets && _resume_valid(r, x, y)) {
+		me->intent.resumed = 1;
+	} else {
+		_targets_begin(it, me);
+		_resume_mark(r, x, y);
+	}
+
+	r->targets = 0;
+
+	while(_targets_next(it, &t)) {
+		ai_path *path;
+		int c, i;
+
+		DBG("Target at (%02d,%02d) is a %s, %d steps away\n",
+			t.x, t.y, _object_names[t.type], t.dist);
+
+		if((c = _field_end(it->field, t.x, t.y, t.type == OBJECT_TYPE_BOULDER)) < 0) {
+			continue;
+		}
+
+		path = &(me->obj.path);
+
+		/* next to boulders, on the tile of others */
+		if(c == FIELD_CELL(x, y) && danger) {
+			continue;
+		}
+
+		/* without bombs, any shortest path is safe */
+		if(s->layers == 0) {
+			_field_path(it->field, c, risk, path);
+		} else if(_st_path(me->self, x, y, c, risk, path) < 0) {
+			/* the targets after this one in a later tick */
+			if(_out_of_time(me, 0)) {
+				_trace_fallback(me, AI_FALLBACK_DEFERRED);
+				r->targets = 1;
+				return(0);
+			}
+
+			me->note.skipped += me->note.skipped < UINT8_MAX;
+			continue;
+		}
+
+		/* bombs only where the AI gets away from them */
+		if(t.type != OBJECT_TYPE_ITEM &&
+		   !_st_escape(me->self, c / HEIGHT, c % HEIGHT, risk)) {
+			me->note.skipped += me->note.skipped < UINT8_MAX;
+			continue;
+		}
+
+		me->note.target = t.type;
+
+		for(i = 0; i < AI_TARGET_NUM && _target_types[i] != t.type; i++);
+
+		_objective_set(me, _target_objectives[i],
+					   t.type == OBJECT_TYPE_PLAYER ? it->enemies[it->next[i] - 1] : -1,
+					   t.x, t.y);
+
+		return(1);
+	}
+
+	_trace_fallback(me, AI_FALLBACK_IDLE);
+	_objective_wait(me, x, y);
+
+	return(0);
+}
+
+/* the first thing the AI does for its objective, as a tree search action */
+static mcts_action _objective_action(const ai *me, const int x, const int y)
+{
+	const ai_path *path;
+	int a, dx, dy;
+
+	path = &(me->obj.path);
+
+	if(ai_path_length(path) == 0) {
+		return((me->obj.type == OBJECTIVE_BOMB || me->obj.type == OBJECTIVE_KILL) &&
+			   game_player_can_plant(me->self) ? MCTS_PLANT : MCTS_STAY);
+	}
+
+	for(a = MCTS_UP; a <= MCTS_DOWN; a++) {
+		mcts_action_dir(a, &dx, &dy);
+
+		if(ai_path_x(path, 0) == x + dx && ai_path_y(path, 0) == y + dy) {
+			return(a);
+		}
+	}
+
+	return(MCTS_STAY);
+}
+
+/*
+ * Tree search instead of the rules above. The target the rules would go
+ * for is where the AI heads in its rollouts. Staying is a wait objective,
+ * so the AI decides again early if a bomb threatens it. In danger, the
+ * AI flees the way the rules do: the fuse-aware search finds a way out
+ * whenever there is one, a few random playouts don't. Playouts are
+ * added until there are as many as configured, or the AI's share of the
+ * budget is used up; then the search goes on in the next tick, if it's
+ * still about the same match. Returns 0 if the AI follows its objective
+ * instead.
+ */
+static int _mcts_think(ai *me, const int x, const int y, const int risk)
+{
+	TRACE_SCOPE("ai_mcts");
+	struct resume *r;
+	mcts_action a;
+	double start, round;
+	int dx, dy;
+	int want, n;
+
+	r = &(_resume[me->self]);
+	start = tool_now();
+
+	if(r->search && _resume_valid(r, x, y) &&
+	   game_ticks() < r->began + AI_RESUME_TICKS) {
+		me->intent.resumed = 1;
+	} else {
+		int gx, gy, again;
+
+		/* a search the field changed under still counts as the same decision */
+		again = r->search && game_ticks() < r->began + AI_RESUME_TICKS;
+		r->search = 0;
+
+		if(_objective_valid(me, x, y, risk)) {
+			return(0);
+		}
+
+		if(!me->search && !(me->search = mcts_new())) {
+			return(0);
+		}
+
+		gx = -1;
+		gy = -1;
+		r->hint = -1;
+
+		if(_plan(me, x, y, risk)) {
+			if(me->obj.type == OBJECTIVE_HIDE) {
+				return(0);
+			}
+
+			gx = me->obj.x;
+			gy = me->obj.y;
+			r->hint = _objective_action(me, x, y);
+		}
+
+		/* the objective only counts if the search agrees, see below */
+		me->have_obj = 0;
+		r->targets = 0;
+
+		if(mcts_begin(me->search, me->self, gx, gy, r->hint) < 0) {
+			return(1);
+		}
+
+		r->search = 1;
+		r->began = again ? r->began : game_ticks();
+		_resume_mark(r, x, y);
+	}
+
+	me->intent.planned = 1;
+	want = MIN(me->cfg.playouts, MCTS_MAX_PLAYOUTS);
+	n = mcts_playouts(me->search);
+
+	/* at least one round, so that every tick gets somewhere, more if they fit */
+	do {
+		round = tool_now();
+
+		if(mcts_run(me->search, 1, &(me->rng)) == 0) {
+			break;
+		}
+
+		round = tool_now() - round;
+	} while(mcts_playouts(me->search) < want && !_out_of_time(me, round));
+
+	me->intent.playouts = mcts_playouts(me->search) - n;
+	me->intent.seconds = tool_now() - start;
+
+	if(mcts_playouts(me->search) < want &&
+	   game_ticks() + 1 < r->began + AI_RESUME_TICKS) {
+		_trace_fallback(me, AI_FALLBACK_DEFERRED);
+		return(1);
+	}
+
+	r->search = 0;
+	a = mcts_best(me->search);
+
+	/*
+	 * Agreeing with the rules means following their objective for as long
+	 * as it holds, instead of deciding again at every step: a search at
+	 * every step keeps changing its mind about which boulder to go for.
+	 */
+	if((int)a == r->hint) {
+		me->have_obj = 1;
+		return(0);
+	}
+
+	switch(a) {
+	case MCTS_STAY:
+		_objective_wait(me, x, y);
+		me->obj.expires = game_ticks() + MCTS_STAY_TICKS;
+		break;
+
+	case MCTS_PLANT:
+		/* a few playouts that got away are no proof there is a way out */
+		if(!_st_escape(me->self, x, y, risk)) {
+			_trace_fallback(me, AI_FALLBACK_NO_ESCAPE);
+			_objective_wait(me, x, y);
+			break;
+		}
+
+		me->intent.type = AI_INTENT_PLANT;
+		break;
+
+	default:
+		mcts_action_dir(a, &dx, &dy);
+		me->intent.type = AI_INTENT_MOVE;
+		me->intent.x = x + dx;
+		me->intent.y = y + dy;
+		break;
+	}
+
+	return(1);
+}
+
+/*
+ * Decides what the AI does next. Only reads the world, and writes only
+ * to the AI itself and its distance field, so that all AIs decide on the
+ * same world; what they decided is applied by _ai_apply().
+ */
+static void _ai_think(ai *me)
+{
+	TRACE_SCOPE("ai_think");
+	ai_path *path;
+	int x, y;
+	int risk;
+
+	game_player_location(me->self, &x, &y);
+	risk = (int)((float)players[me->self]->health * me->cfg.tolerance);
+	me->deadline = _slice > 0 ? tool_now() + _slice : 0;
+	_trace_begin(me, x, y, risk);
+
+	if(me->cfg.playouts > 0 && _mcts_think(me, x, y, risk)) {
+		return;
+	}
+
+	if(!_objective_valid(me, x, y, risk) && !_plan(me, x, y, risk)) {
+		return;
+	}
+
+	if(me->obj.type == OBJECTIVE_WAIT || game_ticks() < me->obj.hold) {
+		return;
+	}
+
+	path = &(me->obj.path);
+
+	if(ai_path_length(path) == 0) {
+		/* arrived */
+		me->have_obj = 0;
+
+		if(me->obj.type == OBJECTIVE_BOMB || me->obj.type == OBJECTIVE_KILL) {
+			if(!game_player_can_plant(me->self)) {
+				/* until one of our bombs went off */
+				_trace_fallback(me, AI_FALLBACK_NO_BOMBS);
+				_objective_wait(me, x, y);
+				return;
+			}
+
+			if(!_st_escape(me->self, x, y, risk)) {
+				/* the field changed on the way, look for something else */
+				_trace_fallback(me, AI_FALLBACK_NO_ESCAPE);
+				_objective_wait(me, x, y);
+				return;
+			}
+
+			DBG("At the target, place bomb\n");
+			me->intent.type = AI_INTENT_PLANT;
+		}
+
+		return;
+	}
+
+	if(ai_path_x(path, 0) == x && ai_path_y(path, 0) == y) {
+		/* let a bomb go off first */
+		_trace_fallback(me, AI_FALLBACK_HOLD);
+		me->obj.hold = game_ticks() + STEP_TICKS;
+		path->first++;
+
+		return;
+	}
+
+	DBG("Next step in path: (%02d,%02d)\n", ai_path_x(path, 0), ai_path_y(path, 0));
+	me->intent.type = AI_INTENT_MOVE;
+	me->intent.x = ai_path_x(path, 0);
+	me->intent.y = ai_path_y(path, 0);
+	path->first++;
+
+	return;
+}
+
+static void _ai_apply(ai *me)
+{
+	switch(me->intent.type) {
+	case AI_INTENT_MOVE:
+		game_player_move_abs(me->self, me->intent.x, me->intent.y);
+		break;
+
+	case AI_INTENT_PLANT:
+		game_player_action(me->self);
+		break;
+
+	default:
+		break;
+	}
+
+	_stats.plans += me->intent.planned;
+	_stats.resumes += me->intent.resumed;
+	_stats.playouts += me->intent.playouts;
+	_stats.playout_seconds += me->intent.seconds;
+
+	_trace_commit(me);
+
+	return;
+}
+
+/*
+ * The AIs that decide something in a tick all look at the field as it was
+ * at the start of the tick, and what they decided is applied afterwards in
+ * the order of the AIs. Before, each AI moved or planted right after
+ * deciding, so the AIs after it already reacted to that in the same tick,
+ * and how a match went depended on who came first. _ai_think() must not
+ * change the world, which the assertions check.
+ */
+static void _think_all(ai **batch, const int n)
+{
+	unsigned long generation, ticks;
+	int i;
+
+	generation = game_generation();
+	ticks = game_ticks();
+
+	for(i = 0; i < n; i++) {
+		_ai_think(batch[i]);
+	}
+
+	assert(game_generation() == generation);
+	assert(game_ticks() == ticks);
+	(void)generation;
+	(void)ticks;
+
+	return;
+}
+
+void ai_tick(void)
+{
+	ai *batch[MAX_PLAYERS];
+	double start, elapsed;
+	int i, n;
+
+	ai_trace_suicides();
+
+	for(n = 0, i = 0; i < num_ais; i++) {
+		ai *me;
+
+		me = &(_ai[i]);
+		me->intent.type = AI_INTENT_NONE;
+		me->intent.planned = 0;
+		me->intent.resumed = 0;
+		me->intent.playouts = 0;
+		me->intent.seconds = 0;
+
+		/* don't waste CPU cycles while they can't do anything anyways */
+		if(!players[me->self]->alive || game_player_moving(me->self)) {
+			continue;
+		}
+
+		/* nor while they wait for a bomb, as planned */
+		if(me->have_obj && game_ticks() < me->obj.hold &&
+		   me->obj.checked == game_generation()) {
 			continue;
 		}
 
-		_ai_think(&(_ai[i]));
+		batch[n++] = me;
+	}
+
+	if(n == 0) {
+		return;
+	}
+
+	_slice = _budget / n;
+
+	_stats.thinks += n;
+	start = tool_now();
+	_think_all(batch, n);
+	elapsed = tool_now() - start;
+
+	_stats.think_seconds += elapsed;
+	_stats.worst_seconds = MAX(_stats.worst_seconds, elapsed);
+
+	if(_budget > 0 && elapsed > _budget) {
+		_stats.overruns++;
+	}
+
+	for(i = 0; i < n; i++) {
+		_ai_apply(batch[i]);
 	}
 
 	return;
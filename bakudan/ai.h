@@ -1,45 +1,183 @@
 #ifndef AI_H
 #define AI_H
 
-typedef struct _ai_path ai_path;
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "game.h"
 
-struct _ai_path {
-	ai_path *next;
+#define AI_PATH_MAX 256  /* more steps than there are free cells */
 
-	int x;
-	int y;
-};
+/* filled back to front, step i is at first + i */
+typedef struct {
+	int first;
+	unsigned char x[AI_PATH_MAX];
+	unsigned char y[AI_PATH_MAX];
+} ai_path;
+
+/* the steps of a path keep their coordinates in a byte */
+#if WIDTH > 255 || HEIGHT > 255
+#error "ai_path can't hold the coordinates of a field this large"
+#endif
+
+#define ai_path_x(p,i) ((p)->x[(p)->first + (i)])
+#define ai_path_y(p,i) ((p)->y[(p)->first + (i)])
 
 typedef enum {
 	OBJECTIVE_KILL,
 	OBJECTIVE_BOMB,
 	OBJECTIVE_ITEM,
-	OBJECTIVE_HIDE
+	OBJECTIVE_HIDE,
+	OBJECTIVE_WAIT   /* nothing to do until something changes */
 } objective_type;
 
 typedef struct {
 	objective_type type;
-	ai_path *path;
-	int target;
-	int x;
+	ai_path path;
+	int target;                /* player to kill */
+	int x;                     /* where the target is */
 	int y;
+	unsigned long checked;     /* game_generation() of the last check */
+	unsigned long expires;     /* game_ticks() when to plan again */
+	unsigned long hold;        /* game_ticks() until which to stay put */
 } objective;
 
+/* directions of ai_first_steps() */
+#define AI_STEP_UP    1
+#define AI_STEP_LEFT  2
+#define AI_STEP_RIGHT 4
+#define AI_STEP_DOWN  8
+
+typedef enum {
+	AI_TARGET_BOULDER = 0,
+	AI_TARGET_ITEM,
+	AI_TARGET_PLAYER,
+	AI_TARGET_NUM
+} ai_target;
+
+typedef struct {
+	float tolerance;
+	int radius;                   /* how far to look for targets */
+	int priority[AI_TARGET_NUM];  /* targets appear this many steps closer */
+	int playouts;                 /* per decision; 0 plays by the rules above */
+} ai_config;
+
+/* what an AI decided to do, applied once all AIs have thought */
+typedef enum {
+	AI_INTENT_NONE = 0,
+	AI_INTENT_MOVE,
+	AI_INTENT_PLANT
+} ai_intent_type;
+
+typedef struct {
+	ai_intent_type type;
+	int x;                     /* where to move to */
+	int y;
+	int planned;               /* the decision needed a search */
+	int resumed;               /* which began in an earlier tick */
+	int playouts;              /* of the tree search */
+	double seconds;            /* spent on them */
+} ai_intent;
+
+/* why an AI did something else than going for a target */
+typedef enum {
+	AI_FALLBACK_NONE = 0,
+	AI_FALLBACK_TRAPPED,       /* in danger, with nowhere safe to go */
+	AI_FALLBACK_IDLE,          /* no target it could get to safely */
+	AI_FALLBACK_DEFERRED,      /* out of time, goes on in the next tick */
+	AI_FALLBACK_NO_BOMBS,      /* at the target, without a bomb to plant */
+	AI_FALLBACK_HOLD,          /* lets a bomb go off before moving on */
+	AI_FALLBACK_NO_ESCAPE,     /* wouldn't get away from its own bomb */
+	AI_FALLBACK_NUM
+} ai_fallback;
+
+/* flags of ai_trace_record */
+#define AI_TRACE_PLANNED 1         /* the decision needed a search */
+#define AI_TRACE_RESUMED 2         /* which began in an earlier tick */
+#define AI_TRACE_TREE    4         /* by tree search */
+
+#define AI_TRACE_NONE    0xff      /* no objective, or no target */
+#define AI_TRACE_RECORDS 256       /* kept per AI */
+
+/* a decision of an AI, see ai_set_trace() */
+typedef struct {
+	uint32_t tick;             /* game_ticks() */
+	int16_t x;                 /* where the AI was */
+	int16_t y;
+	int16_t tx;                /* its objective, -1 if none */
+	int16_t ty;
+	int16_t ax;                /* where it moves to */
+	int16_t ay;
+	int16_t path;              /* steps to the objective left, -1 if none */
+	uint16_t playouts;
+	int32_t damage;            /* bombs would do where it was, -1 if not looked at */
+	int32_t risk;              /* the most it accepts */
+	uint8_t player;
+	uint8_t objective;         /* objective_type or AI_TRACE_NONE */
+	uint8_t target;            /* object_type or AI_TRACE_NONE */
+	uint8_t fallback;          /* ai_fallback */
+	uint8_t action;            /* ai_intent_type */
+	uint8_t flags;             /* AI_TRACE_* */
+	uint8_t skipped;           /* targets without a safe path to them */
+} ai_trace_record;
+
 typedef struct {
 	int self;
 	objective obj;
 	int have_obj;
-	float tolerance;
+	ai_config cfg;
+	ai_intent intent;
+	double deadline;           /* when to stop thinking in this tick, 0 for never */
+	struct mcts *search;       /* for tree search, allocated on first use, see ai_cleanup() */
+	uint32_t rng;              /* for tree search */
+	ai_trace_record note;      /* of the decision under way */
 } ai;
 
+typedef struct {
+	unsigned long thinks;  /* decisions of AIs that weren't moving */
+	unsigned long plans;   /* of those, how many had to search */
+	unsigned long resumes; /* searches continued from an earlier tick */
+	unsigned long playouts;
+	double playout_seconds;
+	unsigned long overruns;  /* ticks in which the AIs thought for longer than the budget */
+	double think_seconds;
+	double worst_seconds;    /* of a single tick */
+} ai_stats;
+
 #define AI_DEFAULT_TOLERANCE 0.2
+#define AI_DEFAULT_BUDGET    0.008  /* seconds per tick in the game, half a frame */
 
 int ai_init(const int, const int);
+void ai_cleanup(void);
 void ai_tick(void);
 
-int ai_path_length(ai_path*);
+void ai_config_default(ai_config*);
+int ai_config_parse(ai_config*, const char*);
+int ai_config_load(ai_config*, const char*);
+int ai_config_save(const ai_config*, const char*);
+void ai_set_defaults(const ai_config*);
+int ai_configure(const int, const ai_config*);
+int ai_get_config(const int, ai_config*);
+int ai_config_format(const ai_config*, char*, const size_t);
+
+int ai_set_budget(const double);
+void ai_set_trace(const int, FILE*);
+int ai_trace_get(const int, ai_trace_record*, const int);
+int ai_trace_format(const ai_trace_record*, char*, const size_t);
+int ai_trace_dump(const int, FILE*);
+void ai_trace_suicides(void);
+void ai_set_persistent(const int);
+void ai_get_stats(ai_stats*);
+void ai_reset_stats(void);
+
+int ai_path_length(const ai_path*);
+object* ai_find_closest(const object_type, const int, const int);
 int ai_find_refugee(const int, const int, const int, int*, int*);
-ai_path* ai_find_path(const int, const int, const int, const int, const int);
-void ai_path_free(ai_path**);
+int ai_find_path(const int, const int, const int, const int, const int, ai_path*);
+int ai_find_step(const int, const int, const int, const int, const int, int*, int*);
+int ai_distance(const int, const int, const int, const int);
+int ai_next_step(const int, const int, const int, const int, int*, int*);
+int ai_first_steps(const int, const int, const int, const int, unsigned*);
+int ai_safe_path(const int, const int, const int, const int, ai_path*);
 
 #endif /* AI_H */
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "game.h"
+#include "ai.h"
+#include "tool.h"
+
+/*
+ * Benchmark for the AI's planning
+ *
+ * Plays headless matches and reports how often the AIs had to plan
+ * (search for a target or a refuge) instead of following the path of
+ * their objective, next to the time per tick and how the matches went.
+ * -r plans at every step, the way the AI worked before objectives. The
+ * AIs think for as long as they like, unless -b gives them a budget per
+ * tick; what they decide then depends on how fast the machine is. -T
+ * writes the last decisions of every AI that kills itself to a file.
+ */
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+		   "\n"
+		   "  -m num  matches to play (default: 20)\n"
+		   "  -p num  CPU players per match (default: 4)\n"
+		   "  -s num  seed of the first match (default: 1)\n"
+		   "  -t num  tick limit per match (default: %d)\n"
+		   "  -r      plan at every step\n"
+		   "  -c cfg  AI configuration, e.g. \"difficulty=easy\"\n"
+		   "  -b ms   time the AIs may think per tick (default: no limit)\n"
+		   "  -T file trace the AIs' decisions, dump them on suicides\n",
+		   argv0, 3 * 60 * FPS);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long ticks, suicides, frags, boulders;
+	double start, elapsed;
+	ai_config cfg;
+	ai_stats stats;
+	FILE *trace;
+	unsigned seed;
+	int matches, players, max_ticks;
+	int opt;
+	int i;
+
+	matches = 20;
+	players = 4;
+	seed = 1;
+	max_ticks = 3 * 60 * FPS;
+	trace = NULL;
+
+	while((opt = getopt(argc, argv, "m:p:s:t:rc:b:T:h")) != -1) {
+		switch(opt) {
+		case 'm':
+			matches = atoi(optarg);
+			break;
+
+		case 'p':
+			players = atoi(optarg);
+			break;
+
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+
+		case 't':
+			max_ticks = atoi(optarg);
+			break;
+
+		case 'r':
+			ai_set_persistent(0);
+			break;
+
+		case 'c':
+			ai_config_default(&cfg);
+
+			if(ai_config_parse(&cfg, optarg) < 0) {
+				fprintf(stderr, "Invalid configuration: %s\n", optarg);
+				return(1);
+			}
+
+			ai_set_defaults(&cfg);
+			break;
+
+		case 'b':
+			if(ai_set_budget(atof(optarg) / 1000) < 0) {
+				_usage(argv[0]);
+				return(1);
+			}
+			break;
+
+		case 'T':
+			if(!(trace = fopen(optarg, "w"))) {
+				perror(optarg);
+				return(1);
+			}
+
+			ai_set_trace(1, trace);
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if(players < 2 || players > MAX_PLAYERS) {
+		_usage(argv[0]);
+		return(1);
+	}
+
+	ticks = 0;
+	suicides = 0;
+	frags = 0;
+	boulders = 0;
+	ai_reset_stats();
+	start = tool_now();
+
+	for(i = 0; i < matches; i++) {
+		int n, p;
+
+		game_seed(seed + i);
+
+		if(game_init(0, players) < 0) {
+			fprintf(stderr, "game_init failed\n");
+			return(1);
+		}
+
+		for(n = 0; n < max_ticks && !game_is_over(); n++) {
+			game_logic();
+			game_animate();
+		}
+
+		for(p = 0; p < players; p++) {
+			suicides += game_player_num(p)->suicides;
+			frags += game_player_num(p)->frags;
+			boulders += game_player_num(p)->boulders;
+		}
+
+		ticks += n;
+		game_cleanup();
+	}
+
+	elapsed = tool_now() - start;
+	ai_get_stats(&stats);
+
+	printf("%d matches, %lu ticks in %.2fs: %.0f ticks/s, %.2fus per tick\n",
+		   matches, ticks, elapsed, ticks / elapsed, elapsed * 1e6 / ticks);
+	printf("%lu decisions, %lu plans (%.1f%%): %.0f plans/s, %.1f per 1000 ticks\n",
+		   stats.thinks, stats.plans,
+		   stats.thinks ? 100.0 * stats.plans / stats.thinks : 0.0,
+		   stats.plans / elapsed, 1000.0 * stats.plans / ticks);
+	if(stats.playouts > 0) {
+		printf("%lu playouts in %.2fs: %.0f playouts/s, %.1f per decision\n",
+			   stats.playouts, stats.playout_seconds,
+			   stats.playouts / stats.playout_seconds,
+			   (double)stats.playouts / stats.plans);
+	}
+
+	printf("%.2fus thinking per tick, %.2fms at most, %lu over budget, %lu searches resumed\n",
+		   stats.think_seconds * 1e6 / ticks, stats.worst_seconds * 1e3,
+		   stats.overruns, stats.resumes);
+	printf("per match: %.2f suicides, %.2f frags, %.1f boulders\n",
+		   (double)suicides / matches, (double)frags / matches,
+		   (double)boulders / matches);
+
+	if(trace) {
+		ai_set_trace(0, NULL);
+		fclose(trace);
+	}
+
+	return(0);
+}
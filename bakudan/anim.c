@@ -1,6 +1,7 @@
 #include <errno.h>
 #include "anim.h"
 #include "gfx.h"
+#include "mem.h"
 
 static const char *_anim_paths[ANIM_NUM] = {
 	"gfx/explosion.png",
@@ -162,7 +163,7 @@ anim_inst* anim_get_inst(anim_type type, const int x, const int y)
 		return(NULL);
 	}
 
-	a = malloc(sizeof(*a));
+	a = mem_alloc(MEM_ANIM, sizeof(*a));
 
 	if(a) {
 		memset(a, 0, sizeof(*a));
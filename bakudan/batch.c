@@ -0,0 +1,617 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "batch.h"
+#include "mem.h"
+#include "rng.h"
+
+#define LANE_FOREACH(k) for((k) = 0; (k) < BATCH_LANES; (k)++)
+
+static inline int _any(const lanes v)
+{
+	int32_t ret_val;
+	int k;
+
+	ret_val = 0;
+
+	LANE_FOREACH(k) {
+		ret_val |= v[k];
+	}
+
+	return(ret_val != 0);
+}
+
+/* pick a where mask is set, b elsewhere */
+static inline lanes _select(const lanes mask, const lanes a, const lanes b)
+{
+	return((mask & a) | (~mask & b));
+}
+
+batch* batch_new(void)
+{
+	batch *b;
+
+	/* the vector members need stricter alignment than malloc() gives */
+	b = mem_alloc_aligned(MEM_BATCH, sizeof(lanes), sizeof(batch));
+
+	if(!b) {
+		return(NULL);
+	}
+
+	batch_clear(b);
+
+	return(b);
+}
+
+void batch_free(batch *b)
+{
+	mem_free(MEM_BATCH, b);
+	return;
+}
+
+void batch_clear(batch *b)
+{
+	int p, k;
+
+	memset(b, 0, sizeof(*b));
+
+	/* an empty batch has no live lanes and nobody standing on the board */
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		LANE_FOREACH(k) {
+			b->x[p][k] = -1;
+			b->y[p][k] = -1;
+			b->winner[k] = -1;
+		}
+	}
+
+	for(p = 0; p < BATCH_CELLS; p++) {
+		LANE_FOREACH(k) {
+			b->type[p][k] = CELL_EMPTY;
+		}
+	}
+
+	return;
+}
+
+/*
+ * Copy the match that is currently loaded in the scalar engine into
+ * lane `k', including the state of the random number generator.
+ */
+int batch_load(batch *b, const int k)
+{
+	int x, y, p;
+
+	if(k < 0 || k >= BATCH_LANES) {
+		return(-EINVAL);
+	}
+
+	for(x = 0; x < WIDTH; x++) {
+		for(y = 0; y < HEIGHT; y++) {
+			object *o;
+			int c;
+
+			o = game_object_at(x, y);
+			c = BATCH_CELL(x, y);
+
+			b->type[c][k] = o ? (int32_t)o->type : CELL_EMPTY;
+
+			if(!o) {
+				continue;
+			}
+
+			switch(o->type) {
+			case OBJECT_TYPE_BOULDER:
+				b->strength[c][k] = ((boulder*)o)->strength;
+				b->owner[c][k] = ((boulder*)o)->attacker;
+				break;
+
+			case OBJECT_TYPE_BOMB:
+				b->strength[c][k] = ((bomb*)o)->strength;
+				b->owner[c][k] = ((bomb*)o)->owner;
+				b->timeout[c][k] = ((bomb*)o)->timeout;
+				break;
+
+			case OBJECT_TYPE_ITEM:
+				b->item[c][k] = ((item*)o)->type;
+				b->item_bombs[c][k] = ((item*)o)->bombs;
+				b->item_lifes[c][k] = ((item*)o)->lifes;
+				b->item_probability[c][k] = ((item*)o)->probability;
+				b->item_health[c][k] = ((item*)o)->health;
+				b->item_bomb_strength[c][k] = ((item*)o)->bomb_strength;
+				b->item_bomb_timeout[c][k] = ((item*)o)->bomb_timeout;
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	b->nplayers[k] = game_num_players();
+	b->alive_players[k] = 0;
+
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		player *pl;
+
+		pl = game_player_num(p);
+
+		if(!pl) {
+			b->x[p][k] = -1;
+			b->y[p][k] = -1;
+			b->dx[p][k] = 0;
+			b->dy[p][k] = 0;
+			b->health[p][k] = 0;
+			b->alive[p][k] = 0;
+			continue;
+		}
+
+		b->x[p][k] = obj_x(pl);
+		b->y[p][k] = obj_y(pl);
+		b->dx[p][k] = pl->dx;
+		b->dy[p][k] = pl->dy;
+		b->spawn_x[p][k] = pl->spawn_x;
+		b->spawn_y[p][k] = pl->spawn_y;
+		b->health[p][k] = pl->health;
+		b->bomb_timeout[p][k] = pl->bomb_timeout;
+		b->bomb_strength[p][k] = pl->bomb_strength;
+		b->bombs[p][k] = pl->bombs;
+		b->lifes[p][k] = pl->lifes;
+		b->probability[p][k] = pl->probability;
+		b->alive[p][k] = pl->alive;
+		b->attacker[p][k] = pl->attacker;
+		b->frags[p][k] = pl->frags;
+		b->deaths[p][k] = pl->deaths;
+		b->boulders[p][k] = pl->boulders;
+		b->suicides[p][k] = pl->suicides;
+		b->items[p][k] = pl->items;
+
+		b->alive_players[k] += pl->alive ? 1 : 0;
+	}
+
+	b->winner[k] = game_get_winner();
+	b->over[k] = game_is_over();
+	b->live[k] = !b->over[k];
+	b->rng[k] = game_rng_state();
+
+	return(0);
+}
+
+/*
+ * Make every lane of b a copy of lane `k' of `from', e.g. to play a
+ * match on from one state many times. The whole struct is one lanes
+ * value per field, so this is a broadcast per field.
+ */
+void batch_fill(batch *b, const batch *from, const int k)
+{
+	const int32_t *src;
+	int32_t *dst;
+	size_t i;
+	int l;
+
+	_Static_assert(sizeof(batch) % sizeof(lanes) == 0,
+				   "batch must consist of lanes values only");
+
+	src = (const int32_t*)from;
+	dst = (int32_t*)b;
+
+	for(i = 0; i < sizeof(batch) / sizeof(int32_t); i += BATCH_LANES) {
+		int32_t v;
+
+		v = src[i + k];
+
+		LANE_FOREACH(l) {
+			dst[i + l] = v;
+		}
+	}
+
+	return;
+}
+
+int batch_live(batch *b)
+{
+	int ret_val;
+	int k;
+
+	ret_val = 0;
+
+	LANE_FOREACH(k) {
+		ret_val += b->live[k];
+	}
+
+	return(ret_val);
+}
+
+void batch_player_move(batch *b, const int k, const int p, const int dx, const int dy)
+{
+	int tx, ty;
+	int t;
+
+	/* same rules as game_player_move() */
+	if(b->dx[p][k] || b->dy[p][k]) {
+		return;
+	}
+
+	if(dx && dy) {
+		return;
+	}
+
+	tx = b->x[p][k] + dx;
+	ty = b->y[p][k] + dy;
+	t = b->type[BATCH_CELL(tx, ty)][k];
+
+	if(t == CELL_EMPTY || t == OBJECT_TYPE_ITEM || t == OBJECT_TYPE_BOMB) {
+		b->dx[p][k] = -32 * dx;
+		b->dy[p][k] = -32 * dy;
+		b->x[p][k] = tx;
+		b->y[p][k] = ty;
+	}
+
+	return;
+}
+
+void batch_player_action(batch *b, const int k, const int p)
+{
+	int c;
+
+	/* same rules as game_player_action() */
+	if(b->dx[p][k] || b->dy[p][k] || b->bombs[p][k] <= 0) {
+		return;
+	}
+
+	c = BATCH_CELL(b->x[p][k], b->y[p][k]);
+
+	b->type[c][k] = OBJECT_TYPE_BOMB;
+	b->strength[c][k] = b->bomb_strength[p][k];
+	b->timeout[c][k] = b->bomb_timeout[p][k] * FPS;
+	b->owner[c][k] = p;
+	b->bombs[p][k]--;
+
+	return;
+}
+
+/*
+ * Burn down the fuses of every bomb in every live lane and collect the
+ * cells in which at least one lane has a bomb going off.
+ */
+static int _batch_fuses(batch *b, int *cells)
+{
+	lanes live;
+	int n, c;
+
+	live = b->live != 0;
+
+	for(n = 0, c = 0; c < BATCH_CELLS; c++) {
+		lanes burning;
+
+		/* burning is -1 in every lane whose fuse burns */
+		burning = (b->type[c] == OBJECT_TYPE_BOMB) & live;
+		b->timeout[c] += burning;
+
+		if(_any(burning & (b->timeout[c] <= 0))) {
+			cells[n++] = c;
+		}
+	}
+
+	return(n);
+}
+
+static void _batch_hit_players(batch *b, const int x, const int y,
+							   const lanes mask, const lanes dmg,
+							   const lanes owner)
+{
+	int p;
+
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		lanes hit;
+
+		hit = mask & (b->x[p] == x) & (b->y[p] == y) & (b->health[p] > 0);
+
+		b->health[p] -= hit & dmg;
+		b->attacker[p] = _select(hit, owner, b->attacker[p]);
+	}
+
+	return;
+}
+
+static void _batch_detonate(batch *b, const int c, const lanes det)
+{
+	static const int dirs[4][2] = {
+		{ -1,  0 },
+		{  1,  0 },
+		{  0, -1 },
+		{  0,  1 }
+	};
+	int bx, by;
+	int d;
+
+	bx = c / HEIGHT;
+	by = c % HEIGHT;
+
+	/* players standing on the bomb take the full strength */
+	_batch_hit_players(b, bx, by, det, b->strength[c], b->owner[c]);
+
+	/*
+	 * Walk the four rays of the explosion in the same order as
+	 * bomb_detonate(). A ray ends in a lane when the damage drops to
+	 * zero or when it hits a wall or pillar.
+	 */
+	for(d = 0; d < 4; d++) {
+		lanes act;
+		int tx, ty;
+		int dist;
+
+		act = det;
+
+		for(dist = 1, tx = bx + dirs[d][0], ty = by + dirs[d][1];
+			tx > 0 && tx < WIDTH && ty > 0 && ty < HEIGHT;
+			dist++, tx += dirs[d][0], ty += dirs[d][1]) {
+			lanes dmg;
+			lanes hit;
+			int t;
+
+			dmg = b->strength[c] - dist * BOMB_GRADIENT;
+			act &= dmg > 0;
+
+			if(!_any(act)) {
+				break;
+			}
+
+			_batch_hit_players(b, tx, ty, act, dmg, b->owner[c]);
+
+			t = BATCH_CELL(tx, ty);
+
+			hit = act & (b->type[t] == OBJECT_TYPE_BOULDER) & (b->strength[t] > 0);
+
+			b->strength[t] -= hit & dmg;
+			b->owner[t] = _select(hit, b->owner[c], b->owner[t]);
+
+			act &= (b->type[t] != OBJECT_TYPE_WALL) &
+				(b->type[t] != OBJECT_TYPE_PILLAR);
+		}
+	}
+
+	return;
+}
+
+static void _batch_detonations(batch *b, const int *cells, const int n)
+{
+	lanes live;
+	int i;
+
+	live = b->live != 0;
+
+	/* cells[] is in the same order as the scan in game_logic() */
+	for(i = 0; i < n; i++) {
+		int c;
+
+		c = cells[i];
+
+		_batch_detonate(b, c, (b->type[c] == OBJECT_TYPE_BOMB) &
+						(b->timeout[c] <= 0) & live);
+	}
+
+	return;
+}
+
+static void _batch_drop_item(batch *b, const int c, const int k)
+{
+	uint32_t *rng;
+	int type;
+
+	rng = &(b->rng[k]);
+	type = rng_range(rng, 0, ITEM_TYPE_NUM);
+
+	b->type[c][k] = OBJECT_TYPE_ITEM;
+	b->item[c][k] = type;
+	b->item_bombs[c][k] = 0;
+	b->item_lifes[c][k] = 0;
+	b->item_probability[c][k] = 0;
+	b->item_health[c][k] = 0;
+	b->item_bomb_strength[c][k] = 0;
+	b->item_bomb_timeout[c][k] = 0;
+
+	/* same draws as drop_item() */
+	switch(type) {
+	case ITEM_TYPE_BAG:
+		b->item_bombs[c][k] = 1;
+		break;
+
+	case ITEM_TYPE_LIFE:
+		b->item_lifes[c][k] = 1;
+		break;
+
+	case ITEM_TYPE_LUCK:
+		b->item_probability[c][k] = rng_range(rng, -5, 15);
+		break;
+
+	case ITEM_TYPE_POTION:
+		b->item_health[c][k] = rng_range(rng, 10, 100);
+		break;
+
+	case ITEM_TYPE_TIME:
+		b->item_bomb_timeout[c][k] = rng_range(rng, -3, 3);
+		break;
+
+	case ITEM_TYPE_POWER:
+		b->item_bomb_strength[c][k] = rng_range(rng, -500, 500);
+		break;
+
+	default:
+		break;
+	}
+
+	return;
+}
+
+static void _batch_cleanup(batch *b)
+{
+	lanes live;
+	int c, k;
+
+	live = b->live != 0;
+
+	for(c = 0; c < BATCH_CELLS; c++) {
+		lanes broken;
+		lanes spent;
+
+		broken = (b->type[c] == OBJECT_TYPE_BOULDER) & (b->strength[c] <= 0) & live;
+		spent = (b->type[c] == OBJECT_TYPE_BOMB) & (b->timeout[c] <= 0) & live;
+
+		if(!_any(broken | spent)) {
+			continue;
+		}
+
+		LANE_FOREACH(k) {
+			if(broken[k]) {
+				int p;
+
+				p = b->owner[c][k];
+				b->type[c][k] = CELL_EMPTY;
+
+				if(rng_chance(&(b->rng[k]), b->probability[p][k])) {
+					_batch_drop_item(b, c, k);
+				}
+
+				b->boulders[p][k]++;
+			} else if(spent[k]) {
+				b->bombs[b->owner[c][k]][k]++;
+				b->type[c][k] = CELL_EMPTY;
+			}
+		}
+	}
+
+	return;
+}
+
+static void _batch_pickup(batch *b, const int k, const int p)
+{
+	int c;
+
+	c = BATCH_CELL(b->x[p][k], b->y[p][k]);
+
+	if(b->type[c][k] != OBJECT_TYPE_ITEM) {
+		return;
+	}
+
+	b->type[c][k] = CELL_EMPTY;
+
+	b->health[p][k] += b->item_health[c][k];
+	b->bombs[p][k] += b->item_bombs[c][k];
+	b->probability[p][k] += b->item_probability[c][k];
+	b->bomb_strength[p][k] += b->item_bomb_strength[c][k];
+	b->bomb_timeout[p][k] += b->item_bomb_timeout[c][k];
+	b->lifes[p][k] += b->item_lifes[c][k];
+	b->items[p][k]++;
+
+	return;
+}
+
+static void _batch_players(batch *b)
+{
+	int k;
+
+	LANE_FOREACH(k) {
+		int p;
+
+		if(!b->live[k]) {
+			continue;
+		}
+
+		for(p = 0; p < MAX_PLAYERS; p++) {
+			if(!b->alive[p][k]) {
+				continue;
+			}
+
+			if(b->health[p][k] <= 0) {
+				int a;
+
+				a = b->attacker[p][k];
+
+				if(a == p) {
+					b->suicides[p][k]++;
+				} else {
+					b->deaths[p][k]++;
+					b->frags[a][k]++;
+				}
+
+				/* drop a life? */
+				if(rng_chance(&(b->rng[k]), 50)) {
+					int c;
+
+					c = BATCH_CELL(b->x[p][k], b->y[p][k]);
+
+					b->type[c][k] = OBJECT_TYPE_ITEM;
+					b->item[c][k] = ITEM_TYPE_LIFE;
+					b->item_bombs[c][k] = 0;
+					b->item_lifes[c][k] = 1;
+					b->item_probability[c][k] = 0;
+					b->item_health[c][k] = 0;
+					b->item_bomb_strength[c][k] = 0;
+					b->item_bomb_timeout[c][k] = 0;
+				}
+
+				if(b->lifes[p][k] > 0) {
+					b->lifes[p][k]--;
+					b->health[p][k] = PLAYER_DEFAULT_HEALTH;
+					b->x[p][k] = b->spawn_x[p][k];
+					b->y[p][k] = b->spawn_y[p][k];
+				} else {
+					b->alive[p][k] = 0;
+					b->alive_players[k]--;
+				}
+			}
+
+			_batch_pickup(b, k, p);
+		}
+
+		if(b->alive_players[k] < 2) {
+			for(p = 0; p < MAX_PLAYERS; p++) {
+				if(b->alive[p][k]) {
+					b->winner[k] = p;
+					break;
+				}
+			}
+
+			b->over[k] = 1;
+		}
+	}
+
+	return;
+}
+
+static void _batch_animate(batch *b)
+{
+	lanes live;
+	int p;
+
+	live = b->live != 0;
+
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		/* (v < 0) - (v > 0) is the sign of v, since true is -1 */
+		b->dx[p] -= ((b->dx[p] < 0) - (b->dx[p] > 0)) & live;
+		b->dy[p] -= ((b->dy[p] < 0) - (b->dy[p] > 0)) & live;
+	}
+
+	b->live &= b->over == 0;
+
+	return;
+}
+
+void batch_step(batch *b)
+{
+	int cells[BATCH_CELLS];
+	int n;
+
+	n = _batch_fuses(b, cells);
+
+	/* boulders only break and bombs only vanish after a detonation */
+	if(n > 0) {
+		_batch_detonations(b, cells, n);
+		_batch_cleanup(b);
+	}
+
+	_batch_players(b);
+	_batch_animate(b);
+
+	return;
+}
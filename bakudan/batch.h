@@ -0,0 +1,101 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include "game.h"
+
+/*
+ * Batched simulation backend
+ *
+ * Holds BATCH_LANES matches side by side in struct-of-arrays form and
+ * advances all of them with one call to batch_step(), which does the
+ * same as game_logic() followed by game_animate() in every lane (minus
+ * the AI and the animations, which are up to the caller).
+ *
+ * Every array is laid out as [element][lane], so that one element of
+ * all lanes fits into a vector register and the common work (fuses,
+ * blasts, damage, sliding) is done for all lanes at once. Rare events
+ * (boulders breaking, deaths, item pickups) are handled lane by lane.
+ */
+
+/* one vector register worth of 32 bit lanes */
+#ifndef BATCH_LANES
+#if defined(__AVX512F__)
+#define BATCH_LANES 16
+#elif defined(__AVX2__)
+#define BATCH_LANES 8
+#else
+#define BATCH_LANES 4
+#endif
+#endif /* BATCH_LANES */
+#define BATCH_CELLS (WIDTH * HEIGHT)
+
+/* cells are numbered column by column, like the scans in game.c */
+#define BATCH_CELL(x,y) ((x) * HEIGHT + (y))
+
+#define CELL_EMPTY -1
+
+/*
+ * One value per lane. GCC and clang map arithmetic and comparisons on
+ * this type to SIMD instructions (comparisons yield -1 for true).
+ */
+typedef int32_t lanes __attribute__((vector_size(BATCH_LANES * sizeof(int32_t))));
+
+typedef struct {
+	/* board */
+	lanes type[BATCH_CELLS];     /* object_type or CELL_EMPTY */
+	lanes strength[BATCH_CELLS]; /* boulder or bomb strength */
+	lanes owner[BATCH_CELLS];    /* bomb owner or last attacker of a boulder */
+	lanes timeout[BATCH_CELLS];  /* bomb fuse */
+
+	/* items */
+	lanes item[BATCH_CELLS];
+	lanes item_bombs[BATCH_CELLS];
+	lanes item_lifes[BATCH_CELLS];
+	lanes item_probability[BATCH_CELLS];
+	lanes item_health[BATCH_CELLS];
+	lanes item_bomb_strength[BATCH_CELLS];
+	lanes item_bomb_timeout[BATCH_CELLS];
+
+	/* players; absent players are dead and off the board */
+	lanes x[MAX_PLAYERS];
+	lanes y[MAX_PLAYERS];
+	lanes dx[MAX_PLAYERS];
+	lanes dy[MAX_PLAYERS];
+	lanes spawn_x[MAX_PLAYERS];
+	lanes spawn_y[MAX_PLAYERS];
+	lanes health[MAX_PLAYERS];
+	lanes bomb_timeout[MAX_PLAYERS];
+	lanes bomb_strength[MAX_PLAYERS];
+	lanes bombs[MAX_PLAYERS];
+	lanes lifes[MAX_PLAYERS];
+	lanes probability[MAX_PLAYERS];
+	lanes alive[MAX_PLAYERS];
+	lanes attacker[MAX_PLAYERS];
+	lanes frags[MAX_PLAYERS];
+	lanes deaths[MAX_PLAYERS];
+	lanes boulders[MAX_PLAYERS];
+	lanes suicides[MAX_PLAYERS];
+	lanes items[MAX_PLAYERS];
+
+	/* matches */
+	lanes nplayers;
+	lanes alive_players;
+	lanes winner;
+	lanes over;
+	lanes live;  /* lane is stepped by batch_step() */
+	uint32_t rng[BATCH_LANES];
+} batch;
+
+batch* batch_new(void);
+void batch_free(batch*);
+void batch_clear(batch*);
+int batch_load(batch*, const int);
+void batch_fill(batch*, const batch*, const int);
+void batch_step(batch*);
+int batch_live(batch*);
+
+void batch_player_move(batch*, const int, const int, const int, const int);
+void batch_player_action(batch*, const int, const int);
+
+#endif /* BATCH_H */
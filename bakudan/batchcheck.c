@@ -0,0 +1,502 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "game.h"
+#include "batch.h"
+#include "rng.h"
+#include "tool.h"
+
+/*
+ * Correctness harness for the batched engine
+ *
+ * Plays the same seeds with random inputs on the scalar engine and on
+ * batch lanes, and compares a digest of the complete match state after
+ * every tick. The first divergence of a lane is reported together with
+ * the fields that differ.
+ */
+
+#define DEFAULT_MATCHES 64
+#define DEFAULT_TICKS   6000
+#define DEFAULT_PLAYERS 4
+
+enum {
+	INPUT_NONE = 0,
+	INPUT_UP,
+	INPUT_LEFT,
+	INPUT_DOWN,
+	INPUT_RIGHT,
+	INPUT_PLANT
+};
+
+static const int _input_dir[][2] = {
+	{  0,  0 },
+	{  0, -1 },
+	{ -1,  0 },
+	{  0,  1 },
+	{  1,  0 }
+};
+
+static int _ticks = DEFAULT_TICKS;
+static int _players = DEFAULT_PLAYERS;
+
+/* the inputs depend only on the input generator, never on the match */
+static int _random_input(uint32_t *in)
+{
+	int r;
+
+	r = rng_next(in) % 16;
+
+	return(r <= INPUT_PLANT ? r : INPUT_NONE);
+}
+
+static void _scalar_inputs(uint32_t *in)
+{
+	int p;
+
+	for(p = 0; p < game_num_players(); p++) {
+		int i;
+
+		i = _random_input(in);
+
+		if(i == INPUT_PLANT) {
+			game_player_action(p);
+		} else if(i != INPUT_NONE) {
+			game_player_move(p, _input_dir[i][0], _input_dir[i][1]);
+		}
+	}
+
+	return;
+}
+
+static void _batch_inputs(batch *b, const int k, uint32_t *in)
+{
+	int p;
+
+	for(p = 0; p < b->nplayers[k]; p++) {
+		int i;
+
+		i = _random_input(in);
+
+		if(i == INPUT_PLANT) {
+			batch_player_action(b, k, p);
+		} else if(i != INPUT_NONE) {
+			batch_player_move(b, k, p, _input_dir[i][0], _input_dir[i][1]);
+		}
+	}
+
+	return;
+}
+
+#define MIX(h,v) ((h) = ((h) ^ (uint32_t)(v)) * 16777619u)
+
+static uint32_t _digest_game(void)
+{
+	uint32_t h;
+	int x, y, p;
+
+	h = 2166136261u;
+
+	for(x = 0; x < WIDTH; x++) {
+		for(y = 0; y < HEIGHT; y++) {
+			object *o;
+
+			o = game_object_at(x, y);
+
+			if(!o) {
+				MIX(h, CELL_EMPTY);
+				continue;
+			}
+
+			MIX(h, o->type);
+
+			switch(o->type) {
+			case OBJECT_TYPE_BOULDER:
+				MIX(h, ((boulder*)o)->strength);
+				MIX(h, ((boulder*)o)->attacker);
+				break;
+
+			case OBJECT_TYPE_BOMB:
+				MIX(h, ((bomb*)o)->strength);
+				MIX(h, ((bomb*)o)->owner);
+				MIX(h, ((bomb*)o)->timeout);
+				break;
+
+			case OBJECT_TYPE_ITEM:
+				MIX(h, ((item*)o)->type);
+				MIX(h, ((item*)o)->bombs);
+				MIX(h, ((item*)o)->lifes);
+				MIX(h, ((item*)o)->probability);
+				MIX(h, ((item*)o)->health);
+				MIX(h, ((item*)o)->bomb_strength);
+				MIX(h, ((item*)o)->bomb_timeout);
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	for(p = 0; p < game_num_players(); p++) {
+		player *pl;
+
+		pl = game_player_num(p);
+
+		MIX(h, obj_x(pl));
+		MIX(h, obj_y(pl));
+		MIX(h, pl->dx);
+		MIX(h, pl->dy);
+		MIX(h, pl->health);
+		MIX(h, pl->bomb_timeout);
+		MIX(h, pl->bomb_strength);
+		MIX(h, pl->bombs);
+		MIX(h, pl->lifes);
+		MIX(h, pl->probability);
+		MIX(h, pl->alive);
+		MIX(h, pl->attacker);
+		MIX(h, pl->frags);
+		MIX(h, pl->deaths);
+		MIX(h, pl->boulders);
+		MIX(h, pl->suicides);
+		MIX(h, pl->items);
+	}
+
+	MIX(h, game_is_over());
+	MIX(h, game_get_winner());
+	MIX(h, game_rng_state());
+
+	return(h);
+}
+
+static uint32_t _digest_lane(batch *b, const int k)
+{
+	uint32_t h;
+	int c, p;
+
+	h = 2166136261u;
+
+	for(c = 0; c < BATCH_CELLS; c++) {
+		MIX(h, b->type[c][k]);
+
+		switch(b->type[c][k]) {
+		case OBJECT_TYPE_BOULDER:
+			MIX(h, b->strength[c][k]);
+			MIX(h, b->owner[c][k]);
+			break;
+
+		case OBJECT_TYPE_BOMB:
+			MIX(h, b->strength[c][k]);
+			MIX(h, b->owner[c][k]);
+			MIX(h, b->timeout[c][k]);
+			break;
+
+		case OBJECT_TYPE_ITEM:
+			MIX(h, b->item[c][k]);
+			MIX(h, b->item_bombs[c][k]);
+			MIX(h, b->item_lifes[c][k]);
+			MIX(h, b->item_probability[c][k]);
+			MIX(h, b->item_health[c][k]);
+			MIX(h, b->item_bomb_strength[c][k]);
+			MIX(h, b->item_bomb_timeout[c][k]);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	for(p = 0; p < b->nplayers[k]; p++) {
+		MIX(h, b->x[p][k]);
+		MIX(h, b->y[p][k]);
+		MIX(h, b->dx[p][k]);
+		MIX(h, b->dy[p][k]);
+		MIX(h, b->health[p][k]);
+		MIX(h, b->bomb_timeout[p][k]);
+		MIX(h, b->bomb_strength[p][k]);
+		MIX(h, b->bombs[p][k]);
+		MIX(h, b->lifes[p][k]);
+		MIX(h, b->probability[p][k]);
+		MIX(h, b->alive[p][k]);
+		MIX(h, b->attacker[p][k]);
+		MIX(h, b->frags[p][k]);
+		MIX(h, b->deaths[p][k]);
+		MIX(h, b->boulders[p][k]);
+		MIX(h, b->suicides[p][k]);
+		MIX(h, b->items[p][k]);
+	}
+
+	MIX(h, b->over[k]);
+	MIX(h, b->winner[k]);
+	MIX(h, b->rng[k]);
+
+	return(h);
+}
+
+#undef MIX
+
+static uint32_t _input_seed(const unsigned seed)
+{
+	return(rng_seed(seed ^ 0x5eed1e55u));
+}
+
+/*
+ * Replay `seed' on the scalar engine up to and including `tick' and
+ * print everything that differs from lane `k'.
+ */
+static void _diff_lane(batch *b, const int k, const unsigned seed, const int tick)
+{
+	batch *ref;
+	uint32_t in;
+	int t, c, p;
+
+	ref = batch_new();
+
+	if(!ref) {
+		return;
+	}
+
+	game_seed(seed);
+	game_init(_players, 0);
+	in = _input_seed(seed);
+
+	for(t = 0; t <= tick; t++) {
+		_scalar_inputs(&in);
+		game_logic();
+		game_animate();
+	}
+
+	batch_load(ref, 0);
+	game_cleanup();
+
+	for(c = 0; c < BATCH_CELLS; c++) {
+		if(ref->type[c][0] != b->type[c][k] ||
+		   ref->strength[c][0] != b->strength[c][k] ||
+		   ref->owner[c][0] != b->owner[c][k] ||
+		   ref->timeout[c][0] != b->timeout[c][k]) {
+			printf("  cell (%02d,%02d): scalar type %d str %d own %d fuse %d,"
+				   " batch type %d str %d own %d fuse %d\n",
+				   c / HEIGHT, c % HEIGHT,
+				   ref->type[c][0], ref->strength[c][0],
+				   ref->owner[c][0], ref->timeout[c][0],
+				   b->type[c][k], b->strength[c][k],
+				   b->owner[c][k], b->timeout[c][k]);
+		}
+	}
+
+	for(p = 0; p < _players; p++) {
+		if(ref->x[p][0] != b->x[p][k] || ref->y[p][0] != b->y[p][k] ||
+		   ref->dx[p][0] != b->dx[p][k] || ref->dy[p][0] != b->dy[p][k] ||
+		   ref->health[p][0] != b->health[p][k] ||
+		   ref->lifes[p][0] != b->lifes[p][k] ||
+		   ref->bombs[p][0] != b->bombs[p][k] ||
+		   ref->alive[p][0] != b->alive[p][k]) {
+			printf("  P%d: scalar (%02d,%02d)%+d%+d hp %d lifes %d bombs %d alive %d,"
+				   " batch (%02d,%02d)%+d%+d hp %d lifes %d bombs %d alive %d\n", p,
+				   ref->x[p][0], ref->y[p][0], ref->dx[p][0], ref->dy[p][0],
+				   ref->health[p][0], ref->lifes[p][0], ref->bombs[p][0],
+				   ref->alive[p][0],
+				   b->x[p][k], b->y[p][k], b->dx[p][k], b->dy[p][k],
+				   b->health[p][k], b->lifes[p][k], b->bombs[p][k],
+				   b->alive[p][k]);
+		}
+	}
+
+	if(ref->rng[0] != b->rng[k]) {
+		printf("  rng: scalar %08x, batch %08x\n", ref->rng[0], b->rng[k]);
+	}
+
+	batch_free(ref);
+
+	return;
+}
+
+/* returns the number of lanes that diverged from the scalar engine */
+static int _check_group(batch *b, const unsigned seed,
+						double *scalar_time, double *batch_time,
+						long *scalar_ticks, long *batch_ticks)
+{
+	uint32_t *digests[BATCH_LANES];
+	uint32_t in[BATCH_LANES];
+	int len[BATCH_LANES];
+	int failed[BATCH_LANES];
+	int ret_val;
+	double start;
+	int t, k;
+
+	ret_val = 0;
+	batch_clear(b);
+
+	for(k = 0; k < BATCH_LANES; k++) {
+		digests[k] = malloc(sizeof(*digests[k]) * _ticks);
+
+		if(!digests[k]) {
+			while(--k >= 0) {
+				free(digests[k]);
+			}
+
+			return(-ENOMEM);
+		}
+
+		failed[k] = 0;
+	}
+
+	/* reference run on the scalar engine */
+	for(k = 0; k < BATCH_LANES; k++) {
+		game_seed(seed + k);
+		game_init(_players, 0);
+		batch_load(b, k);
+		in[k] = _input_seed(seed + k);
+
+		for(t = 0; t < _ticks && !game_is_over(); t++) {
+			start = tool_now();
+
+			_scalar_inputs(&(in[k]));
+			game_logic();
+			game_animate();
+
+			*scalar_time += tool_now() - start;
+			digests[k][t] = _digest_game();
+		}
+
+		*scalar_ticks += t;
+		len[k] = t;
+
+		game_cleanup();
+		in[k] = _input_seed(seed + k);
+	}
+
+	/* the same matches, in lockstep */
+	for(t = 0; t < _ticks && batch_live(b); t++) {
+		start = tool_now();
+
+		for(k = 0; k < BATCH_LANES; k++) {
+			if(b->live[k]) {
+				_batch_inputs(b, k, &(in[k]));
+				*batch_ticks += 1;
+			}
+		}
+
+		batch_step(b);
+		*batch_time += tool_now() - start;
+
+		for(k = 0; k < BATCH_LANES; k++) {
+			if(failed[k] || t >= len[k]) {
+				continue;
+			}
+
+			if(_digest_lane(b, k) != digests[k][t] ||
+			   (t == len[k] - 1 && len[k] < _ticks && b->live[k])) {
+				printf("seed %u diverged at tick %d\n", seed + k, t);
+				_diff_lane(b, k, seed + k, t);
+				failed[k] = 1;
+				ret_val++;
+			}
+		}
+	}
+
+	for(k = 0; k < BATCH_LANES; k++) {
+		free(digests[k]);
+	}
+
+	return(ret_val);
+}
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [-m matches] [-t ticks] [-p players] [-s seed]\n"
+		   "\n"
+		   "  -m  number of matches to compare (default: %d)\n"
+		   "  -t  maximum number of ticks per match (default: %d)\n"
+		   "  -p  players per match, 2 to %d (default: %d)\n"
+		   "  -s  seed of the first match (default: 1)\n",
+		   argv0, DEFAULT_MATCHES, DEFAULT_TICKS, MAX_PLAYERS, DEFAULT_PLAYERS);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	double scalar_time, batch_time;
+	long scalar_ticks, batch_ticks;
+	unsigned seed;
+	int matches;
+	int failed;
+	batch *b;
+	int opt;
+	int g;
+
+	matches = DEFAULT_MATCHES;
+	seed = 1;
+
+	while((opt = getopt(argc, argv, "m:t:p:s:h")) != -1) {
+		switch(opt) {
+		case 'm':
+			matches = atoi(optarg);
+			break;
+
+		case 't':
+			_ticks = atoi(optarg);
+			break;
+
+		case 'p':
+			_players = atoi(optarg);
+			break;
+
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if(matches < 1 || _ticks < 1 || _players < 2 || _players > MAX_PLAYERS) {
+		_usage(argv[0]);
+		return(1);
+	}
+
+	b = batch_new();
+
+	if(!b) {
+		fprintf(stderr, "malloc: %s\n", strerror(ENOMEM));
+		return(1);
+	}
+
+	scalar_time = 0;
+	batch_time = 0;
+	scalar_ticks = 0;
+	batch_ticks = 0;
+	failed = 0;
+
+	for(g = 0; g < matches; g += BATCH_LANES) {
+		int err;
+
+		err = _check_group(b, seed + g, &scalar_time, &batch_time,
+						   &scalar_ticks, &batch_ticks);
+
+		if(err < 0) {
+			fprintf(stderr, "_check_group: %s\n", strerror(-err));
+			batch_free(b);
+			return(1);
+		}
+
+		failed += err;
+	}
+
+	batch_free(b);
+
+	printf("%d matches, %d lanes per batch, %d diverged\n",
+		   g, BATCH_LANES, failed);
+	printf("scalar: %ld ticks in %.3fs (%.0f ticks/s)\n",
+		   scalar_ticks, scalar_time,
+		   scalar_time > 0 ? scalar_ticks / scalar_time : 0.0);
+	printf("batch : %ld ticks in %.3fs (%.0f ticks/s)\n",
+		   batch_ticks, batch_time,
+		   batch_time > 0 ? batch_ticks / batch_time : 0.0);
+
+	return(failed ? 1 : 0);
+}
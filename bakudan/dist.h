@@ -0,0 +1,43 @@
+#ifndef DIST_H
+#define DIST_H
+
+#include "game.h"
+
+/*
+ * Shortest distances between all pairs of cells on the static layout,
+ * i.e. with nothing but walls and pillars on the board. Boulders and
+ * bombs can only make a path longer, so this is an admissible (and
+ * consistent) heuristic for path searches, and the exact distance once
+ * the cells in between have been cleared.
+ *
+ * The table is generated at build time by gendist.
+ */
+
+#define DIST_INF 255
+#define DIST_CELL(x,y) ((x) * HEIGHT + (y))
+
+/* larger layouts would need too much memory for a full table */
+#define DIST_TABLE_MAX_CELLS 1024
+
+#if WIDTH * HEIGHT <= DIST_TABLE_MAX_CELLS
+
+#define HAVE_DIST_TABLE 1
+
+extern const unsigned char dist_table[WIDTH * HEIGHT][WIDTH * HEIGHT];
+
+static inline int dist_static(const int ax, const int ay, const int bx, const int by)
+{
+	return(dist_table[DIST_CELL(ax, ay)][DIST_CELL(bx, by)]);
+}
+
+#else /* WIDTH * HEIGHT <= DIST_TABLE_MAX_CELLS */
+
+static inline int dist_static(const int ax, const int ay, const int bx, const int by)
+{
+	return((ax < bx ? bx - ax : ax - bx) +
+		   (ay < by ? by - ay : ay - by));
+}
+
+#endif /* WIDTH * HEIGHT <= DIST_TABLE_MAX_CELLS */
+
+#endif /* DIST_H */
@@ -1,14 +1,43 @@
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include "engine.h"
 #include "gfx.h"
 #include "game.h"
+#include "ai.h"
+#include "live.h"
+#include "record.h"
+#include "mem.h"
+#include "trace.h"
+#include "input.h"
 
 static int _stop;
 static game_state _state;
 static int _menu_selection;
+static int _dirty;  /* the screen needs to be redrawn */
+
+/* watching the game from outside is optional, so failures aren't fatal */
+static void _live_init(void)
+{
+	const char *name;
+	int err;
+
+	name = getenv(LIVE_ENV);
+
+	if(!name || !*name) {
+		return;
+	}
+
+	err = live_open(name);
+
+	if(err < 0) {
+		fprintf(stderr, "live_open: %s: %s\n", name, strerror(-err));
+	}
+
+	return;
+}
 
 int engine_init(void)
 {
@@ -27,6 +56,32 @@ int engine_init(void)
 		if(ret_val < 0) {
 			fprintf(stderr, "game_init: %s\n", strerror(-ret_val));
 		}
+
+		_live_init();
+
+		/* the game runs in real time, the AIs have to keep up with it */
+		ai_set_budget(AI_DEFAULT_BUDGET);
+
+		/* BAKUDAN_TRACE=file records trace spans until the game quits */
+		if(getenv("BAKUDAN_TRACE")) {
+			int err;
+
+			err = trace_start(getenv("BAKUDAN_TRACE"));
+
+			if(err < 0) {
+				fprintf(stderr, "trace_start: %s\n", strerror(-err));
+			}
+		}
+
+		/* BAKUDAN_AI_TRACE=1 prints what AIs were thinking when they killed themselves */
+		if(getenv("BAKUDAN_AI_TRACE")) {
+			ai_set_trace(1, stderr);
+		}
+
+		/* BAKUDAN_MEM_DUMP=n prints the heap accounting every n ticks */
+		if(getenv("BAKUDAN_MEM_DUMP")) {
+			mem_set_dump(strtoul(getenv("BAKUDAN_MEM_DUMP"), NULL, 10), stderr);
+		}
 	}
 
 	return(ret_val);
@@ -38,6 +93,7 @@ static void _menu_execute(int sel)
 	case 0:
 		printf("1Pゲーム");
 		_state = GAME_STATE_SP;
+		input_reset();
 		game_init(1, 1);
 		break;
 
@@ -113,36 +169,65 @@ static void _game_over_handle_input(SDL_Event *ev)
 	return;
 }
 
+static input_action _key_action(SDL_Keycode key)
+{
+	switch(key) {
+	case SDLK_w:
+		return(INPUT_UP);
+
+	case SDLK_a:
+		return(INPUT_LEFT);
+
+	case SDLK_s:
+		return(INPUT_DOWN);
+
+	case SDLK_d:
+		return(INPUT_RIGHT);
+
+	case SDLK_e:
+		return(INPUT_BOMB);
+
+	default:
+		return(INPUT_NONE);
+	}
+}
+
 static void _game_handle_input_sp(SDL_Event *ev)
 {
+	input_action action;
+
 	switch(ev->key.keysym.sym) {
 	case SDLK_q:
 		_stop = 1;
 		break;
 
-	case SDLK_w:
-		/* move up */
-		game_player_move(0, 0, -1);
+	case SDLK_p:
+		_state = GAME_STATE_PAUSE;
 		break;
 
-	case SDLK_a:
-		/* move left */
-		game_player_move(0, -1, 0);
-		break;
+	default:
+		/* moves and bombs are queued and applied at the next tick */
+		action = _key_action(ev->key.keysym.sym);
+
+		if(action != INPUT_NONE) {
+			input_press(0, action, ev->key.timestamp);
+		}
 
-	case SDLK_s:
-		/* move down */
-		game_player_move(0, 0, 1);
 		break;
+	}
 
-	case SDLK_d:
-		/* move right */
-		game_player_move(0, 1, 0);
+	return;
+}
+
+static void _pause_handle_input(SDL_Event *ev)
+{
+	switch(ev->key.keysym.sym) {
+	case SDLK_q:
+		_stop = 1;
 		break;
 
-	case SDLK_e:
-		/* plant bomb */
-		game_player_action(0);
+	case SDLK_p:
+		_state = GAME_STATE_SP;
 		break;
 
 	default:
@@ -152,38 +237,118 @@ static void _game_handle_input_sp(SDL_Event *ev)
 	return;
 }
 
-static void _input(void)
+static void _handle_event(SDL_Event *ev)
 {
-	SDL_Event ev;
+	switch(ev->type) {
+	case SDL_QUIT:
+		_stop = 1;
+		return;
 
-	while(SDL_PollEvent(&ev)) {
-		switch(ev.type) {
-		case SDL_QUIT:
-			_stop = 1;
-			return;
-
-		case SDL_KEYUP:
-			switch(_state) {
-			case GAME_STATE_MENU:
-				_menu_handle_input(&ev);
-				break;
-
-			case GAME_STATE_SP:
-				_game_handle_input_sp(&ev);
-				break;
-
-			case GAME_STATE_END:
-				_game_over_handle_input(&ev);
-				break;
-
-			default:
-				break;
-			}
+	case SDL_KEYUP:
+		/*
+		 * Only needed to know which direction keys are still held, but in
+		 * every state: a key let go during the pause is up after it too.
+		 */
+		input_release(0, _key_action(ev->key.keysym.sym));
+		break;
+
+	case SDL_KEYDOWN:
+		/*
+		 * Acting on the press rather than the release saves the time the
+		 * key is held down. Key repeat scrolls the menu, but must not
+		 * pause and unpause or skip the game over screen.
+		 */
+		if(ev->key.repeat && _state != GAME_STATE_MENU) {
+			break;
+		}
+
+		switch(_state) {
+		case GAME_STATE_MENU:
+			_menu_handle_input(ev);
+			break;
+
+		case GAME_STATE_SP:
+			_game_handle_input_sp(ev);
+			break;
+
+		case GAME_STATE_PAUSE:
+			_pause_handle_input(ev);
+			break;
+
+		case GAME_STATE_END:
+			_game_over_handle_input(ev);
 			break;
 
 		default:
 			break;
 		}
+
+		_dirty = 1;
+		break;
+
+	case SDL_WINDOWEVENT:
+		/* exposed, resized, restored... */
+		_dirty = 1;
+		break;
+
+	default:
+		break;
+	}
+
+	return;
+}
+
+static void _input(void)
+{
+	TRACE_SCOPE("input");
+	SDL_Event ev;
+
+	while(SDL_PollEvent(&ev)) {
+		_handle_event(&ev);
+	}
+
+	return;
+}
+
+/* nothing moves in these states, so there's nothing to do until an event */
+static int _idle(void)
+{
+	return(_state == GAME_STATE_MENU ||
+		   _state == GAME_STATE_PAUSE ||
+		   _state == GAME_STATE_END);
+}
+
+static void _wait_input(void)
+{
+	TRACE_SCOPE("wait");
+	SDL_Event ev;
+
+	if(SDL_WaitEvent(&ev)) {
+		_handle_event(&ev);
+		_input();
+	}
+
+	return;
+}
+
+/* append the finished match to the file named by RECORD_ENV, if any */
+static void _record(void)
+{
+	match_record rec;
+	const char *path;
+	int err;
+
+	path = getenv(RECORD_ENV);
+
+	if(!path || !*path) {
+		return;
+	}
+
+	record_from_game(&rec);
+	err = record_append(path, &rec, 1);
+
+	if(err < 0) {
+		fprintf(stderr, "record_append: %s: %s\n", path, strerror(-err));
 	}
 
 	return;
@@ -191,19 +356,31 @@ static void _input(void)
 
 static void _process(void)
 {
+	TRACE_SCOPE("process");
+
 	if(_state != GAME_STATE_SP &&
 	   _state != GAME_STATE_MP) {
 		return;
 	}
 
+	input_apply(SDL_GetTicks());
 	game_logic();
+
+	if(game_is_over()) {
+		_state = GAME_STATE_END;
+		_record();
+	}
+
 	game_animate();
+	live_publish();
 
 	return;
 }
 
 static void _output(void)
 {
+	TRACE_SCOPE("output");
+
 	switch(_state) {
 	case GAME_STATE_MENU:
 		/* draw menu */
@@ -219,6 +396,9 @@ static void _output(void)
 		break;
 
 	case GAME_STATE_PAUSE:
+		gfx_draw_game();
+		gfx_draw_stats();
+		gfx_draw_paused();
 		break;
 
 	case GAME_STATE_END:
@@ -235,6 +415,7 @@ static void _output(void)
 	}
 
 	gfx_update_window();
+	input_presented(SDL_GetTicks());
 
 	return;
 }
@@ -243,7 +424,23 @@ int engine_run(void)
 {
 	unsigned elapsed;
 
+	_dirty = 1;
+
 	while(!_stop) {
+		if(_idle()) {
+			/* block instead of redrawing the same frame 60 times a second */
+			if(!_dirty) {
+				_wait_input();
+			}
+
+			if(_dirty && !_stop) {
+				_output();
+				_dirty = 0;
+			}
+
+			continue;
+		}
+
 		elapsed = SDL_GetTicks();
 
 		_input();
@@ -253,6 +450,8 @@ int engine_run(void)
 		elapsed = SDL_GetTicks() - elapsed;
 
 		if(elapsed < TICKS_PER_FRAME) {
+			TRACE_SCOPE("idle");
+
 			SDL_Delay(TICKS_PER_FRAME - elapsed);
 		}
 	}
@@ -262,7 +461,9 @@ int engine_run(void)
 
 int engine_quit(void)
 {
+	ai_stats stats;
 	int ret_val;
+	int err;
 
 	ret_val = gfx_quit();
 
@@ -271,6 +472,24 @@ int engine_quit(void)
 	}
 
 	/* perform remaining cleanup */
+	live_close();
+
+	/* BAKUDAN_LATENCY=1 prints how long inputs took to take effect */
+	if(getenv("BAKUDAN_LATENCY")) {
+		input_report(stderr);
+	}
+
+	ai_get_stats(&stats);
+
+	if(stats.overruns > 0) {
+		fprintf(stderr, "AIs went over their budget of %.1fms in %lu ticks, "
+				"taking up to %.1fms\n", AI_DEFAULT_BUDGET * 1e3,
+				stats.overruns, stats.worst_seconds * 1e3);
+	}
+
+	if((err = trace_stop()) < 0) {
+		fprintf(stderr, "trace_stop: %s\n", strerror(-err));
+	}
 
 	return(ret_val);
 }
@@ -278,5 +497,6 @@ int engine_quit(void)
 void engine_set_state(game_state state)
 {
 	_state = state;
+	_dirty = 1;
 	return;
 }
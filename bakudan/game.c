@@ -8,10 +8,22 @@
 #include <time.h>
 #include <pthread.h>
 #include "game.h"
-#include "engine.h"
+#ifndef HEADLESS
 #include "anim.h"
+#endif /* !HEADLESS */
 #include "ai.h"
+#include "spatial.h"
+#include "influence.h"
 #include "list.h"
+#include "rng.h"
+#include "mem.h"
+#include "trace.h"
+
+#ifdef HEADLESS
+#define LOG(...)
+#else /* HEADLESS */
+#define LOG printf
+#endif /* HEADLESS */
 
 player *players[MAX_PLAYERS];
 static int nplayers = 0;
@@ -19,6 +31,12 @@ object *objects[WIDTH][HEIGHT];
 static int alive_players;
 static anim_inst *anims;
 static int winner;
+static int over;
+static unsigned long ticks;
+static int seeded;
+static unsigned seed_value;
+static unsigned long generation;
+static uint32_t rng;
 
 static const char *_item_names[] = {
 	"BAG",
@@ -29,14 +47,6 @@ static const char *_item_names[] = {
 	"TIME"
 };
 
-#define IS_WALL(x,y)    (x == 0 || y == 0 || x == (WIDTH - 1) || y == (HEIGHT - 1))
-#define IS_PILLAR(x,y)  (x > 0 && y > 0 && (x % 2 == 0) && (y % 2 == 0))
-#define IS_SPAWN(x,y)   (!IS_WALL(x,y) && ((x <= 2 && y <= 2) || \
-										   ((x >= WIDTH - 3) && (y >= HEIGHT - 3)) || \
-										   (x <= 2 && (y >= HEIGHT - 3)) || \
-										   (x >= WIDTH - 3) && (y <= 2)))
-#define IS_BOULDER(x,y) (!IS_WALL(x,y) && !IS_PILLAR(x,y) && !IS_SPAWN(x,y))
-
 #define PLX(n) ((object*)players[n])->x
 #define PLY(n) ((object*)players[n])->y
 
@@ -51,6 +61,17 @@ static const char *_item_names[] = {
 		PLY(n) = (y);							\
 	} while(0)
 
+/* every change to the object table goes through here, see game_generation() */
+static void _set_object(const int x, const int y, object *o)
+{
+	objects[x][y] = o;
+	generation++;
+	spatial_set(x, y, o);
+	influence_changed(x, y);
+
+	return;
+}
+
 static object* make_object(object_type type, int x, int y)
 {
 	object *o;
@@ -74,7 +95,7 @@ static object* make_object(object_type type, int x, int y)
 		break;
 	}
 
-	o = malloc(s);
+	o = mem_alloc(MEM_OBJECT, s);
 
 	if(o) {
 		memset(o, 0, s);
@@ -105,7 +126,7 @@ static void drop_item(const int x, const int y)
 
 	type = game_ask_universe2(0, ITEM_TYPE_NUM);
 
-	printf("Item type: %d\n", type);
+	LOG("Item type: %d\n", type);
 
 	i = (item*)make_object(OBJECT_TYPE_ITEM, x, y);
 
@@ -142,7 +163,7 @@ static void drop_item(const int x, const int y)
 			break;
 		}
 
-		objects[x][y] = (object*)i;
+		_set_object(x, y, (object*)i);
 	}
 
 	return;
@@ -157,7 +178,7 @@ void drop_life(const int x, const int y)
 	if(i) {
 		i->type = ITEM_TYPE_LIFE;
 		i->lifes = 1;
-		objects[x][y] = (object*)i;
+		_set_object(x, y, (object*)i);
 	}
 
 	return;
@@ -167,9 +188,11 @@ void game_cleanup(void)
 {
 	int x, y;
 
+	ai_cleanup();
+
 	for(x = 0; x < MAX_PLAYERS; x++) {
 		if(players[x]) {
-			free(players[x]);
+			mem_free(MEM_PLAYER, players[x]);
 			players[x] = NULL;
 		}
 	}
@@ -177,8 +200,8 @@ void game_cleanup(void)
 	for(x = 0; x < WIDTH; x++) {
 		for(y = 0; y < HEIGHT; y++) {
 			if(objects[x][y]) {
-				free(objects[x][y]);
-				objects[x][y] = NULL;
+				mem_free(MEM_OBJECT, objects[x][y]);
+				_set_object(x, y, NULL);
 			}
 		}
 	}
@@ -199,9 +222,11 @@ int game_init(int humans, int cpus)
 	memset(&players, 0, sizeof(players));
 	anims = NULL;
 	winner = -1;
+	over = 0;
+	ticks = 0;
 
 	for(i = 0; i < n; i++) {
-		players[i] = malloc(sizeof(*players[i]));
+		players[i] = mem_alloc(MEM_PLAYER, sizeof(*players[i]));
 
 		if(!players[i]) {
 			ret_val = -ENOMEM;
@@ -257,6 +282,8 @@ int game_init(int humans, int cpus)
 	}
 
 	memset(&objects, 0, sizeof(objects));
+	generation++;
+	influence_reset();
 
 	for(x = 0; x < WIDTH; x++) {
 		for(y = 0; y < HEIGHT; y++) {
@@ -275,11 +302,13 @@ int game_init(int humans, int cpus)
 		}
 	}
 
+	spatial_reset();
+
 gtfo:
 	if(ret_val < 0) {
 		for(i = 0; i < MAX_PLAYERS; i++) {
 			if(players[i]) {
-				free(players[i]);
+				mem_free(MEM_PLAYER, players[i]);
 				players[i] = NULL;
 			}
 		}
@@ -317,8 +346,10 @@ int game_num_players(void)
 
 void game_animate(void)
 {
+#ifndef HEADLESS
 	anim_inst **pptr;
 	anim_inst *a;
+#endif /* !HEADLESS */
 	int n;
 
 	/* advance player movements */
@@ -339,6 +370,7 @@ void game_animate(void)
 		}
 	}
 
+#ifndef HEADLESS
 	/* advance animations */
 	for(a = anims; a; a = a->next) {
 		if(a->cfpf < 0) {
@@ -357,11 +389,12 @@ void game_animate(void)
 			free_me = *pptr;
 			*pptr = (*pptr)->next;
 
-			free(free_me);
+			mem_free(MEM_ANIM, free_me);
 		} else {
 			pptr = &((*pptr)->next);
 		}
 	}
+#endif /* !HEADLESS */
 
 	return;
 }
@@ -388,7 +421,7 @@ void game_player_move(const int p, const int dx, const int dy)
 {
 	int tx, ty;
 
-	printf("%s(%d, %d, %d)\n", __func__, p, dx, dy);
+	LOG("%s(%d, %d, %d)\n", __func__, p, dx, dy);
 
 	/* player is still moving from previous call */
 	if(players[p]->dx || players[p]->dy) {
@@ -431,25 +464,29 @@ void game_player_action(const int p)
 		o = make_object(OBJECT_TYPE_BOMB, px, py);
 
 		if(o) {
+#ifndef HEADLESS
 			anim_inst *a;
+#endif /* !HEADLESS */
 
 			((bomb*)o)->strength = players[p]->bomb_strength;
 			((bomb*)o)->timeout = players[p]->bomb_timeout * FPS;
 			((bomb*)o)->owner = p;
 
+#ifndef HEADLESS
 			/* add bomb animation */
 			a = anim_get_inst(ANIM_ABOMB, px, py);
 
 			if(a) {
 				/* animation should show for (players[p]->bomb_timeout * FPS) frames */
 				a->fpf = (players[p]->bomb_timeout * FPS) / (a->base->nframes - 1);
-				printf("Adding animation with %d fpf\n", a->fpf);
+				LOG("Adding animation with %d fpf\n", a->fpf);
 				/* add animation to global list */
 				a->next = anims;
 				anims = a;
 			}
+#endif /* !HEADLESS */
 
-			objects[px][py] = o;
+			_set_object(px, py, o);
 		}
 
 		players[p]->bombs--;
@@ -486,7 +523,7 @@ int bomb_strength_at(bomb *b, const int x, const int y)
 void player_damage(const int p, const int dmg, bomb *b)
 {
 	if(players[p]->health > 0) {
-		printf("Dealing %d dmg to player %d (newhp: %d)\n", dmg, p, players[p]->health - dmg);
+		LOG("Dealing %d dmg to player %d (newhp: %d)\n", dmg, p, players[p]->health - dmg);
 		players[p]->health -= dmg;
 		players[p]->attacker = b->owner;
 	}
@@ -499,7 +536,7 @@ void boulder_damage(object *o, const int dmg, bomb *b)
 	boulder *bld = (boulder*)o;
 
 	if(bld->strength > 0) {
-		printf("Dealing %d dmg to boulder (%d, %d) (newstr: %d)\n", dmg, o->x, o->y,
+		LOG("Dealing %d dmg to boulder (%d, %d) (newstr: %d)\n", dmg, o->x, o->y,
 			   bld->strength - dmg);
 		bld->strength -= dmg;
 		bld->attacker = b->owner;
@@ -515,10 +552,13 @@ anim_inst* game_get_anims(void)
 
 void bomb_detonate(bomb *b)
 {
-	anim_inst *a;
+	TRACE_SCOPE("bomb_detonate");
 	int tx, ty;
 	int i;
 
+#ifndef HEADLESS
+	anim_inst *a;
+
 	/* add explosion animation at the location of the bomb */
 	a = anim_get_inst(ANIM_EXPLOSION, obj_x(b), obj_y(b));
 
@@ -526,6 +566,7 @@ void bomb_detonate(bomb *b)
 		a->next = anims;
 		anims = a;
 	}
+#endif /* !HEADLESS */
 
 	/* check if a player is standing on the bomb */
 	for(i = 0; i < nplayers; i++) {
@@ -667,8 +708,12 @@ void bomb_detonate(bomb *b)
 
 void game_logic(void)
 {
+	TRACE_SCOPE("game_logic");
 	int x, y;
 
+	mem_tick();
+	ticks++;
+
 	for(x = 0; x < WIDTH; x++) {
 		for(y = 0; y < HEIGHT; y++) {
 			object *o;
@@ -710,12 +755,12 @@ void game_logic(void)
 
 					p = ((boulder*)o)->attacker;
 
-					free(o);
-					objects[x][y] = NULL;
+					mem_free(MEM_OBJECT, o);
+					_set_object(x, y, NULL);
 
 					/* decide whether to spawn an item */
 					if(game_ask_universe(players[p]->probability)) {
-						printf("Dropping item at (%d, %d)\n", x, y);
+						LOG("Dropping item at (%d, %d)\n", x, y);
 						drop_item(x, y);
 					}
 
@@ -728,8 +773,8 @@ void game_logic(void)
 					/* allow owner to spawn another bomb */
 					players[((bomb*)o)->owner]->bombs++;
 
-					free(o);
-					objects[x][y] = NULL;
+					mem_free(MEM_OBJECT, o);
+					_set_object(x, y, NULL);
 				}
 				break;
 
@@ -744,7 +789,7 @@ void game_logic(void)
 			object *o;
 
 			if(players[x]->health <= 0) {
-				printf("P%dがP%dを殺した\n", players[x]->attacker, x);
+				LOG("P%dがP%dを殺した\n", players[x]->attacker, x);
 
 				if(players[x]->attacker == x) {
 					players[x]->suicides++;
@@ -772,28 +817,28 @@ void game_logic(void)
 			o = objects[PLX(x)][PLY(x)];
 
 			if(o && o->type == OBJECT_TYPE_ITEM) {
-				printf("P%dが%sを拾った\n", x, _item_names[((item*)o)->type]);
+				LOG("P%dが%sを拾った\n", x, _item_names[((item*)o)->type]);
 
 				/* player x collects item */
-				objects[PLX(x)][PLY(x)] = NULL;
+				_set_object(PLX(x), PLY(x), NULL);
 
 				/* add stats from item */
-				printf("\tHP    : %d + %d\n", players[x]->health, ((item*)o)->health);
+				LOG("\tHP    : %d + %d\n", players[x]->health, ((item*)o)->health);
 				players[x]->health += ((item*)o)->health;
-				printf("\t弾    : %d + %d\n", players[x]->bombs, ((item*)o)->bombs);
+				LOG("\t弾    : %d + %d\n", players[x]->bombs, ((item*)o)->bombs);
 				players[x]->bombs += ((item*)o)->bombs;
-				printf("\t可能性: %d + %d\n", players[x]->probability, ((item*)o)->probability);
+				LOG("\t可能性: %d + %d\n", players[x]->probability, ((item*)o)->probability);
 				players[x]->probability += ((item*)o)->probability;
-				printf("\t爆力  : %d + %d\n", players[x]->bomb_strength, ((item*)o)->bomb_strength);
+				LOG("\t爆力  : %d + %d\n", players[x]->bomb_strength, ((item*)o)->bomb_strength);
 				players[x]->bomb_strength += ((item*)o)->bomb_strength;
-				printf("\t爆時  : %d + %d\n", players[x]->bomb_timeout, ((item*)o)->bomb_timeout);
+				LOG("\t爆時  : %d + %d\n", players[x]->bomb_timeout, ((item*)o)->bomb_timeout);
 				players[x]->bomb_timeout += ((item*)o)->bomb_timeout;
-				printf("\t命    : %d + %d\n", players[x]->lifes, ((item*)o)->lifes);
+				LOG("\t命    : %d + %d\n", players[x]->lifes, ((item*)o)->lifes);
 				players[x]->lifes += ((item*)o)->lifes;
 
 				players[x]->items++;
 
-				free(o);
+				mem_free(MEM_OBJECT, o);
 			}
 		}
 	}
@@ -808,19 +853,61 @@ void game_logic(void)
 			}
 		}
 
-		engine_set_state(GAME_STATE_END);
+		over = 1;
+		ai_trace_suicides();
 	} else {
+		influence_update();
 		ai_tick();
 	}
 
 	return;
 }
 
+void game_seed(const unsigned seed)
+{
+	rng = rng_seed(seed);
+	seed_value = seed;
+	seeded = 1;
+
+	return;
+}
+
+/* the seed passed to game_seed(), or 0 if the game isn't seeded */
+unsigned game_get_seed(void)
+{
+	return(seeded ? seed_value : 0);
+}
+
+unsigned game_rng_state(void)
+{
+	return(rng);
+}
+
+int game_is_over(void)
+{
+	return(over);
+}
+
+unsigned long game_ticks(void)
+{
+	return(ticks);
+}
+
+/* changes whenever an object is added to or removed from the field */
+unsigned long game_generation(void)
+{
+	return(generation);
+}
+
 int game_ask_universe(int prob)
 {
 	int fd;
 	unsigned char rnd;
 
+	if(seeded) {
+		return(rng_chance(&rng, prob));
+	}
+
 	fd = open("/dev/urandom", O_RDONLY);
 
 	if(fd >= 0) {
@@ -859,6 +946,10 @@ int game_ask_universe2(const int l, const int u)
 	int fd;
 	int rnd;
 
+	if(seeded) {
+		return(rng_range(&rng, l, u));
+	}
+
 	fd = open("/dev/urandom", O_RDONLY);
 
 	if(fd >= 0) {
@@ -901,34 +992,24 @@ int game_get_winner(void)
 
 int game_location_dangerous(const int x, const int y, const int tolerance)
 {
+	spatial_iter it;
+	object *o;
 	int dmg;
-	int i;
 
 	/* calculate the sum of all damage that will affect location (x, y) */
 
 	dmg = 0;
+	spatial_begin(&it, OBJECT_TYPE_BOMB, 1, y, WIDTH - 1, y);
 
-	for(i = 1; i < WIDTH; i++) {
-		object *o;
-
-		o = objects[i][y];
-
-		if(o && o->type == OBJECT_TYPE_BOMB) {
-			dmg += bomb_strength_at((bomb*)o, x, y);
-		}
+	while((o = spatial_next(&it))) {
+		dmg += bomb_strength_at((bomb*)o, x, y);
 	}
 
-	for(i = 1; i < HEIGHT; i++) {
-		object *o;
-
-		if(i == x) {
-			/* has already been checked in the previous loop */
-			continue;
-		}
-
-		o = objects[x][i];
+	spatial_begin(&it, OBJECT_TYPE_BOMB, x, 1, x, HEIGHT - 1);
 
-		if(o && o->type == OBJECT_TYPE_BOMB) {
+	while((o = spatial_next(&it))) {
+		/* has already been counted with the row */
+		if(obj_y(o) != y) {
 			dmg += bomb_strength_at((bomb*)o, x, y);
 		}
 	}
@@ -1,10 +1,20 @@
 #ifndef GAME_H
 #define GAME_H
 
+#ifdef HEADLESS
+typedef struct _anim_inst anim_inst;
+#else
 #include "anim.h"
+#endif
 
+/* larger fields can be built with -DWIDTH=... -DHEIGHT=..., both odd */
+#ifndef WIDTH
 #define WIDTH 17
+#endif
+
+#ifndef HEIGHT
 #define HEIGHT 17
+#endif
 
 #define FPS             60
 #define TICKS_PER_FRAME (1000 / FPS)
@@ -27,6 +37,14 @@
   Boulder: !wall && !pillar && !spawn
 */
 
+#define IS_WALL(x,y)    (x == 0 || y == 0 || x == (WIDTH - 1) || y == (HEIGHT - 1))
+#define IS_PILLAR(x,y)  (x > 0 && y > 0 && (x % 2 == 0) && (y % 2 == 0))
+#define IS_SPAWN(x,y)   (!IS_WALL(x,y) && ((x <= 2 && y <= 2) || \
+										   ((x >= WIDTH - 3) && (y >= HEIGHT - 3)) || \
+										   (x <= 2 && (y >= HEIGHT - 3)) || \
+										   (x >= WIDTH - 3) && (y <= 2)))
+#define IS_BOULDER(x,y) (!IS_WALL(x,y) && !IS_PILLAR(x,y) && !IS_SPAWN(x,y))
+
 #define PLAYER_DEFAULT_STRENGTH    2000
 #define PLAYER_DEFAULT_TIMEOUT     5
 #define PLAYER_DEFAULT_HEALTH      500
@@ -149,6 +167,12 @@ typedef struct {
 #define obj_y(o) (((object*)o)->y)
 
 int game_init(const int, const int);
+void game_seed(const unsigned);
+unsigned game_get_seed(void);
+unsigned game_rng_state(void);
+int game_is_over(void);
+unsigned long game_ticks(void);
+unsigned long game_generation(void);
 object* game_object_at(const int, const int);
 player* game_player_num(const int);
 int game_num_players(void);
@@ -167,5 +191,6 @@ void game_player_action(const int);
 void game_cleanup(void);
 anim_inst* game_get_anims(void);
 int game_location_dangerous(const int, const int, const int);
+int bomb_strength_at(bomb*, const int, const int);
 
 #endif /* GAME_H */
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <string.h>
+#include "game.h"
+#include "dist.h"
+
+/*
+ * Generates dist_table.c, the all-pairs shortest path table for the
+ * static layout described in game.h. Run at build time, see Makefile.
+ */
+
+#define CELLS (WIDTH * HEIGHT)
+
+static unsigned char _dist[CELLS];
+static int _queue[CELLS];
+
+static int _blocked(const int x, const int y)
+{
+	return(x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT ||
+		   IS_WALL(x, y) || IS_PILLAR(x, y));
+}
+
+static void _bfs(const int sx, const int sy)
+{
+	static const int dirs[4][2] = {
+		{  0, -1 },
+		{ -1,  0 },
+		{  1,  0 },
+		{  0,  1 }
+	};
+	int head, tail;
+
+	memset(_dist, DIST_INF, sizeof(_dist));
+
+	if(_blocked(sx, sy)) {
+		return;
+	}
+
+	head = 0;
+	tail = 0;
+
+	_dist[DIST_CELL(sx, sy)] = 0;
+	_queue[tail++] = DIST_CELL(sx, sy);
+
+	while(head < tail) {
+		int c, x, y, d;
+
+		c = _queue[head++];
+		x = c / HEIGHT;
+		y = c % HEIGHT;
+
+		for(d = 0; d < 4; d++) {
+			int tx, ty;
+
+			tx = x + dirs[d][0];
+			ty = y + dirs[d][1];
+
+			if(_blocked(tx, ty) || _dist[DIST_CELL(tx, ty)] != DIST_INF) {
+				continue;
+			}
+
+			_dist[DIST_CELL(tx, ty)] = _dist[c] + 1;
+			_queue[tail++] = DIST_CELL(tx, ty);
+		}
+	}
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	int x, y, c;
+
+	printf("/* generated by gendist, do not edit */\n"
+		   "#include \"dist.h\"\n"
+		   "\n"
+		   "#ifdef HAVE_DIST_TABLE\n"
+		   "\n"
+		   "const unsigned char dist_table[WIDTH * HEIGHT][WIDTH * HEIGHT] = {\n");
+
+#ifdef HAVE_DIST_TABLE
+	for(x = 0; x < WIDTH; x++) {
+		for(y = 0; y < HEIGHT; y++) {
+			_bfs(x, y);
+
+			printf("\t/* (%02d,%02d) */\n\t{", x, y);
+
+			for(c = 0; c < CELLS; c++) {
+				printf("%s%3d%s", c % 16 ? " " : "\n\t\t",
+					   _dist[c], c + 1 < CELLS ? "," : "\n\t");
+			}
+
+			printf("},\n");
+		}
+	}
+#endif /* HAVE_DIST_TABLE */
+
+	printf("};\n"
+		   "\n"
+		   "#endif /* HAVE_DIST_TABLE */\n");
+
+	return(0);
+}
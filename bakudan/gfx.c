@@ -7,6 +7,7 @@
 #include "gfx.h"
 #include "game.h"
 #include "anim.h"
+#include "trace.h"
 
 #define FONT_PATH   "/usr/share/fonts/opentype/ipafont-gothic/ipag.ttf"
 #define SFONT_SIZE  16
@@ -330,6 +331,7 @@ cleanup:
 
 int gfx_draw_menu(int selection)
 {
+	TRACE_SCOPE("gfx_draw_menu");
 	int ret_val;
     int i;
 
@@ -365,13 +367,14 @@ int gfx_draw_menu(int selection)
 		SDL_BlitSurface(_menu_sprites[i], NULL, _surface, &dst);
 	}
 
-	SDL_UpdateWindowSurface(_window);
+	/* presenting is up to the caller, see gfx_update_window() */
 
 	return(ret_val);
 }
 
 int gfx_draw_game(void)
 {
+	TRACE_SCOPE("gfx_draw_game");
 	anim_inst *a;
 	int ret_val;
 	int x, y;
@@ -493,6 +496,7 @@ int gfx_draw_game(void)
 
 void gfx_draw_stats(void)
 {
+	TRACE_SCOPE("gfx_draw_stats");
 	static SDL_Surface *header;
 	static SDL_Surface *header2;
 	SDL_Rect drect;
@@ -575,21 +579,18 @@ void gfx_draw_stats(void)
 
 void gfx_update_window(void)
 {
+	TRACE_SCOPE("gfx_update_window");
+
 	SDL_UpdateWindowSurface(_window);
 	return;
 }
 
-void gfx_draw_winner(void)
+/* a framed line of text in the middle of the window */
+static void _draw_banner(const char *str, SDL_Color color)
 {
-	int winner;
 	SDL_Surface *s;
-	char str[128];
-
-	winner = game_get_winner();
 
-	snprintf(str, sizeof(str), "%sの勝ちだ！＼（＾＿＾）／", _player_names[winner]);
-
-	s = TTF_RenderUTF8_Solid(_font, str, _player_color[winner]);
+	s = TTF_RenderUTF8_Solid(_font, str, color);
 
 	if(s) {
 		SDL_Rect drect;
@@ -622,3 +623,26 @@ void gfx_draw_winner(void)
 
 	return;
 }
+
+void gfx_draw_winner(void)
+{
+	TRACE_SCOPE("gfx_draw_winner");
+	int winner;
+	char str[128];
+
+	winner = game_get_winner();
+
+	snprintf(str, sizeof(str), "%sの勝ちだ！＼（＾＿＾）／", _player_names[winner]);
+	_draw_banner(str, _player_color[winner]);
+
+	return;
+}
+
+void gfx_draw_paused(void)
+{
+	TRACE_SCOPE("gfx_draw_paused");
+
+	_draw_banner("一時停止", _textcolor);
+
+	return;
+}
@@ -22,6 +22,7 @@ SDL_Surface* gfx_load_image(const char*);
 int gfx_draw_menu(int);
 int gfx_draw_game(void);
 void gfx_draw_winner(void);
+void gfx_draw_paused(void);
 void gfx_draw_stats(void);
 void gfx_update_window(void);
 void gfx_cleanup(void);
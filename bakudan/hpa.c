@@ -0,0 +1,1004 @@
+#include <string.h>
+#include <errno.h>
+#include "hpa.h"
+#include "trace.h"
+
+#define CLUSTERS (HPA_CLUSTERS_X * HPA_CLUSTERS_Y)
+#define RUNS     ((HPA_CLUSTER + 1) / 2)  /* entrances along a border at most */
+#define NODES    (4 * RUNS)               /* entrances of a cluster at most */
+#define GROUP    8                        /* cells of a border per entrance at most */
+#define FAR      0xffff
+#define COMPS    (HPA_SEGMENT_MAX / 2 + 1)  /* areas of a cluster at most, and 0 */
+
+#define NODE_START (CLUSTERS * NODES)
+#define NODE_GOAL  (NODE_START + 1)
+#define NODES_ALL  (NODE_GOAL + 1)
+
+/* the sides of a cluster, in the order its entrances are numbered */
+enum {
+	SIDE_TOP = 0,
+	SIDE_LEFT,
+	SIDE_RIGHT,
+	SIDE_BOTTOM,
+	SIDES
+};
+
+#define OPPOSITE(s) (SIDES - 1 - (s))
+
+struct border {
+	unsigned long scanned;     /* the repair that last looked at it */
+	int n;
+	unsigned char at[RUNS];    /* entrances, as offsets along the border */
+	unsigned char near[RUNS];  /* the areas they join, left of or above it */
+	unsigned char far[RUNS];
+};
+
+/*
+ * Entrance j on a side of a cluster has the slot side * RUNS + j, so the
+ * entrance across the border is known without looking at other borders.
+ */
+struct cluster {
+	int changed;               /* cells changed, on the list of changed clusters */
+	int stale;                 /* entrances changed, on the list of stale ones */
+	unsigned char comp[HPA_SEGMENT_MAX];  /* connected free cells, 0 if blocked */
+	int n;                     /* entrances */
+	unsigned char slot[NODES]; /* of the entrances */
+	short x[NODES];            /* by slot */
+	short y[NODES];
+	unsigned short dist[NODES][NODES];
+};
+
+static struct {
+	int valid;
+	unsigned long repairs;
+	struct border vert[HPA_CLUSTERS_X][HPA_CLUSTERS_Y];  /* right of a cluster */
+	struct border horz[HPA_CLUSTERS_X][HPA_CLUSTERS_Y];  /* below a cluster */
+	struct cluster cluster[HPA_CLUSTERS_X][HPA_CLUSTERS_Y];
+	int ncomp[CLUSTERS];       /* areas of each cluster */
+	int changed[CLUSTERS];
+	int nchanged;
+	int stale[CLUSTERS];
+	int nstale;
+	int regions;               /* the regions below are up to date */
+	int region[CLUSTERS * COMPS];  /* union-find over the areas of all clusters */
+} _hpa;
+
+/* a search inside a single cluster */
+static struct {
+	int x0;
+	int y0;
+	unsigned short d[HPA_SEGMENT_MAX];
+	short from[HPA_SEGMENT_MAX];   /* towards the source */
+	short queue[HPA_SEGMENT_MAX];
+} _bfs;
+
+/* the search over entrances; states carry the number of the search */
+static struct {
+	unsigned stamp;
+	unsigned seen[NODES_ALL];
+	int g[NODES_ALL];
+	int f[NODES_ALL];
+	int parent[NODES_ALL];
+	int pos[NODES_ALL];            /* in the heap, -1 once taken */
+	int heap[NODES_ALL];
+	int nheap;
+	unsigned short start[NODES];   /* from the start to its cluster's entrances */
+	unsigned short goal[NODES];    /* and from those of the goal's to the goal */
+} _search;
+
+#define LOCAL(x,y) (((x) - _bfs.x0) * HPA_CLUSTER + ((y) - _bfs.y0))
+
+static const int _dx[4] = { 0, -1, 1, 0 };
+static const int _dy[4] = { -1, 0, 0, 1 };
+
+static inline int _free(const int x, const int y)
+{
+	extern object *objects[WIDTH][HEIGHT];
+
+	return(!objects[x][y] || objects[x][y]->passable);
+}
+
+static inline int _cluster_of(const int x, const int y)
+{
+	return((x / HPA_CLUSTER) * HPA_CLUSTERS_Y + y / HPA_CLUSTER);
+}
+
+static inline struct cluster* _cluster(const int k)
+{
+	return(&(_hpa.cluster[k / HPA_CLUSTERS_Y][k % HPA_CLUSTERS_Y]));
+}
+
+static inline int _abs(const int a)
+{
+	return(a < 0 ? -a : a);
+}
+
+static void _changed(const int k)
+{
+	struct cluster *c;
+
+	c = _cluster(k);
+
+	if(!c->changed) {
+		c->changed = 1;
+		_hpa.changed[_hpa.nchanged++] = k;
+	}
+
+	return;
+}
+
+static void _stale(const int k)
+{
+	struct cluster *c;
+
+	c = _cluster(k);
+
+	if(!c->stale) {
+		c->stale = 1;
+		_hpa.stale[_hpa.nstale++] = k;
+	}
+
+	return;
+}
+
+/* the whole field changed, work it all out again on the next search */
+void hpa_reset(void)
+{
+	_hpa.valid = 0;
+	return;
+}
+
+/* call whenever the object at (x, y) changed */
+void hpa_changed(const int x, const int y)
+{
+	if(_hpa.valid && x >= 0 && y >= 0 && x < WIDTH && y < HEIGHT) {
+		_changed(_cluster_of(x, y));
+	}
+
+	return;
+}
+
+/* the border on a side of a cluster, NULL at the edge of the field */
+static struct border* _side(const int cx, const int cy, const int side)
+{
+	switch(side) {
+	case SIDE_TOP:
+		return(cy > 0 ? &(_hpa.horz[cx][cy - 1]) : NULL);
+
+	case SIDE_LEFT:
+		return(cx > 0 ? &(_hpa.vert[cx - 1][cy]) : NULL);
+
+	case SIDE_RIGHT:
+		return(cx < HPA_CLUSTERS_X - 1 ? &(_hpa.vert[cx][cy]) : NULL);
+
+	case SIDE_BOTTOM:
+		return(cy < HPA_CLUSTERS_Y - 1 ? &(_hpa.horz[cx][cy]) : NULL);
+
+	default:
+		return(NULL);
+	}
+}
+
+/* the entrance across the border, as a node of the search */
+static int _node_partner(const int k, const int slot)
+{
+	static const int dk[SIDES] = {
+		-1, -HPA_CLUSTERS_Y, HPA_CLUSTERS_Y, 1
+	};
+	int side;
+
+	side = slot / RUNS;
+
+	return((k + dk[side]) * NODES + OPPOSITE(side) * RUNS + slot % RUNS);
+}
+
+/* number the areas of free cells of a cluster that are connected inside it */
+static void _cluster_label(const int cx, const int cy)
+{
+	struct cluster *c;
+	int x1, y1;
+	int i, n;
+
+	c = &(_hpa.cluster[cx][cy]);
+	_bfs.x0 = cx * HPA_CLUSTER;
+	_bfs.y0 = cy * HPA_CLUSTER;
+	x1 = _bfs.x0 + HPA_CLUSTER < WIDTH ? _bfs.x0 + HPA_CLUSTER : WIDTH;
+	y1 = _bfs.y0 + HPA_CLUSTER < HEIGHT ? _bfs.y0 + HPA_CLUSTER : HEIGHT;
+
+	memset(c->comp, 0, sizeof(c->comp));
+	memset(_bfs.d, 0, sizeof(_bfs.d));
+
+	for(n = 0, i = 0; i < HPA_SEGMENT_MAX; i++) {
+		int x, y, head, tail;
+
+		x = _bfs.x0 + i / HPA_CLUSTER;
+		y = _bfs.y0 + i % HPA_CLUSTER;
+
+		if(_bfs.d[i] || x >= x1 || y >= y1 || !_free(x, y)) {
+			continue;
+		}
+
+		n++;
+		head = 0;
+		tail = 0;
+		_bfs.d[i] = 1;
+		_bfs.queue[tail++] = i;
+
+		while(head < tail) {
+			int l, d;
+
+			l = _bfs.queue[head++];
+			c->comp[l] = n;
+			x = _bfs.x0 + l / HPA_CLUSTER;
+			y = _bfs.y0 + l % HPA_CLUSTER;
+
+			for(d = 0; d < 4; d++) {
+				int nx, ny;
+
+				nx = x + _dx[d];
+				ny = y + _dy[d];
+
+				if(nx < _bfs.x0 || ny < _bfs.y0 || nx >= x1 || ny >= y1 ||
+				   _bfs.d[LOCAL(nx, ny)] || !_free(nx, ny)) {
+					continue;
+				}
+
+				_bfs.d[LOCAL(nx, ny)] = 1;
+				_bfs.queue[tail++] = LOCAL(nx, ny);
+			}
+		}
+	}
+
+	_hpa.ncomp[cx * HPA_CLUSTERS_Y + cy] = n;
+
+	return;
+}
+
+/*
+ * Entrances of the border to the right of (vertical) or below a cluster.
+ * Crossings that lead from the same area of free cells on this side to
+ * the same one on the other are grouped, and every group of up to GROUP
+ * cells gets an entrance at the crossing closest to its middle. Any path
+ * across the border can take the entrance of its crossing's group
+ * instead, so none are lost, and the graph stays small on fields like
+ * this one, where pillars leave a crossing at every other cell. Returns
+ * whether the entrances moved.
+ */
+static int _border_scan(struct border *b, const int cx, const int cy, const int vertical)
+{
+	const struct cluster *near, *far;
+	unsigned char old[RUNS];
+	int at[HPA_CLUSTER];
+	int key[HPA_CLUSTER];
+	int len, o, n, i, was;
+
+	near = &(_hpa.cluster[cx][cy]);
+
+	if(vertical) {
+		far = &(_hpa.cluster[cx + 1][cy]);
+		len = HEIGHT - cy * HPA_CLUSTER;
+	} else {
+		far = &(_hpa.cluster[cx][cy + 1]);
+		len = WIDTH - cx * HPA_CLUSTER;
+	}
+
+	if(len > HPA_CLUSTER) {
+		len = HPA_CLUSTER;
+	}
+
+	for(n = 0, o = 0; o < len; o++) {
+		int a, c;
+
+		if(vertical) {
+			a = near->comp[(HPA_CLUSTER - 1) * HPA_CLUSTER + o];
+			c = far->comp[o];
+		} else {
+			a = near->comp[o * HPA_CLUSTER + HPA_CLUSTER - 1];
+			c = far->comp[o * HPA_CLUSTER];
+		}
+
+		if(a && c) {
+			at[n] = o;
+			key[n++] = (a << 8) | c;
+		}
+	}
+
+	was = b->n;
+	memcpy(old, b->at, sizeof(old));
+	b->n = 0;
+	b->scanned = _hpa.repairs;
+
+	for(i = 0; i < n; i++) {
+		int first, last, best, j;
+
+		if(key[i] < 0) {
+			continue;
+		}
+
+		first = i;
+		last = i;
+
+		for(j = i + 1; j < n && at[j] - at[first] < GROUP; j++) {
+			if(key[j] == key[first]) {
+				last = j;
+			}
+		}
+
+		/* the crossing closest to the middle, then the whole group is done */
+		for(best = first, j = first; j <= last; j++) {
+			if(key[j] == key[first] &&
+			   _abs(2 * at[j] - at[first] - at[last]) <
+			   _abs(2 * at[best] - at[first] - at[last])) {
+				best = j;
+			}
+		}
+
+		if(b->n < RUNS) {
+			b->at[b->n] = at[best];
+			b->near[b->n] = key[best] >> 8;
+			b->far[b->n++] = key[best] & 0xff;
+		}
+
+		for(j = last; j > first; j--) {
+			if(key[j] == key[first]) {
+				key[j] = -1;
+			}
+		}
+	}
+
+	return(b->n != was || memcmp(old, b->at, b->n));
+}
+
+/*
+ * Breadth-first search from (sx, sy) over the free cells of a cluster.
+ * The source and (ax, ay) may be entered even if they aren't free: where
+ * a player stands, or a goal that is only to be reached.
+ */
+static void _bfs_run(const int cx, const int cy, const int sx, const int sy,
+					 const int ax, const int ay)
+{
+	int x1, y1;
+	int head, tail;
+
+	_bfs.x0 = cx * HPA_CLUSTER;
+	_bfs.y0 = cy * HPA_CLUSTER;
+	x1 = _bfs.x0 + HPA_CLUSTER < WIDTH ? _bfs.x0 + HPA_CLUSTER : WIDTH;
+	y1 = _bfs.y0 + HPA_CLUSTER < HEIGHT ? _bfs.y0 + HPA_CLUSTER : HEIGHT;
+
+	memset(_bfs.d, 0xff, sizeof(_bfs.d));
+
+	head = 0;
+	tail = 0;
+	_bfs.d[LOCAL(sx, sy)] = 0;
+	_bfs.from[LOCAL(sx, sy)] = LOCAL(sx, sy);
+	_bfs.queue[tail++] = LOCAL(sx, sy);
+
+	while(head < tail) {
+		int c, x, y, i;
+
+		c = _bfs.queue[head++];
+		x = _bfs.x0 + c / HPA_CLUSTER;
+		y = _bfs.y0 + c % HPA_CLUSTER;
+
+		for(i = 0; i < 4; i++) {
+			int nx, ny, n;
+
+			nx = x + _dx[i];
+			ny = y + _dy[i];
+
+			if(nx < _bfs.x0 || ny < _bfs.y0 || nx >= x1 || ny >= y1) {
+				continue;
+			}
+
+			n = LOCAL(nx, ny);
+
+			if(_bfs.d[n] != FAR || (!_free(nx, ny) && !(nx == ax && ny == ay))) {
+				continue;
+			}
+
+			_bfs.d[n] = _bfs.d[c] + 1;
+			_bfs.from[n] = c;
+			_bfs.queue[tail++] = n;
+		}
+	}
+
+	return;
+}
+
+/* the entrances of a cluster and the distances between them */
+static void _cluster_update(const int cx, const int cy)
+{
+	struct cluster *c;
+	int side, i, j;
+
+	c = &(_hpa.cluster[cx][cy]);
+	c->n = 0;
+
+	for(side = 0; side < SIDES; side++) {
+		struct border *b;
+
+		if(!(b = _side(cx, cy, side))) {
+			continue;
+		}
+
+		for(j = 0; j < b->n; j++) {
+			int slot;
+
+			slot = side * RUNS + j;
+			c->slot[c->n++] = slot;
+
+			if(side == SIDE_TOP || side == SIDE_BOTTOM) {
+				c->x[slot] = cx * HPA_CLUSTER + b->at[j];
+				c->y[slot] = cy * HPA_CLUSTER + (side == SIDE_TOP ? 0 : HPA_CLUSTER - 1);
+			} else {
+				c->x[slot] = cx * HPA_CLUSTER + (side == SIDE_LEFT ? 0 : HPA_CLUSTER - 1);
+				c->y[slot] = cy * HPA_CLUSTER + b->at[j];
+			}
+		}
+	}
+
+	for(i = 0; i < c->n; i++) {
+		int a;
+
+		a = c->slot[i];
+		_bfs_run(cx, cy, c->x[a], c->y[a], -1, -1);
+
+		for(j = 0; j < c->n; j++) {
+			int b;
+
+			b = c->slot[j];
+			c->dist[a][b] = _bfs.d[LOCAL(c->x[b], c->y[b])];
+		}
+	}
+
+	c->stale = 0;
+
+	return;
+}
+
+static int _region_find(int r)
+{
+	while(_hpa.region[r] != r) {
+		_hpa.region[r] = _hpa.region[_hpa.region[r]];
+		r = _hpa.region[r];
+	}
+
+	return(r);
+}
+
+/* the region of an entrance: where it leads, however far */
+static inline int _region(const int k, const int slot)
+{
+	const struct cluster *c;
+	int x, y;
+
+	c = _cluster(k);
+	x = c->x[slot] % HPA_CLUSTER;
+	y = c->y[slot] % HPA_CLUSTER;
+
+	return(_region_find(k * COMPS + c->comp[x * HPA_CLUSTER + y]));
+}
+
+/* the areas on both sides of each entrance of a border */
+static void _regions_join(const struct border *b, const int k, const int l)
+{
+	int j;
+
+	for(j = 0; j < b->n; j++) {
+		int r, q;
+
+		r = _region_find(k * COMPS + b->near[j]);
+		q = _region_find(l * COMPS + b->far[j]);
+
+		if(r != q) {
+			_hpa.region[r] = q;
+		}
+	}
+
+	return;
+}
+
+/*
+ * Join the areas of all clusters across their entrances, so a search
+ * without a path can fail right away instead of trying every entrance
+ * it can reach first.
+ */
+static void _regions(void)
+{
+	TRACE_SCOPE("hpa_regions");
+	int k, i;
+
+	int cx, cy;
+
+	for(k = 0; k < CLUSTERS; k++) {
+		for(i = 0; i <= _hpa.ncomp[k]; i++) {
+			_hpa.region[k * COMPS + i] = k * COMPS + i;
+		}
+	}
+
+	for(cx = 0; cx < HPA_CLUSTERS_X; cx++) {
+		for(cy = 0; cy < HPA_CLUSTERS_Y; cy++) {
+			k = cx * HPA_CLUSTERS_Y + cy;
+
+			if(cx < HPA_CLUSTERS_X - 1) {
+				_regions_join(&(_hpa.vert[cx][cy]), k, k + HPA_CLUSTERS_Y);
+			}
+
+			if(cy < HPA_CLUSTERS_Y - 1) {
+				_regions_join(&(_hpa.horz[cx][cy]), k, k + 1);
+			}
+		}
+	}
+
+	_hpa.regions = 1;
+
+	return;
+}
+
+/* work out what changed since the last search, or everything the first time */
+static void _repair(void)
+{
+	TRACE_SCOPE("hpa_repair");
+	int i, s;
+
+	if(!_hpa.valid) {
+		memset(&_hpa, 0, sizeof(_hpa));
+		_hpa.valid = 1;
+
+		for(i = 0; i < CLUSTERS; i++) {
+			_changed(i);
+		}
+	}
+
+	if(!_hpa.nchanged) {
+		return;
+	}
+
+	_hpa.repairs++;
+
+	for(i = 0; i < _hpa.nchanged; i++) {
+		_cluster_label(_hpa.changed[i] / HPA_CLUSTERS_Y, _hpa.changed[i] % HPA_CLUSTERS_Y);
+	}
+
+	/* then their borders, and the clusters across those whose entrances moved */
+	for(i = 0; i < _hpa.nchanged; i++) {
+		int cx, cy;
+
+		cx = _hpa.changed[i] / HPA_CLUSTERS_Y;
+		cy = _hpa.changed[i] % HPA_CLUSTERS_Y;
+
+		for(s = 0; s < SIDES; s++) {
+			struct border *b;
+
+			if(!(b = _side(cx, cy, s)) || b->scanned == _hpa.repairs) {
+				continue;
+			}
+
+			if(s == SIDE_TOP) {
+				if(_border_scan(b, cx, cy - 1, 0)) {
+					_stale(_cluster_of(cx * HPA_CLUSTER, (cy - 1) * HPA_CLUSTER));
+				}
+			} else if(s == SIDE_LEFT) {
+				if(_border_scan(b, cx - 1, cy, 1)) {
+					_stale(_cluster_of((cx - 1) * HPA_CLUSTER, cy * HPA_CLUSTER));
+				}
+			} else if(s == SIDE_RIGHT) {
+				if(_border_scan(b, cx, cy, 1)) {
+					_stale(_cluster_of((cx + 1) * HPA_CLUSTER, cy * HPA_CLUSTER));
+				}
+			} else {
+				if(_border_scan(b, cx, cy, 0)) {
+					_stale(_cluster_of(cx * HPA_CLUSTER, (cy + 1) * HPA_CLUSTER));
+				}
+			}
+		}
+
+		_stale(_hpa.changed[i]);
+		_cluster(_hpa.changed[i])->changed = 0;
+	}
+
+	for(i = 0; i < _hpa.nstale; i++) {
+		_cluster_update(_hpa.stale[i] / HPA_CLUSTERS_Y, _hpa.stale[i] % HPA_CLUSTERS_Y);
+	}
+
+	_hpa.nchanged = 0;
+	_hpa.nstale = 0;
+	_hpa.regions = 0;
+
+	return;
+}
+
+/* the heap of the search over entrances, by f and then the larger g */
+static inline int _before(const int a, const int b)
+{
+	return(_search.f[a] < _search.f[b] ||
+		   (_search.f[a] == _search.f[b] && _search.g[a] > _search.g[b]));
+}
+
+static void _heap_up(int i)
+{
+	int n;
+
+	n = _search.heap[i];
+
+	while(i > 0 && _before(n, _search.heap[(i - 1) / 2])) {
+		_search.heap[i] = _search.heap[(i - 1) / 2];
+		_search.pos[_search.heap[i]] = i;
+		i = (i - 1) / 2;
+	}
+
+	_search.heap[i] = n;
+	_search.pos[n] = i;
+
+	return;
+}
+
+static int _heap_pop(void)
+{
+	int top, n, i;
+
+	top = _search.heap[0];
+	_search.pos[top] = -1;
+	n = _search.heap[--_search.nheap];
+	i = 0;
+
+	while(_search.nheap > 0) {
+		int c;
+
+		c = 2 * i + 1;
+
+		if(c >= _search.nheap) {
+			break;
+		}
+
+		if(c + 1 < _search.nheap && _before(_search.heap[c + 1], _search.heap[c])) {
+			c++;
+		}
+
+		if(!_before(_search.heap[c], n)) {
+			break;
+		}
+
+		_search.heap[i] = _search.heap[c];
+		_search.pos[_search.heap[i]] = i;
+		i = c;
+	}
+
+	if(_search.nheap > 0) {
+		_search.heap[i] = n;
+		_search.pos[n] = i;
+	}
+
+	return(top);
+}
+
+/*
+ * The distance to the goal counts an eighth more than it is, so the
+ * search doesn't spread over every way around the boulders that looks as
+ * short. That keeps it several times faster, and the paths at most an
+ * eighth longer than the shortest one over the entrances.
+ */
+static void _relax(const int from, const int to, const int cost, const int dx, const int dy)
+{
+	int g;
+
+	g = _search.g[from] + cost;
+
+	if(_search.seen[to] != _search.stamp) {
+		struct cluster *c;
+		int h;
+
+		if(to == NODE_GOAL) {
+			h = 0;
+		} else {
+			c = _cluster(to / NODES);
+			h = _abs(c->x[to % NODES] - dx) + _abs(c->y[to % NODES] - dy);
+			h += h / 8;
+		}
+
+		_search.seen[to] = _search.stamp;
+		_search.g[to] = g;
+		_search.f[to] = g + h;
+		_search.parent[to] = from;
+		_search.heap[_search.nheap] = to;
+		_heap_up(_search.nheap++);
+	} else if(g < _search.g[to] && _search.pos[to] >= 0) {
+		_search.f[to] += g - _search.g[to];
+		_search.g[to] = g;
+		_search.parent[to] = from;
+		_heap_up(_search.pos[to]);
+	}
+
+	return;
+}
+
+/* A* over the entrances, between the start and the goal nodes */
+static int _search_ways(const int sx, const int sy, const int dx, const int dy)
+{
+	int ks, kg;
+	int u, i;
+
+	ks = _cluster_of(sx, sy);
+	kg = _cluster_of(dx, dy);
+
+	if(++_search.stamp == 0) {
+		memset(_search.seen, 0, sizeof(_search.seen));
+		_search.stamp = 1;
+	}
+
+	_search.nheap = 0;
+	_search.seen[NODE_START] = _search.stamp;
+	_search.g[NODE_START] = 0;
+	_search.f[NODE_START] = _abs(sx - dx) + _abs(sy - dy);
+	_search.parent[NODE_START] = -1;
+	_search.heap[_search.nheap] = NODE_START;
+	_heap_up(_search.nheap++);
+
+	while(_search.nheap > 0) {
+		struct cluster *c;
+		int k, a;
+
+		u = _heap_pop();
+
+		if(u == NODE_GOAL) {
+			return(_search.g[u]);
+		}
+
+		if(u == NODE_START) {
+			c = _cluster(ks);
+
+			for(i = 0; i < c->n; i++) {
+				a = c->slot[i];
+
+				if(_search.start[a] != FAR) {
+					_relax(u, ks * NODES + a, _search.start[a], dx, dy);
+				}
+			}
+
+			continue;
+		}
+
+		k = u / NODES;
+		a = u % NODES;
+		c = _cluster(k);
+
+		_relax(u, _node_partner(k, a), 1, dx, dy);
+
+		for(i = 0; i < c->n; i++) {
+			unsigned short d;
+			int b;
+
+			b = c->slot[i];
+
+			if(b != a && (d = c->dist[a][b]) != FAR) {
+				_relax(u, k * NODES + b, d, dx, dy);
+			}
+		}
+
+		if(k == kg && _search.goal[a] != FAR) {
+			_relax(u, NODE_GOAL, _search.goal[a], dx, dy);
+		}
+	}
+
+	return(-ENOENT);
+}
+
+/* whether any entrance the start reaches leads to one the goal is reached from */
+static int _connected(const int ks, const int kg)
+{
+	const struct cluster *s, *g;
+	int i, j;
+
+	if(!_hpa.regions) {
+		_regions();
+	}
+
+	s = _cluster(ks);
+	g = _cluster(kg);
+
+	for(i = 0; i < s->n; i++) {
+		int r;
+
+		if(_search.start[s->slot[i]] == FAR) {
+			continue;
+		}
+
+		r = _region(ks, s->slot[i]);
+
+		for(j = 0; j < g->n; j++) {
+			if(_search.goal[g->slot[j]] != FAR && _region(kg, g->slot[j]) == r) {
+				return(1);
+			}
+		}
+	}
+
+	return(0);
+}
+
+/*
+ * A path from (sx, sy) to (dx, dy), not counting the start. If opts is
+ * set, the destination may be a cell that can't be entered, and the path
+ * ends next to it, like with ai_find_path(). The steps are taken with
+ * hpa_next_step(). Returns the number of steps or a negative error number.
+ */
+int hpa_find_path(const int sx, const int sy, const int dx, const int dy,
+				  const int opts, hpa_path *path)
+{
+	TRACE_SCOPE("hpa_find_path");
+	struct cluster *c;
+	int n, u, i;
+	int cx, cy;
+
+	if(sx < 0 || sy < 0 || dx < 0 || dy < 0 ||
+	   sx >= WIDTH || sy >= HEIGHT || dx >= WIDTH || dy >= HEIGHT) {
+		return(-EINVAL);
+	}
+
+	path->opts = opts;
+	path->nways = 0;
+	path->way = 0;
+	path->nsteps = 0;
+	path->step = 0;
+	path->x = sx;
+	path->y = sy;
+	path->length = 0;
+
+	if(sx == dx && sy == dy) {
+		return(0);
+	}
+
+	if(!opts && !_free(dx, dy)) {
+		return(-ENOENT);
+	}
+
+	_repair();
+
+	/* from the goal to the entrances of its cluster, and maybe to the start */
+	cx = dx / HPA_CLUSTER;
+	cy = dy / HPA_CLUSTER;
+	c = &(_hpa.cluster[cx][cy]);
+	_bfs_run(cx, cy, dx, dy, sx, sy);
+
+	for(i = 0; i < c->n; i++) {
+		int a;
+
+		a = c->slot[i];
+		_search.goal[a] = _bfs.d[LOCAL(c->x[a], c->y[a])];
+	}
+
+	if(_cluster_of(sx, sy) == _cluster_of(dx, dy) && _bfs.d[LOCAL(sx, sy)] != FAR) {
+		path->length = _bfs.d[LOCAL(sx, sy)] - (opts ? 1 : 0);
+		path->wx[0] = dx;
+		path->wy[0] = dy;
+		path->nways = 1;
+
+		return(path->length);
+	}
+
+	cx = sx / HPA_CLUSTER;
+	cy = sy / HPA_CLUSTER;
+	c = &(_hpa.cluster[cx][cy]);
+	_bfs_run(cx, cy, sx, sy, -1, -1);
+
+	for(i = 0; i < c->n; i++) {
+		int a;
+
+		a = c->slot[i];
+		_search.start[a] = _bfs.d[LOCAL(c->x[a], c->y[a])];
+	}
+
+	if(!_connected(_cluster_of(sx, sy), _cluster_of(dx, dy))) {
+		return(-ENOENT);
+	}
+
+	if((n = _search_ways(sx, sy, dx, dy)) < 0) {
+		return(n);
+	}
+
+	/* count the entrances on the way, then write them front to back */
+	for(n = 0, u = _search.parent[NODE_GOAL]; u != NODE_START; u = _search.parent[u]) {
+		n++;
+	}
+
+	if(n + 1 > HPA_WAYS_MAX) {
+		return(-E2BIG);
+	}
+
+	path->nways = n + 1;
+	path->wx[n] = dx;
+	path->wy[n] = dy;
+
+	for(u = _search.parent[NODE_GOAL]; u != NODE_START; u = _search.parent[u]) {
+		n--;
+		c = _cluster(u / NODES);
+		path->wx[n] = c->x[u % NODES];
+		path->wy[n] = c->y[u % NODES];
+	}
+
+	path->length = _search.g[NODE_GOAL] - (opts ? 1 : 0);
+
+	return(path->length);
+}
+
+/* the steps to the next waypoint, by a search inside its cluster */
+static int _refine(hpa_path *path)
+{
+	TRACE_SCOPE("hpa_refine");
+	int wx, wy, last;
+	int c;
+
+	wx = path->wx[path->way];
+	wy = path->wy[path->way];
+	last = path->way == path->nways - 1;
+	path->way++;
+	path->nsteps = 0;
+	path->step = 0;
+
+	if(wx == path->x && wy == path->y) {
+		return(0);
+	}
+
+	if(_cluster_of(wx, wy) != _cluster_of(path->x, path->y)) {
+		/* across a border */
+		if(_abs(wx - path->x) + _abs(wy - path->y) != 1 ||
+		   (!_free(wx, wy) && !(last && path->opts))) {
+			return(-ENOENT);
+		}
+
+		path->sx[0] = wx;
+		path->sy[0] = wy;
+		path->nsteps = 1;
+	} else {
+		if(!_free(wx, wy) && !(last && path->opts)) {
+			return(-ENOENT);
+		}
+
+		/* from the waypoint, so that the way back leads there */
+		_bfs_run(wx / HPA_CLUSTER, wy / HPA_CLUSTER, wx, wy, path->x, path->y);
+		c = LOCAL(path->x, path->y);
+
+		if(_bfs.d[c] == FAR) {
+			return(-ENOENT);
+		}
+
+		while(_bfs.d[c] > 0) {
+			c = _bfs.from[c];
+			path->sx[path->nsteps] = _bfs.x0 + c / HPA_CLUSTER;
+			path->sy[path->nsteps] = _bfs.y0 + c % HPA_CLUSTER;
+			path->nsteps++;
+		}
+	}
+
+	if(last && path->opts) {
+		path->nsteps--;
+	}
+
+	return(0);
+}
+
+/*
+ * The next step of a path in (x, y). Returns 1, 0 once the path ended,
+ * or -ENOENT if the field changed in the way; then search again.
+ */
+int hpa_next_step(hpa_path *path, int *x, int *y)
+{
+	int err;
+
+	while(path->step >= path->nsteps) {
+		if(path->way >= path->nways) {
+			return(0);
+		}
+
+		if((err = _refine(path)) < 0) {
+			return(err);
+		}
+	}
+
+	*x = path->sx[path->step];
+	*y = path->sy[path->step];
+	path->step++;
+	path->x = *x;
+	path->y = *y;
+
+	return(1);
+}
@@ -0,0 +1,65 @@
+#ifndef HPA_H
+#define HPA_H
+
+#include "game.h"
+
+/*
+ * Hierarchical path search for large fields
+ *
+ * The field is cut into square clusters of HPA_CLUSTER cells. Where free
+ * cells of two neighboring clusters meet along their border, a few of
+ * those crossings are entrances, enough that every area of free cells on
+ * one side still leads to every area it touches on the other, and the
+ * distances between the entrances of each cluster are kept. A search then
+ * runs over the entrances only, with the start and the goal joined to
+ * those of their clusters by searches inside the cluster. The path is
+ * refined into steps one cluster at a time while it's walked, so a search
+ * costs about the same no matter how far away the goal is, and one that
+ * can't reach it fails right away.
+ *
+ * Every change to the field has to be passed to hpa_changed(), which
+ * marks the cluster the cell belongs to, or to hpa_reset() if the field
+ * was set up from scratch. Before the next search, marked clusters and
+ * their borders are worked out again, and so are the clusters across
+ * borders whose entrances moved; the rest of them is kept. Until the
+ * first search nothing is kept, and hpa_changed() returns right away.
+ *
+ * A path is found whenever there is one, but it's a few percent longer
+ * than the shortest one, an eighth at most over the entrances. Like
+ * ai_find_path(), this is not thread-safe.
+ *
+ * The game doesn't use it: the AI only runs on fields that fit an
+ * ai_path, where the flat searches are faster. For now it's built into
+ * hpabench only, on a field of its own.
+ */
+
+#define HPA_CLUSTER 16
+
+#define HPA_CLUSTERS_X ((WIDTH + HPA_CLUSTER - 1) / HPA_CLUSTER)
+#define HPA_CLUSTERS_Y ((HEIGHT + HPA_CLUSTER - 1) / HPA_CLUSTER)
+
+/* border crossings a path may have; it can pass a cluster more than once */
+#define HPA_WAYS_MAX    (4 * HPA_CLUSTERS_X * HPA_CLUSTERS_Y + 2)
+#define HPA_SEGMENT_MAX (HPA_CLUSTER * HPA_CLUSTER)
+
+typedef struct {
+	int length;                  /* steps in all */
+	int opts;                    /* the path ends next to the goal */
+	int nways;                   /* where the path crosses clusters, and its end */
+	int way;                     /* the waypoint the steps lead to */
+	short wx[HPA_WAYS_MAX];
+	short wy[HPA_WAYS_MAX];
+	int nsteps;                  /* refined steps to the waypoint */
+	int step;                    /* the next one of them */
+	short sx[HPA_SEGMENT_MAX];
+	short sy[HPA_SEGMENT_MAX];
+	int x;                       /* where the steps so far lead */
+	int y;
+} hpa_path;
+
+void hpa_reset(void);
+void hpa_changed(const int, const int);
+int hpa_find_path(const int, const int, const int, const int, const int, hpa_path*);
+int hpa_next_step(hpa_path*, int*, int*);
+
+#endif /* HPA_H */
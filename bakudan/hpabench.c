@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "game.h"
+#include "hpa.h"
+#include "rng.h"
+#include "tool.h"
+
+/*
+ * Benchmark for hpa_find_path on a large field
+ *
+ * On the field of tool.h, searches between random free cells are timed
+ * against a breadth-first search over the whole field, which also tells
+ * how much longer the paths are than the shortest ones. Every path is
+ * walked step by step to check it. Then a boulder is moved, and maybe
+ * another one cleared, before every search, to time searches after
+ * repairs.
+ */
+
+object *objects[WIDTH][HEIGHT];
+
+static int _dist[WIDTH * HEIGHT];
+static int _queue[WIDTH * HEIGHT];
+static hpa_path _path;
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+		   "\n"
+		   "  -n num  searches (default: 1000)\n"
+		   "  -b num  percentage of boulders (default: 10)\n"
+		   "  -s num  seed of the field (default: 1)\n",
+		   argv0);
+
+	return;
+}
+
+/* the flat search, until the goal is reached */
+static int _bfs(const int sx, const int sy, const int dx, const int dy)
+{
+	static const int ox[4] = { 0, -1, 1, 0 };
+	static const int oy[4] = { -1, 0, 0, 1 };
+	int head, tail;
+
+	memset(_dist, 0xff, sizeof(_dist));
+
+	head = 0;
+	tail = 0;
+	_dist[sx * HEIGHT + sy] = 0;
+	_queue[tail++] = sx * HEIGHT + sy;
+
+	while(head < tail) {
+		int c, x, y, i;
+
+		c = _queue[head++];
+		x = c / HEIGHT;
+		y = c % HEIGHT;
+
+		if(x == dx && y == dy) {
+			return(_dist[c]);
+		}
+
+		for(i = 0; i < 4; i++) {
+			int nx, ny;
+
+			nx = x + ox[i];
+			ny = y + oy[i];
+
+			if(objects[nx][ny] || _dist[nx * HEIGHT + ny] >= 0) {
+				continue;
+			}
+
+			_dist[nx * HEIGHT + ny] = _dist[c] + 1;
+			_queue[tail++] = nx * HEIGHT + ny;
+		}
+	}
+
+	return(-1);
+}
+
+/* take all steps of the path, returns 0 if it's fine */
+static int _walk(const int sx, const int sy, const int dx, const int dy, const int length)
+{
+	int x, y, nx, ny;
+	int steps, n;
+
+	x = sx;
+	y = sy;
+	steps = 0;
+
+	while((n = hpa_next_step(&_path, &nx, &ny)) > 0) {
+		if(abs(nx - x) + abs(ny - y) != 1 || objects[nx][ny]) {
+			return(-1);
+		}
+
+		x = nx;
+		y = ny;
+		steps++;
+	}
+
+	return(n < 0 || x != dx || y != dy || steps != length ? -1 : 0);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long flat_len, hpa_len;
+	double start, build, flat, hier, walk, repair;
+	int searches, boulders, found, errors;
+	int *qx, *qy;
+	uint32_t rng;
+	unsigned seed;
+	int opt;
+	int x, y, i;
+	int bx, by;
+
+	searches = 1000;
+	boulders = 10;
+	seed = 1;
+
+	while((opt = getopt(argc, argv, "n:b:s:h")) != -1) {
+		switch(opt) {
+		case 'n':
+			searches = atoi(optarg);
+			break;
+
+		case 'b':
+			boulders = atoi(optarg);
+			break;
+
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if(searches < 1) {
+		_usage(argv[0]);
+		return(1);
+	}
+
+	rng = rng_seed(seed);
+
+	tool_field(&rng, boulders);
+
+	qx = malloc(2 * searches * sizeof(*qx));
+	qy = malloc(2 * searches * sizeof(*qy));
+
+	if(!qx || !qy) {
+		fprintf(stderr, "Out of memory\n");
+		return(1);
+	}
+
+	for(i = 0; i < 2 * searches; i++) {
+		tool_random_free(&rng, &qx[i], &qy[i]);
+	}
+
+	printf("%dx%d field, %d%% boulders, %dx%d clusters of %d cells\n",
+		   WIDTH, HEIGHT, boulders, HPA_CLUSTERS_X, HPA_CLUSTERS_Y, HPA_CLUSTER);
+
+	hpa_reset();
+	start = tool_now();
+	hpa_find_path(qx[0], qy[0], qx[1], qy[1], 0, &_path);
+	build = tool_now() - start;
+
+	flat_len = 0;
+	found = 0;
+	start = tool_now();
+
+	for(i = 0; i < searches; i++) {
+		int n;
+
+		if((n = _bfs(qx[2 * i], qy[2 * i], qx[2 * i + 1], qy[2 * i + 1])) >= 0) {
+			flat_len += n;
+			found++;
+		}
+	}
+
+	flat = tool_now() - start;
+
+	printf("first search, which sets up all clusters: %.2fms\n", build * 1e3);
+	printf("breadth-first search: %d paths found, %.1fus per search\n",
+		   found, flat * 1e6 / searches);
+
+	hpa_len = 0;
+	found = 0;
+	errors = 0;
+	hier = 0;
+	walk = 0;
+
+	for(i = 0; i < searches; i++) {
+		int n;
+
+		start = tool_now();
+		n = hpa_find_path(qx[2 * i], qy[2 * i], qx[2 * i + 1], qy[2 * i + 1], 0, &_path);
+		hier += tool_now() - start;
+
+		if(n < 0) {
+			/* both have to agree on whether there is a path */
+			errors += _bfs(qx[2 * i], qy[2 * i], qx[2 * i + 1], qy[2 * i + 1]) >= 0;
+			continue;
+		}
+
+		hpa_len += n;
+		found++;
+
+		start = tool_now();
+		errors += _walk(qx[2 * i], qy[2 * i], qx[2 * i + 1], qy[2 * i + 1], n) < 0;
+		walk += tool_now() - start;
+	}
+
+	printf("hierarchical search: %d paths found, %.1fus per search, %.2f%% longer\n",
+		   found, hier * 1e6 / searches,
+		   flat_len ? 100.0 * hpa_len / flat_len - 100.0 : 0.0);
+	printf("refining while walking: %.1fus per path, %d wrong paths\n",
+		   found ? walk * 1e6 / found : 0.0, errors);
+
+	/* maybe a boulder less, and the moved one somewhere else, before every search */
+	repair = 0;
+	errors = 0;
+	bx = -1;
+	by = -1;
+
+	for(i = 0; i < searches; i++) {
+		int sx, sy, dx, dy, n;
+
+		do {
+			x = rng_range(&rng, 1, WIDTH - 2);
+			y = rng_range(&rng, 1, HEIGHT - 2);
+		} while(IS_PILLAR(x, y));
+
+		if(objects[x][y] == tool_object(OBJECT_TYPE_BOULDER)) {
+			objects[x][y] = NULL;
+			hpa_changed(x, y);
+		}
+
+		/* only one at a time, or the boulders fill small fields up */
+		if(bx >= 0) {
+			objects[bx][by] = NULL;
+			hpa_changed(bx, by);
+		}
+
+		tool_random_free(&rng, &bx, &by);
+		objects[bx][by] = tool_object(OBJECT_TYPE_BOULDER);
+		hpa_changed(bx, by);
+
+		tool_random_free(&rng, &sx, &sy);
+		tool_random_free(&rng, &dx, &dy);
+
+		start = tool_now();
+		n = hpa_find_path(sx, sy, dx, dy, 0, &_path);
+		repair += tool_now() - start;
+
+		if(n < 0 ? _bfs(sx, sy, dx, dy) >= 0 : _walk(sx, sy, dx, dy, n) < 0) {
+			errors++;
+		}
+	}
+
+	printf("after a change: %.1fus per search, %d wrong paths\n",
+		   repair * 1e6 / searches, errors);
+
+	free(qx);
+	free(qy);
+
+	return(errors ? 1 : 0);
+}
@@ -0,0 +1,358 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "game.h"
+#include "influence.h"
+#include "rng.h"
+#include "tool.h"
+
+/*
+ * Benchmark for the influence maps on a large field
+ *
+ * Four players start close enough together in the middle of the field of
+ * tool.h to fight over the cells in between. Then they take a step every
+ * 32 ticks or so, like in the game, and die and come back now and then.
+ * Within the horizon of one of them, a boulder is cleared or dropped or
+ * a bomb comes or goes in half of the ticks. Every tick's
+ * influence_update() is timed, and every so often the maps of all
+ * players are checked against ones built from scratch by a plain search
+ * over buckets of steps, down to the owners, the contested cells and the
+ * territories.
+ */
+
+#define CELLS (WIDTH * HEIGHT)
+#define AREA  (2 * INFLUENCE_HORIZON * (INFLUENCE_HORIZON + 1) + 1)
+
+object *objects[WIDTH][HEIGHT];
+player *players[MAX_PLAYERS];
+
+static player _players[MAX_PLAYERS];
+
+static unsigned short _ref[MAX_PLAYERS][CELLS];
+static int _bucket[INFLUENCE_HORIZON + 1][5 * AREA];
+static int _fill[INFLUENCE_HORIZON + 1];
+
+int game_num_players(void)
+{
+	return(MAX_PLAYERS);
+}
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+		   "\n"
+		   "  -n num  ticks (default: 20000)\n"
+		   "  -b num  percentage of boulders (default: 30)\n"
+		   "  -c num  ticks between checks (default: 50)\n"
+		   "  -s num  seed of the field (default: 1)\n",
+		   argv0);
+
+	return;
+}
+
+static int _cost(const int x, const int y)
+{
+	object *o;
+
+	o = objects[x][y];
+
+	if(!o || o->passable) {
+		return(1);
+	}
+
+	return(o->type == OBJECT_TYPE_BOULDER ? 1 + INFLUENCE_BOULDER_STEPS : -1);
+}
+
+/* the map of player p the plain way, a search over buckets of steps */
+static void _reference(const int p)
+{
+	static const int ox[4] = { 0, -1, 1, 0 };
+	static const int oy[4] = { -1, 0, 0, 1 };
+	int d, i;
+
+	if(!players[p]->alive) {
+		return;
+	}
+
+	memset(_fill, 0, sizeof(_fill));
+	_ref[p][obj_x(players[p]) * HEIGHT + obj_y(players[p])] = 0;
+	_bucket[0][_fill[0]++] = obj_x(players[p]) * HEIGHT + obj_y(players[p]);
+
+	for(d = 0; d <= INFLUENCE_HORIZON; d++) {
+		for(i = 0; i < _fill[d]; i++) {
+			int c, x, y, j;
+
+			c = _bucket[d][i];
+
+			if(_ref[p][c] != d) {
+				continue;
+			}
+
+			x = c / HEIGHT;
+			y = c % HEIGHT;
+
+			for(j = 0; j < 4; j++) {
+				int n, k;
+
+				n = (x + ox[j]) * HEIGHT + y + oy[j];
+				k = _cost(x + ox[j], y + oy[j]);
+
+				if(k > 0 && d + k <= INFLUENCE_HORIZON && d + k < _ref[p][n]) {
+					_ref[p][n] = d + k;
+					_bucket[d + k][_fill[d + k]++] = n;
+				}
+			}
+		}
+	}
+
+	return;
+}
+
+/* compare everything there is to ask about every cell, returns the mismatches */
+static int _check(void)
+{
+	int territory[MAX_PLAYERS];
+	int errors, c, p;
+
+	memset(_ref, 0xff, sizeof(_ref));
+	memset(territory, 0, sizeof(territory));
+	errors = 0;
+
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		_reference(p);
+	}
+
+	for(c = 0; c < CELLS; c++) {
+		int best, second, owner;
+
+		best = 0xffff;
+		second = 0xffff;
+		owner = -1;
+
+		for(p = 0; p < MAX_PLAYERS; p++) {
+			if(influence_reach(p, c / HEIGHT, c % HEIGHT) !=
+			   (_ref[p][c] == 0xffff ? -1 : _ref[p][c])) {
+				errors++;
+			}
+
+			if(_ref[p][c] < best) {
+				second = best;
+				best = _ref[p][c];
+				owner = p;
+			} else if(_ref[p][c] < second) {
+				second = _ref[p][c];
+			}
+		}
+
+		if(best == 0xffff || best == second) {
+			owner = -1;
+		} else {
+			territory[owner]++;
+		}
+
+		if(influence_owner(c / HEIGHT, c % HEIGHT) != owner ||
+		   influence_contested(c / HEIGHT, c % HEIGHT) !=
+		   (second != 0xffff && second - best <= INFLUENCE_CONTEST)) {
+			errors++;
+		}
+	}
+
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		errors += influence_territory(p) != territory[p];
+	}
+
+	return(errors);
+}
+
+static void _set(const int x, const int y, object *o)
+{
+	if(x > 0 && y > 0 && x < WIDTH - 1 && y < HEIGHT - 1 &&
+	   !IS_WALL(x, y) && !IS_PILLAR(x, y)) {
+		objects[x][y] = o;
+		influence_changed(x, y);
+	}
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	double start, t, total, worst, full;
+	int ticks, boulders, every, errors, checks;
+	int changes, moves, deaths;
+	object *boulder, *bomb;
+	uint32_t rng;
+	unsigned seed;
+	int opt;
+	int x, y, i, p;
+
+	ticks = 20000;
+	boulders = 30;
+	every = 50;
+	seed = 1;
+
+	while((opt = getopt(argc, argv, "n:b:c:s:h")) != -1) {
+		switch(opt) {
+		case 'n':
+			ticks = atoi(optarg);
+			break;
+
+		case 'b':
+			boulders = atoi(optarg);
+			break;
+
+		case 'c':
+			every = atoi(optarg);
+			break;
+
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if(ticks < 1 || every < 1) {
+		_usage(argv[0]);
+		return(1);
+	}
+
+	rng = rng_seed(seed);
+
+	tool_field(&rng, boulders);
+	boulder = tool_object(OBJECT_TYPE_BOULDER);
+	bomb = tool_object(OBJECT_TYPE_BOMB);
+
+	/* close enough to each other to fight over the cells in between */
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		players[p] = &_players[p];
+
+		do {
+			tool_random_free(&rng, &x, &y);
+		} while(x < WIDTH / 2 - INFLUENCE_HORIZON || x > WIDTH / 2 + INFLUENCE_HORIZON ||
+				y < HEIGHT / 2 - INFLUENCE_HORIZON || y > HEIGHT / 2 + INFLUENCE_HORIZON);
+
+		obj_x(players[p]) = x;
+		obj_y(players[p]) = y;
+		players[p]->alive = 1;
+	}
+
+	printf("%dx%d field, %d%% boulders, horizon of %d steps\n",
+		   WIDTH, HEIGHT, boulders, INFLUENCE_HORIZON);
+
+	influence_acquire();
+	influence_reset();
+	start = tool_now();
+	influence_update();
+	full = tool_now() - start;
+
+	total = 0;
+	worst = 0;
+	errors = 0;
+	checks = 0;
+	changes = 0;
+	moves = 0;
+	deaths = 0;
+
+	for(i = 0; i < ticks; i++) {
+		for(p = 0; p < MAX_PLAYERS; p++) {
+			player *pl;
+			int nx, ny;
+
+			pl = players[p];
+
+			if(!pl->alive) {
+				if(rng_chance(&rng, 2)) {
+					pl->alive = 1;
+				}
+
+				continue;
+			}
+
+			if(rng_range(&rng, 0, 1000) < 2) {
+				pl->alive = 0;
+				deaths++;
+				continue;
+			}
+
+			/* a step every 32 ticks or so, like in the game */
+			if(rng_range(&rng, 0, 32)) {
+				continue;
+			}
+
+			nx = obj_x(pl) + rng_range(&rng, -1, 2);
+			ny = obj_y(pl) + rng_range(&rng, -1, 2);
+
+			if((nx == obj_x(pl) || ny == obj_y(pl)) &&
+			   (!objects[nx][ny] || objects[nx][ny]->passable)) {
+				obj_x(pl) = nx;
+				obj_y(pl) = ny;
+				moves++;
+			}
+		}
+
+		/* around one of the players, where it matters */
+		p = rng_range(&rng, 0, MAX_PLAYERS);
+		x = obj_x(players[p]) + rng_range(&rng, -INFLUENCE_HORIZON, INFLUENCE_HORIZON + 1);
+		y = obj_y(players[p]) + rng_range(&rng, -INFLUENCE_HORIZON, INFLUENCE_HORIZON + 1);
+
+		switch(rng_range(&rng, 0, 8)) {
+		case 0:
+			_set(x, y, objects[x][y] == boulder ? NULL : objects[x][y]);
+			changes++;
+			break;
+
+		case 1:
+			_set(x, y, objects[x][y] ? objects[x][y] : boulder);
+			changes++;
+			break;
+
+		case 2:
+			_set(x, y, objects[x][y] ? objects[x][y] : bomb);
+			changes++;
+			break;
+
+		case 3:
+			_set(x, y, objects[x][y] == bomb ? NULL : objects[x][y]);
+			changes++;
+			break;
+
+		default:
+			break;
+		}
+
+		start = tool_now();
+		influence_update();
+		t = tool_now() - start;
+		total += t;
+
+		if(t > worst) {
+			worst = t;
+		}
+
+		if(!((i + 1) % every)) {
+			errors += _check();
+			checks++;
+		}
+	}
+
+	printf("from scratch:  %.1f us\n", full * 1e6);
+	printf("per update:    %.2f us average, %.1f us at most\n",
+		   total * 1e6 / ticks, worst * 1e6);
+	printf("%d ticks, %d steps, %d deaths, %d changes to the field\n",
+		   ticks, moves, deaths, changes);
+	printf("territory:    ");
+
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		printf(" %d", influence_territory(p));
+	}
+
+	printf("\n%d checks, %d wrong\n", checks, errors);
+	influence_release();
+
+	return(errors ? 1 : 0);
+}
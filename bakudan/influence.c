@@ -0,0 +1,564 @@
+#include <string.h>
+#include "influence.h"
+#include "trace.h"
+
+#define CELLS      (WIDTH * HEIGHT)
+#define CELL(x,y)  ((x) * HEIGHT + (y))
+#define FAR        0xffff
+#define BLOCKED    0xff
+
+/* tiles within the horizon of one, and entries of a search over them */
+#define AREA       (2 * INFLUENCE_HORIZON * (INFLUENCE_HORIZON + 1) + 1)
+#define ENTRIES    (5 * AREA + 1)
+
+/* changed tiles kept until the next update; more start over */
+#define PENDING_MAX 256
+
+extern player *players[MAX_PLAYERS];
+
+struct entry {
+	int cell;
+	int next;  /* next entry in the same bucket, plus one */
+};
+
+static struct {
+	int valid;
+	unsigned char cost[CELLS];          /* of stepping onto a tile */
+	unsigned short reach[MAX_PLAYERS][CELLS];
+	int sx[MAX_PLAYERS];                /* where each map is from, -1 if nowhere */
+	int sy[MAX_PLAYERS];
+	signed char owner[CELLS];           /* -1 for nobody */
+	unsigned char contested[CELLS];
+	int territory[MAX_PLAYERS];
+	int pending[PENDING_MAX];
+	int npending;
+	unsigned char is_pending[CELLS];
+	unsigned char is_dirty[CELLS];      /* the owner has to be worked out again */
+	int dirty[CELLS];
+	int ndirty;
+} _inf;
+
+static int _users;  /* the maps are only kept while this isn't 0 */
+
+/* the search, a queue of buckets by steps like the one of ai_find_path() */
+static struct {
+	int bucket[INFLUENCE_HORIZON + 1];  /* first entry plus one, 0 if empty */
+	struct entry entry[ENTRIES];
+	int entries;
+	int first;                          /* no bucket before this one has entries */
+	unsigned stamp;
+	unsigned seen[CELLS];
+	int affected[AREA];
+} _q;
+
+static const int _dx[4] = { 0, -1, 1, 0 };
+static const int _dy[4] = { -1, 0, 0, 1 };
+
+static int _cost(const int x, const int y)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	object *o;
+
+	o = objects[x][y];
+
+	if(!o || o->passable) {
+		return(1);
+	}
+
+	return(o->type == OBJECT_TYPE_BOULDER ? 1 + INFLUENCE_BOULDER_STEPS : BLOCKED);
+}
+
+static inline int _near(const int p, const int x, const int y)
+{
+	int dx, dy;
+
+	dx = x - _inf.sx[p];
+	dy = y - _inf.sy[p];
+
+	return(_inf.sx[p] >= 0 &&
+		   (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy) <= INFLUENCE_HORIZON);
+}
+
+static void _dirty(const int c)
+{
+	if(!_inf.is_dirty[c]) {
+		_inf.is_dirty[c] = 1;
+		_inf.dirty[_inf.ndirty++] = c;
+	}
+
+	return;
+}
+
+static inline void _set(const int p, const int c, const int d)
+{
+	_inf.reach[p][c] = d;
+	_dirty(c);
+
+	return;
+}
+
+static void _push(const int c, const int d)
+{
+	struct entry *e;
+
+	e = &(_q.entry[_q.entries++]);
+	e->cell = c;
+	e->next = _q.bucket[d];
+	_q.bucket[d] = _q.entries;
+
+	if(d < _q.first) {
+		_q.first = d;
+	}
+
+	return;
+}
+
+static void _queue_clear(void)
+{
+	memset(_q.bucket, 0, sizeof(_q.bucket));
+	_q.entries = 0;
+	_q.first = INFLUENCE_HORIZON + 1;
+
+	return;
+}
+
+/* take the queue in order of steps, lowering what can be lowered */
+static void _search(const int p)
+{
+	unsigned short *r;
+
+	r = _inf.reach[p];
+
+	for(; _q.first <= INFLUENCE_HORIZON; _q.first++) {
+		while(_q.bucket[_q.first]) {
+			struct entry *e;
+			int c, x, y, i;
+
+			e = &(_q.entry[_q.bucket[_q.first] - 1]);
+			_q.bucket[_q.first] = e->next;
+			c = e->cell;
+
+			/* lowered again since it was queued */
+			if(r[c] != _q.first) {
+				continue;
+			}
+
+			x = c / HEIGHT;
+			y = c % HEIGHT;
+
+			for(i = 0; i < 4; i++) {
+				int nx, ny, n, d;
+
+				nx = x + _dx[i];
+				ny = y + _dy[i];
+
+				if(nx < 0 || ny < 0 || nx >= WIDTH || ny >= HEIGHT) {
+					continue;
+				}
+
+				n = CELL(nx, ny);
+
+				if(_inf.cost[n] == BLOCKED) {
+					continue;
+				}
+
+				d = _q.first + _inf.cost[n];
+
+				if(d <= INFLUENCE_HORIZON && d < r[n]) {
+					_set(p, n, d);
+					_push(n, d);
+				}
+			}
+		}
+	}
+
+	return;
+}
+
+/* the map of player p from scratch, around wherever the player is now */
+static void _rebuild(const int p)
+{
+	player *pl;
+	int x, y;
+
+	if(_inf.sx[p] >= 0) {
+		for(x = _inf.sx[p] - INFLUENCE_HORIZON; x <= _inf.sx[p] + INFLUENCE_HORIZON; x++) {
+			for(y = _inf.sy[p] - INFLUENCE_HORIZON; y <= _inf.sy[p] + INFLUENCE_HORIZON; y++) {
+				if(x >= 0 && y >= 0 && x < WIDTH && y < HEIGHT &&
+				   _inf.reach[p][CELL(x, y)] != FAR) {
+					_set(p, CELL(x, y), FAR);
+				}
+			}
+		}
+	}
+
+	pl = players[p];
+	_inf.sx[p] = -1;
+	_inf.sy[p] = -1;
+
+	if(!pl || !pl->alive) {
+		return;
+	}
+
+	_inf.sx[p] = obj_x(pl);
+	_inf.sy[p] = obj_y(pl);
+
+	_queue_clear();
+	_set(p, CELL(obj_x(pl), obj_y(pl)), 0);
+	_push(CELL(obj_x(pl), obj_y(pl)), 0);
+	_search(p);
+
+	return;
+}
+
+/* the tile c got cheaper to step onto */
+static void _lower(const int p, const int c)
+{
+	unsigned short *r;
+	int x, y, i, best;
+
+	r = _inf.reach[p];
+	x = c / HEIGHT;
+	y = c % HEIGHT;
+
+	if(_inf.cost[c] == BLOCKED) {
+		return;
+	}
+
+	for(best = FAR, i = 0; i < 4; i++) {
+		int nx, ny;
+
+		nx = x + _dx[i];
+		ny = y + _dy[i];
+
+		if(nx >= 0 && ny >= 0 && nx < WIDTH && ny < HEIGHT &&
+		   r[CELL(nx, ny)] + _inf.cost[c] < best) {
+			best = r[CELL(nx, ny)] + _inf.cost[c];
+		}
+	}
+
+	if(best > INFLUENCE_HORIZON || best >= r[c]) {
+		return;
+	}
+
+	_queue_clear();
+	_set(p, c, best);
+	_push(c, best);
+	_search(p);
+
+	return;
+}
+
+/*
+ * The tile c got dearer to step onto. Every tile whose steps may have
+ * been counted through it, the ones that follow it on a shortest path,
+ * is forgotten; they're queued with the steps from their neighbors that
+ * are still known, and the search takes it from there.
+ */
+static void _raise(const int p, const int c)
+{
+	unsigned short *r;
+	int n, i, j;
+
+	r = _inf.reach[p];
+
+	if(r[c] == FAR || r[c] == 0) {
+		return;
+	}
+
+	if(++_q.stamp == 0) {
+		memset(_q.seen, 0, sizeof(_q.seen));
+		_q.stamp = 1;
+	}
+
+	n = 0;
+	_q.seen[c] = _q.stamp;
+	_q.affected[n++] = c;
+
+	for(i = 0; i < n; i++) {
+		int x, y, u;
+
+		u = _q.affected[i];
+		x = u / HEIGHT;
+		y = u % HEIGHT;
+
+		for(j = 0; j < 4; j++) {
+			int nx, ny, v;
+
+			nx = x + _dx[j];
+			ny = y + _dy[j];
+
+			if(nx < 0 || ny < 0 || nx >= WIDTH || ny >= HEIGHT) {
+				continue;
+			}
+
+			v = CELL(nx, ny);
+
+			if(_q.seen[v] != _q.stamp && r[v] != FAR && r[v] != 0 &&
+			   r[v] == r[u] + _inf.cost[v]) {
+				_q.seen[v] = _q.stamp;
+				_q.affected[n++] = v;
+			}
+		}
+	}
+
+	for(i = 0; i < n; i++) {
+		_set(p, _q.affected[i], FAR);
+	}
+
+	_queue_clear();
+
+	for(i = 0; i < n; i++) {
+		int x, y, u, best;
+
+		u = _q.affected[i];
+
+		if(_inf.cost[u] == BLOCKED) {
+			continue;
+		}
+
+		x = u / HEIGHT;
+		y = u % HEIGHT;
+
+		for(best = FAR, j = 0; j < 4; j++) {
+			int nx, ny;
+
+			nx = x + _dx[j];
+			ny = y + _dy[j];
+
+			if(nx >= 0 && ny >= 0 && nx < WIDTH && ny < HEIGHT &&
+			   r[CELL(nx, ny)] + _inf.cost[u] < best) {
+				best = r[CELL(nx, ny)] + _inf.cost[u];
+			}
+		}
+
+		if(best <= INFLUENCE_HORIZON) {
+			_set(p, u, best);
+			_push(u, best);
+		}
+	}
+
+	_search(p);
+
+	return;
+}
+
+/* who gets to tile c first, and whether someone else is close behind */
+static void _own(const int c)
+{
+	int best, second, who, owner, p;
+
+	best = FAR;
+	second = FAR;
+	who = -1;
+
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		int r;
+
+		r = _inf.reach[p][c];
+
+		if(r < best) {
+			second = best;
+			best = r;
+			who = p;
+		} else if(r < second) {
+			second = r;
+		}
+	}
+
+	owner = best != FAR && second != best ? who : -1;
+
+	if(owner != _inf.owner[c]) {
+		if(_inf.owner[c] >= 0) {
+			_inf.territory[_inf.owner[c]]--;
+		}
+
+		if(owner >= 0) {
+			_inf.territory[owner]++;
+		}
+
+		_inf.owner[c] = owner;
+	}
+
+	_inf.contested[c] = second != FAR && second - best <= INFLUENCE_CONTEST;
+
+	return;
+}
+
+/* start keeping the maps, from the next update on */
+void influence_acquire(void)
+{
+	_users++;
+	return;
+}
+
+/* stop keeping them once nobody uses them anymore */
+void influence_release(void)
+{
+	if(_users > 0 && --_users == 0) {
+		_inf.valid = 0;
+	}
+
+	return;
+}
+
+/* the whole field changed, start over on the next update */
+void influence_reset(void)
+{
+	_inf.valid = 0;
+	return;
+}
+
+/* call whenever the object at (x, y) changed */
+void influence_changed(const int x, const int y)
+{
+	int c;
+
+	if(!_inf.valid || x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) {
+		return;
+	}
+
+	c = CELL(x, y);
+
+	if(_inf.is_pending[c]) {
+		return;
+	}
+
+	if(_inf.npending == PENDING_MAX) {
+		/* cheaper to start over than to keep track */
+		_inf.valid = 0;
+		return;
+	}
+
+	_inf.is_pending[c] = 1;
+	_inf.pending[_inf.npending++] = c;
+
+	return;
+}
+
+/* bring the maps up to date with the field and where the players are */
+void influence_update(void)
+{
+	TRACE_SCOPE("influence_update");
+	int moved[MAX_PLAYERS];
+	int p, i;
+
+	if(!_users) {
+		return;
+	}
+
+	if(!_inf.valid) {
+		int x, y;
+
+		memset(&_inf, 0, sizeof(_inf));
+		memset(_inf.reach, 0xff, sizeof(_inf.reach));
+		memset(_inf.owner, 0xff, sizeof(_inf.owner));
+
+		for(x = 0; x < WIDTH; x++) {
+			for(y = 0; y < HEIGHT; y++) {
+				_inf.cost[CELL(x, y)] = _cost(x, y);
+			}
+		}
+
+		for(p = 0; p < MAX_PLAYERS; p++) {
+			_inf.sx[p] = -1;
+			_inf.sy[p] = -1;
+		}
+
+		_inf.valid = 1;
+	}
+
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		player *pl;
+
+		pl = p < game_num_players() ? players[p] : NULL;
+
+		if(pl && pl->alive) {
+			moved[p] = obj_x(pl) != _inf.sx[p] || obj_y(pl) != _inf.sy[p];
+		} else {
+			moved[p] = _inf.sx[p] >= 0;
+		}
+	}
+
+	/* the maps of players who stayed are repaired around changed tiles */
+	for(i = 0; i < _inf.npending; i++) {
+		int c, was;
+
+		c = _inf.pending[i];
+		_inf.is_pending[c] = 0;
+		was = _inf.cost[c];
+		_inf.cost[c] = _cost(c / HEIGHT, c % HEIGHT);
+
+		if(_inf.cost[c] == was) {
+			continue;
+		}
+
+		for(p = 0; p < MAX_PLAYERS; p++) {
+			if(moved[p] || !_near(p, c / HEIGHT, c % HEIGHT)) {
+				continue;
+			}
+
+			if(_inf.cost[c] < was) {
+				_lower(p, c);
+			} else {
+				_raise(p, c);
+			}
+		}
+	}
+
+	_inf.npending = 0;
+
+	for(p = 0; p < MAX_PLAYERS; p++) {
+		if(moved[p]) {
+			_rebuild(p);
+		}
+	}
+
+	for(i = 0; i < _inf.ndirty; i++) {
+		_inf.is_dirty[_inf.dirty[i]] = 0;
+		_own(_inf.dirty[i]);
+	}
+
+	_inf.ndirty = 0;
+
+	return;
+}
+
+/* steps of player p to (x, y), or -1 if it's beyond the horizon */
+int influence_reach(const int p, const int x, const int y)
+{
+	int r;
+
+	if(p < 0 || p >= MAX_PLAYERS || x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) {
+		return(-1);
+	}
+
+	r = _inf.reach[p][CELL(x, y)];
+
+	return(r == FAR ? -1 : r);
+}
+
+/* the player who gets to (x, y) first, -1 if nobody does or it's a tie */
+int influence_owner(const int x, const int y)
+{
+	if(x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) {
+		return(-1);
+	}
+
+	return(_inf.owner[CELL(x, y)]);
+}
+
+int influence_contested(const int x, const int y)
+{
+	if(x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) {
+		return(0);
+	}
+
+	return(_inf.contested[CELL(x, y)]);
+}
+
+/* the tiles that player p gets to first */
+int influence_territory(const int p)
+{
+	return(p >= 0 && p < MAX_PLAYERS ? _inf.territory[p] : 0);
+}
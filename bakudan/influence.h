@@ -0,0 +1,49 @@
+#ifndef INFLUENCE_H
+#define INFLUENCE_H
+
+#include "game.h"
+
+/*
+ * Influence maps
+ *
+ * For every player, the number of steps it takes to get to each tile,
+ * where a boulder in the way counts INFLUENCE_BOULDER_STEPS more for
+ * bombing it, up to INFLUENCE_HORIZON steps. A tile belongs to the player
+ * who gets there first, and it's contested if another player gets there
+ * at most INFLUENCE_CONTEST steps later. That tells which boulders are
+ * worth clearing before someone else does, and where an enemy can be cut
+ * off.
+ *
+ * The maps are kept up to date instead of being worked out again: every
+ * change to the field has to be passed to influence_changed(), like
+ * _set_object() does, and influence_update() then repairs the maps around
+ * the changed tiles only, as far as the steps to other tiles change. A
+ * player who moved has its map built again, since then almost every step
+ * count changes anyway. Nothing lies beyond the horizon, so either way an
+ * update costs the same on any size of field. influence_update() is not
+ * thread-safe; the queries may be called from any thread in between.
+ *
+ * The maps are only kept while someone uses them: between
+ * influence_acquire() and the matching influence_release(), the updates
+ * do their work, and the queries answer from the update before. Without
+ * users, both influence_changed() and influence_update() return right
+ * away, and the maps are built from scratch once someone needs them again.
+ * The AIs use them while there are CPU players, to leave boulders to
+ * whoever gets to them first.
+ */
+
+#define INFLUENCE_HORIZON       32
+#define INFLUENCE_BOULDER_STEPS 4
+#define INFLUENCE_CONTEST       2
+
+void influence_acquire(void);
+void influence_release(void);
+void influence_reset(void);
+void influence_changed(const int, const int);
+void influence_update(void);
+int influence_reach(const int, const int, const int);
+int influence_owner(const int, const int);
+int influence_contested(const int, const int);
+int influence_territory(const int);
+
+#endif /* INFLUENCE_H */
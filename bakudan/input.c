@@ -0,0 +1,227 @@
+#include <string.h>
+#include "input.h"
+#include "game.h"
+
+#define MAX_UNPRESENTED 16
+
+struct slot {
+	input_action action;      /* queued action */
+	unsigned time;            /* when it was pressed */
+	int held[INPUT_BOMB];     /* direction keys that are down */
+	input_action last_held;   /* the one pressed most recently */
+};
+
+struct histogram {
+	unsigned long bins[INPUT_HISTOGRAM_BINS];
+	unsigned long n;
+	unsigned max;
+};
+
+static const int _dx[] = { 0, 0, -1, 0, 1, 0 };
+static const int _dy[] = { 0, -1, 0, 1, 0, 0 };
+
+static struct slot _slots[MAX_PLAYERS];
+static unsigned _unpresented[MAX_UNPRESENTED];
+static int _nunpresented;
+static struct histogram _to_sim;
+static struct histogram _to_present;
+
+static int _is_move(const input_action a)
+{
+	return(a >= INPUT_UP && a <= INPUT_RIGHT);
+}
+
+static void _sample(struct histogram *h, const unsigned ms)
+{
+	h->bins[ms < INPUT_HISTOGRAM_BINS ? ms : INPUT_HISTOGRAM_BINS - 1]++;
+	h->n++;
+
+	if(ms > h->max) {
+		h->max = ms;
+	}
+
+	return;
+}
+
+/* an action reached the simulation at `now' */
+static void _applied(const struct slot *s, const unsigned now)
+{
+	_sample(&_to_sim, now - s->time);
+
+	if(_nunpresented < MAX_UNPRESENTED) {
+		_unpresented[_nunpresented++] = s->time;
+	}
+
+	return;
+}
+
+/* forget queued and held keys, e.g. when a new game starts */
+void input_reset(void)
+{
+	memset(_slots, 0, sizeof(_slots));
+	_nunpresented = 0;
+
+	return;
+}
+
+void input_press(const int p, const input_action a, const unsigned time)
+{
+	struct slot *s;
+
+	if(p < 0 || p >= MAX_PLAYERS || a == INPUT_NONE) {
+		return;
+	}
+
+	s = &(_slots[p]);
+
+	/* a newer action replaces one that hasn't been applied yet */
+	s->action = a;
+	s->time = time;
+
+	if(_is_move(a)) {
+		s->held[a] = 1;
+		s->last_held = a;
+	}
+
+	return;
+}
+
+void input_release(const int p, const input_action a)
+{
+	struct slot *s;
+	int i;
+
+	if(p < 0 || p >= MAX_PLAYERS || !_is_move(a)) {
+		return;
+	}
+
+	s = &(_slots[p]);
+	s->held[a] = 0;
+
+	if(s->last_held == a) {
+		s->last_held = INPUT_NONE;
+
+		/* fall back to another key that is still down */
+		for(i = INPUT_UP; i <= INPUT_RIGHT; i++) {
+			if(s->held[i]) {
+				s->last_held = i;
+			}
+		}
+	}
+
+	return;
+}
+
+/* hand queued actions to the game; call right before game_logic() */
+void input_apply(const unsigned now)
+{
+	int p;
+
+	for(p = 0; p < game_num_players() && p < MAX_PLAYERS; p++) {
+		struct slot *s;
+		player *pl;
+
+		s = &(_slots[p]);
+		pl = game_player_num(p);
+
+		if(!pl || pl->type != PLAYER_HUMAN || !pl->alive) {
+			continue;
+		}
+
+		/* bombs can't be planted mid-slide either, so both wait for it to end */
+		if(game_player_moving(p)) {
+			continue;
+		}
+
+		if(s->action == INPUT_BOMB) {
+			game_player_action(p);
+			_applied(s, now);
+			s->action = INPUT_NONE;
+		} else if(_is_move(s->action)) {
+			game_player_move(p, _dx[s->action], _dy[s->action]);
+			_applied(s, now);
+			s->action = INPUT_NONE;
+		} else if(s->last_held != INPUT_NONE) {
+			game_player_move(p, _dx[s->last_held], _dy[s->last_held]);
+		}
+	}
+
+	return;
+}
+
+/* a frame with everything applied so far was presented at `now' */
+void input_presented(const unsigned now)
+{
+	int i;
+
+	for(i = 0; i < _nunpresented; i++) {
+		_sample(&_to_present, now - _unpresented[i]);
+	}
+
+	_nunpresented = 0;
+
+	return;
+}
+
+static unsigned _percentile(const struct histogram *h, const double q)
+{
+	unsigned long sum, target;
+	unsigned i;
+
+	target = (unsigned long)(q * h->n + 0.5);
+
+	for(sum = 0, i = 0; i < INPUT_HISTOGRAM_BINS - 1; i++) {
+		sum += h->bins[i];
+
+		if(sum >= target) {
+			break;
+		}
+	}
+
+	return(i);
+}
+
+static void _print(FILE *fd, const char *name, const struct histogram *h)
+{
+	unsigned long peak;
+	int i, last;
+
+	fprintf(fd, "%s: %lu samples", name, h->n);
+
+	if(h->n == 0) {
+		fprintf(fd, "\n");
+		return;
+	}
+
+	fprintf(fd, ", p50 %ums p90 %ums p99 %ums max %ums\n",
+			_percentile(h, 0.5), _percentile(h, 0.9),
+			_percentile(h, 0.99), h->max);
+
+	for(peak = 0, last = 0, i = 0; i < INPUT_HISTOGRAM_BINS; i++) {
+		if(h->bins[i] > peak) {
+			peak = h->bins[i];
+		}
+
+		if(h->bins[i]) {
+			last = i;
+		}
+	}
+
+	for(i = 0; i <= last; i++) {
+		int w;
+
+		w = (int)(50 * h->bins[i] / peak);
+		fprintf(fd, "  %s%2dms %8lu %.*s\n", i == INPUT_HISTOGRAM_BINS - 1 ? ">=" : "  ",
+				i, h->bins[i], w, "##################################################");
+	}
+
+	return;
+}
+
+void input_report(FILE *fd)
+{
+	_print(fd, "input to simulation", &_to_sim);
+	_print(fd, "input to screen", &_to_present);
+
+	return;
+}
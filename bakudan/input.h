@@ -0,0 +1,39 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdio.h>
+
+/*
+ * Input for human players
+ *
+ * Key presses are turned into actions as soon as they arrive. Each
+ * player has a slot for one action that is applied at the next tick, or
+ * the moment the player's current slide is over, so that a move or bomb
+ * pressed during a slide isn't lost. A held direction key keeps the
+ * player moving.
+ *
+ * Every press carries the time it happened at, which gives two latency
+ * histograms: until the action reaches the simulation, and until the
+ * first frame showing it is presented. Times are in milliseconds on any
+ * monotonic clock, as long as it's the same clock throughout.
+ */
+
+#define INPUT_HISTOGRAM_BINS 64  /* one per millisecond, the last one is open */
+
+typedef enum {
+	INPUT_NONE = 0,
+	INPUT_UP,
+	INPUT_LEFT,
+	INPUT_DOWN,
+	INPUT_RIGHT,
+	INPUT_BOMB
+} input_action;
+
+void input_reset(void);
+void input_press(const int, const input_action, const unsigned);
+void input_release(const int, const input_action);
+void input_apply(const unsigned);
+void input_presented(const unsigned);
+void input_report(FILE*);
+
+#endif /* INPUT_H */
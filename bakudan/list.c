@@ -2,6 +2,7 @@
 #include <string.h>
 #include <errno.h>
 #include "list.h"
+#include "mem.h"
 
 int list_append(list **l, void *data)
 {
@@ -9,7 +10,7 @@ int list_append(list **l, void *data)
 	int ret_val;
 
 	ret_val = -ENOMEM;
-	item = malloc(sizeof(*item));
+	item = mem_alloc(MEM_LIST, sizeof(*item));
 
 	if(item) {
 	    item->data = data;
@@ -39,10 +40,12 @@ int list_remove(list **l, void *data)
 			free_me = *l;
 			*l = (*l)->next;
 
-			free(free_me);
+			mem_free(MEM_LIST, free_me);
 			ret_val = 0;
 			break;
 		}
+
+		l = &((*l)->next);
 	}
 
 	return(ret_val);
@@ -59,7 +62,7 @@ void* list_pop(list **l)
 	if(item) {
 		ret_val = item->data;
 		*l = item->next;
-		free(item);
+		mem_free(MEM_LIST, item);
 	}
 
 	return(ret_val);
@@ -71,9 +74,9 @@ void list_free(list **l)
 		list *free_me;
 
 		free_me = *l;
-		l = &((*l)->next);
+		*l = free_me->next;
 
-		free(free_me);
+		mem_free(MEM_LIST, free_me);
 	}
 
 	return;
@@ -0,0 +1,281 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "live.h"
+
+#define MAX_READ_ATTEMPTS 1000
+
+static live_state *_live;
+static char _name[256];
+static unsigned long _last_tick;
+
+int live_open(const char *name)
+{
+	int fd;
+
+	if(_live) {
+		return(-EBUSY);
+	}
+
+	if(strlen(name) >= sizeof(_name)) {
+		return(-ENAMETOOLONG);
+	}
+
+	/* never take over the segment of another game */
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+
+	if(fd < 0) {
+		return(-errno);
+	}
+
+	if(ftruncate(fd, sizeof(*_live)) < 0) {
+		int err;
+
+		err = errno;
+		close(fd);
+		shm_unlink(name);
+
+		return(-err);
+	}
+
+	_live = mmap(NULL, sizeof(*_live), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(_live == MAP_FAILED) {
+		_live = NULL;
+		shm_unlink(name);
+
+		return(-ENOMEM);
+	}
+
+	strcpy(_name, name);
+	_last_tick = 0;
+
+	/* readers check the magic last, so set it up after everything else */
+	memset(_live, 0, sizeof(*_live));
+	_live->version = LIVE_VERSION;
+	_live->width = WIDTH;
+	_live->height = HEIGHT;
+	_live->winner = -1;
+	__atomic_store_n(&(_live->magic), LIVE_MAGIC, __ATOMIC_RELEASE);
+
+	return(0);
+}
+
+static void _snapshot_board(live_state *live)
+{
+	int x, y;
+
+	for(x = 0; x < WIDTH; x++) {
+		for(y = 0; y < HEIGHT; y++) {
+			live_cell *c;
+			object *o;
+
+			c = &(live->board[LIVE_CELL(x, y)]);
+			o = game_object_at(x, y);
+
+			memset(c, 0, sizeof(*c));
+			c->type = o ? (int8_t)o->type : -1;
+
+			if(!o) {
+				continue;
+			}
+
+			switch(o->type) {
+			case OBJECT_TYPE_BOULDER:
+				c->strength = ((boulder*)o)->strength;
+				break;
+
+			case OBJECT_TYPE_BOMB:
+				c->owner = (int8_t)((bomb*)o)->owner;
+				c->timeout = ((bomb*)o)->timeout;
+				c->strength = ((bomb*)o)->strength;
+				break;
+
+			case OBJECT_TYPE_ITEM:
+				c->item = (int8_t)((item*)o)->type;
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	return;
+}
+
+static void _snapshot_players(live_state *live)
+{
+	int i, n;
+
+	n = game_num_players();
+	live->nplayers = n;
+
+	for(i = 0; i < MAX_PLAYERS; i++) {
+		live_player *lp;
+		player *p;
+
+		lp = &(live->player[i]);
+
+		if(i >= n || !(p = game_player_num(i))) {
+			memset(lp, 0, sizeof(*lp));
+			continue;
+		}
+
+		lp->alive = p->alive;
+		lp->x = obj_x(p);
+		lp->y = obj_y(p);
+		lp->dx = p->dx;
+		lp->dy = p->dy;
+		lp->health = p->health;
+		lp->lifes = p->lifes;
+		lp->bombs = p->bombs;
+		lp->probability = p->probability;
+		lp->bomb_strength = p->bomb_strength;
+		lp->bomb_timeout = p->bomb_timeout;
+		lp->frags = p->frags;
+		lp->deaths = p->deaths;
+		lp->suicides = p->suicides;
+		lp->boulders = p->boulders;
+		lp->items = p->items;
+	}
+
+	return;
+}
+
+/* copy the state of the current match, minus the counters */
+void live_snapshot(live_state *live)
+{
+	live->width = WIDTH;
+	live->height = HEIGHT;
+	live->tick = game_ticks();
+	live->over = game_is_over();
+	live->winner = game_get_winner();
+
+	_snapshot_board(live);
+	_snapshot_players(live);
+
+	return;
+}
+
+/* copy the current match into the segment; call once per tick */
+void live_publish(void)
+{
+	unsigned long tick;
+	uint32_t seq;
+
+	if(!_live) {
+		return;
+	}
+
+	tick = game_ticks();
+	seq = _live->seq;
+
+	/* odd: update in progress */
+	__atomic_store_n(&(_live->seq), seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	if(tick < _last_tick || _live->updates == 0) {
+		_live->match++;
+	}
+
+	_last_tick = tick;
+
+	_live->updates++;
+	live_snapshot(_live);
+
+	__atomic_store_n(&(_live->seq), seq + 2, __ATOMIC_RELEASE);
+
+	return;
+}
+
+void live_close(void)
+{
+	if(!_live) {
+		return;
+	}
+
+	munmap(_live, sizeof(*_live));
+	shm_unlink(_name);
+	_live = NULL;
+
+	return;
+}
+
+/*
+ * Map a published segment read-only; NULL if there is none (yet), or if
+ * it's from a build with another layout or field size.
+ */
+const live_state* live_attach(const char *name)
+{
+	live_state *ret_val;
+	struct stat st;
+	int fd;
+
+	fd = shm_open(name, O_RDONLY, 0);
+
+	if(fd < 0) {
+		return(NULL);
+	}
+
+	ret_val = NULL;
+
+	if(fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(*ret_val)) {
+		ret_val = mmap(NULL, sizeof(*ret_val), PROT_READ, MAP_SHARED, fd, 0);
+
+		if(ret_val == MAP_FAILED) {
+			ret_val = NULL;
+		} else if(__atomic_load_n(&(ret_val->magic), __ATOMIC_ACQUIRE) != LIVE_MAGIC ||
+				  ret_val->version != LIVE_VERSION ||
+				  ret_val->width != WIDTH || ret_val->height != HEIGHT) {
+			/* the board of another field size doesn't fit ours */
+			munmap(ret_val, sizeof(*ret_val));
+			ret_val = NULL;
+		}
+	}
+
+	close(fd);
+	errno = ret_val ? 0 : EPROTO;
+
+	return(ret_val);
+}
+
+void live_detach(const live_state *live)
+{
+	munmap((void*)live, sizeof(*live));
+	return;
+}
+
+/*
+ * Take a consistent snapshot of the segment. Returns -EAGAIN if the
+ * writer kept getting in the way, which only happens if the reader is
+ * starved of CPU time.
+ */
+int live_read(const live_state *live, live_state *copy)
+{
+	int i;
+
+	for(i = 0; i < MAX_READ_ATTEMPTS; i++) {
+		uint32_t before, after;
+
+		before = __atomic_load_n(&(live->seq), __ATOMIC_ACQUIRE);
+
+		if(before & 1) {
+			continue;
+		}
+
+		memcpy(copy, live, sizeof(*copy));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		after = __atomic_load_n(&(live->seq), __ATOMIC_RELAXED);
+
+		if(before == after) {
+			return(0);
+		}
+	}
+
+	return(-EAGAIN);
+}
@@ -0,0 +1,88 @@
+#ifndef LIVE_H
+#define LIVE_H
+
+#include <stdint.h>
+#include "game.h"
+
+/*
+ * Live state export
+ *
+ * The running match is published once per tick into a POSIX shared
+ * memory segment, so that dashboards and debug viewers can watch it
+ * without talking to the game. The writer never waits for readers:
+ * `seq' is odd while an update is in progress and is incremented again
+ * when it is done, so a reader that sees the same even value before and
+ * after reading got a consistent snapshot (see live_read()).
+ *
+ * Readers map the segment read-only and may also look at single fields
+ * in place; only multi-field consistency needs the seqlock.
+ *
+ * The game only publishes if the environment variable LIVE_ENV names a
+ * segment, e.g. LIVE_DEFAULT_NAME, which is where readers look unless
+ * told otherwise. A segment that already exists is left alone and the
+ * export fails with -EEXIST, so two games never write into the same one.
+ */
+
+#define LIVE_MAGIC        0x554b4142  /* "BAKU" */
+#define LIVE_VERSION      2
+#define LIVE_DEFAULT_NAME "/bakudan"
+#define LIVE_ENV          "BAKUDAN_LIVE"
+
+#define LIVE_CELL(x,y) ((x) * HEIGHT + (y))
+
+typedef struct {
+	int8_t type;       /* object_type, or -1 if the cell is empty */
+	int8_t item;       /* item_type of items */
+	int8_t owner;      /* owner of bombs */
+	int8_t reserved;
+	int32_t timeout;   /* fuse of bombs, in ticks */
+	int32_t strength;  /* strength of boulders and bombs */
+} live_cell;
+
+typedef struct {
+	int32_t alive;
+	int32_t x;
+	int32_t y;
+	int32_t dx;
+	int32_t dy;
+	int32_t health;
+	int32_t lifes;
+	int32_t bombs;
+	int32_t probability;
+	int32_t bomb_strength;
+	int32_t bomb_timeout;
+	int32_t frags;
+	int32_t deaths;
+	int32_t suicides;
+	int32_t boulders;
+	int32_t items;
+} live_player;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seq;
+	int32_t width;
+	int32_t height;
+	int32_t nplayers;
+	int32_t over;
+	int32_t winner;
+	uint64_t match;    /* matches published so far */
+	uint64_t tick;     /* ticks into the current match */
+	uint64_t updates;  /* ticks published so far */
+
+	live_cell board[WIDTH * HEIGHT];
+	live_player player[MAX_PLAYERS];
+} live_state;
+
+void live_snapshot(live_state*);
+
+int live_open(const char*);
+void live_publish(void);
+void live_close(void);
+
+const live_state* live_attach(const char*);
+void live_detach(const live_state*);
+int live_read(const live_state*, live_state*);
+
+#endif /* LIVE_H */
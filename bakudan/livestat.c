@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "live.h"
+#include "tool.h"
+
+/*
+ * Prints statistics of a running match from its shared memory export
+ */
+
+static void _print(const live_state *s, const double rate)
+{
+	int boulders, bombs, items;
+	int i;
+
+	boulders = 0;
+	bombs = 0;
+	items = 0;
+
+	for(i = 0; i < s->width * s->height; i++) {
+		switch(s->board[i].type) {
+		case OBJECT_TYPE_BOULDER:
+			boulders++;
+			break;
+
+		case OBJECT_TYPE_BOMB:
+			bombs++;
+			break;
+
+		case OBJECT_TYPE_ITEM:
+			items++;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	printf("match %llu tick %llu (%.0f/s) boulders %d bombs %d items %d",
+		   (unsigned long long)s->match, (unsigned long long)s->tick, rate,
+		   boulders, bombs, items);
+
+	for(i = 0; i < s->nplayers && i < MAX_PLAYERS; i++) {
+		const live_player *p;
+
+		p = &(s->player[i]);
+
+		if(!p->alive) {
+			printf(" | P%d dead", i + 1);
+			continue;
+		}
+
+		printf(" | P%d (%d,%d) hp %d lifes %d frags %d", i + 1,
+			   p->x, p->y, p->health, p->lifes, p->frags);
+	}
+
+	if(s->over) {
+		if(s->winner < 0) {
+			printf(" | draw");
+		} else {
+			printf(" | P%d won", s->winner + 1);
+		}
+	}
+
+	printf("\n");
+	fflush(stdout);
+
+	return;
+}
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+		   "\n"
+		   "  -n name  shared memory segment (default: $%s or %s)\n"
+		   "  -i ms    interval between updates (default: 1000)\n"
+		   "  -c num   stop after this many updates (default: never)\n",
+		   argv0, LIVE_ENV, LIVE_DEFAULT_NAME);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	const live_state *live;
+	live_state snap;
+	const char *name;
+	unsigned long long last_updates;
+	double last;
+	int interval, count;
+	int opt;
+
+	name = getenv(LIVE_ENV);
+	interval = 1000;
+	count = -1;
+
+	if(!name || !*name) {
+		name = LIVE_DEFAULT_NAME;
+	}
+
+	while((opt = getopt(argc, argv, "n:i:c:h")) != -1) {
+		switch(opt) {
+		case 'n':
+			name = optarg;
+			break;
+
+		case 'i':
+			interval = atoi(optarg);
+			break;
+
+		case 'c':
+			count = atoi(optarg);
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	live = live_attach(name);
+
+	if(!live) {
+		fprintf(stderr, "%s: %s\n", name, strerror(errno));
+		return(1);
+	}
+
+	last = tool_now();
+	last_updates = live->updates;
+
+	while(count < 0 || count-- > 0) {
+		double now;
+		int err;
+
+		usleep(interval * 1000);
+
+		err = live_read(live, &snap);
+		now = tool_now();
+
+		if(err < 0) {
+			fprintf(stderr, "live_read: %s\n", strerror(-err));
+			continue;
+		}
+
+		_print(&snap, (snap.updates - last_updates) / (now - last));
+
+		last = now;
+		last_updates = snap.updates;
+	}
+
+	live_detach(live);
+
+	return(0);
+}
@@ -1,11 +1,27 @@
 #include <stdio.h>
 #include <string.h>
 #include "engine.h"
+#include "ai.h"
 
 int main(int argc, char *argv[])
 {
 	int ret_val;
 
+	/* optional AI configuration, e.g. the output of the tuner */
+	if(argc > 1) {
+		ai_config cfg;
+
+		ai_config_default(&cfg);
+		ret_val = ai_config_load(&cfg, argv[1]);
+
+		if(ret_val < 0) {
+			fprintf(stderr, "%s: %s\n", argv[1], strerror(-ret_val));
+			return(ret_val);
+		}
+
+		ai_set_defaults(&cfg);
+	}
+
 	ret_val = engine_init();
 
 	if(ret_val < 0) {
@@ -0,0 +1,625 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "mcts.h"
+#include "batch.h"
+#include "dist.h"
+#include "mem.h"
+#include "rng.h"
+
+#define MAX_NODES (MCTS_MAX_PLAYOUTS + 1)
+#define MAX_DEPTH 64
+#define UCB_C     0.7f
+
+#define ESCAPE_STEPS 6  /* looked ahead when fleeing in rollouts */
+
+struct node {
+	int visits;                 /* including playouts still running */
+	float value;                /* sum of the rewards */
+	short child[MCTS_ACTIONS];  /* 0 until the action was tried */
+};
+
+struct mcts {
+	batch *root;     /* the match to decide in, in lane 0 */
+	batch *play;     /* the playouts */
+	struct node nodes[MAX_NODES];
+	int nnodes;
+	int goal_x;      /* where the AI's own rollouts head for, if >= 0 */
+	int goal_y;
+	int hint;        /* what the rules would do, -1 if nothing */
+	int self;        /* the player to decide for */
+	unsigned legal;  /* its actions at the root */
+	int lost;        /* lives it had lost when the search began */
+	int done;        /* playouts so far */
+
+	/* where the playout of every lane is */
+	int node[BATCH_LANES];               /* in the tree, -1 once it left it */
+	short path[BATCH_LANES][MAX_DEPTH];  /* nodes the playout went through */
+	int depth[BATCH_LANES];
+	int hold[BATCH_LANES];               /* ticks to keep staying */
+};
+
+static const int _action_dx[MCTS_ACTIONS] = { 0, 0, -1, 1, 0, 0 };
+static const int _action_dy[MCTS_ACTIONS] = { 0, -1, 0, 0, 1, 0 };
+
+mcts* mcts_new(void)
+{
+	mcts *m;
+
+	m = mem_alloc(MEM_SEARCH, sizeof(*m));
+
+	if(!m) {
+		return(NULL);
+	}
+
+	memset(m, 0, sizeof(*m));
+
+	m->root = batch_new();
+	m->play = batch_new();
+
+	if(!m->root || !m->play) {
+		mcts_free(m);
+		return(NULL);
+	}
+
+	return(m);
+}
+
+void mcts_free(mcts *m)
+{
+	if(m) {
+		batch_free(m->root);
+		batch_free(m->play);
+		mem_free(MEM_SEARCH, m);
+	}
+
+	return;
+}
+
+void mcts_action_dir(const mcts_action a, int *dx, int *dy)
+{
+	*dx = _action_dx[a];
+	*dy = _action_dy[a];
+
+	return;
+}
+
+/* damage the bombs in lane k would do at (x, y), like game_location_dangerous() */
+static int _danger(const batch *b, const int k, const int x, const int y)
+{
+	int dmg;
+	int i;
+
+	for(dmg = 0, i = 1; i < WIDTH - 1; i++) {
+		int c, d;
+
+		c = BATCH_CELL(i, y);
+
+		if(b->type[c][k] == OBJECT_TYPE_BOMB) {
+			d = b->strength[c][k] - (i > x ? i - x : x - i) * BOMB_GRADIENT;
+			dmg += d > 0 ? d : 0;
+		}
+	}
+
+	for(i = 1; i < HEIGHT - 1; i++) {
+		int c, d;
+
+		c = BATCH_CELL(x, i);
+
+		if(i != y && b->type[c][k] == OBJECT_TYPE_BOMB) {
+			d = b->strength[c][k] - (i > y ? i - y : y - i) * BOMB_GRADIENT;
+			dmg += d > 0 ? d : 0;
+		}
+	}
+
+	return(dmg);
+}
+
+/*
+ * The first step towards the closest tile out of the range of bombs in
+ * lane k, at most ESCAPE_STEPS away, or -1 if there is none. Stepping to
+ * the least dangerous neighbor instead runs into dead ends, which made
+ * planting look a lot riskier in playouts than it is.
+ */
+static int _escape(const batch *b, const int k, const int x, const int y)
+{
+	int queue[BATCH_CELLS];
+	signed char first[BATCH_CELLS];   /* action of the first step, -1 if not reached */
+	unsigned char dist[BATCH_CELLS];
+	int head, tail;
+
+	memset(first, 0xff, sizeof(first));
+	head = 0;
+	tail = 0;
+
+	first[BATCH_CELL(x, y)] = MCTS_STAY;
+	dist[BATCH_CELL(x, y)] = 0;
+	queue[tail++] = BATCH_CELL(x, y);
+
+	while(head < tail) {
+		int c, cx, cy, a;
+
+		c = queue[head++];
+		cx = c / HEIGHT;
+		cy = c % HEIGHT;
+
+		if(dist[c] > 0 && _danger(b, k, cx, cy) == 0) {
+			return(first[c]);
+		}
+
+		if(dist[c] == ESCAPE_STEPS) {
+			continue;
+		}
+
+		for(a = MCTS_UP; a <= MCTS_DOWN; a++) {
+			int n, t;
+
+			n = BATCH_CELL(cx + _action_dx[a], cy + _action_dy[a]);
+			t = b->type[n][k];
+
+			if(first[n] >= 0 || (t != CELL_EMPTY && t != OBJECT_TYPE_ITEM)) {
+				continue;
+			}
+
+			first[n] = dist[c] == 0 ? a : first[c];
+			dist[n] = dist[c] + 1;
+			queue[tail++] = n;
+		}
+	}
+
+	return(-1);
+}
+
+/*
+ * The rollout policy: get out of the range of bombs if need be, now and
+ * then bomb a boulder next to the player, and wander around otherwise.
+ * With a goal, the player mostly wanders towards it.
+ */
+static void _rollout(batch *b, const int k, const int p, const int gx, const int gy,
+					 uint32_t *rng)
+{
+	int dirs[4];
+	int x, y, here, best, closer;
+	int n, a;
+
+	x = b->x[p][k];
+	y = b->y[p][k];
+	here = _danger(b, k, x, y);
+
+	if(here > 0 && (a = _escape(b, k, x, y)) >= 0) {
+		batch_player_move(b, k, p, _action_dx[a], _action_dy[a]);
+		return;
+	}
+
+	if(here == 0 && b->bombs[p][k] > 0 && rng_chance(rng, 25)) {
+		for(a = MCTS_UP; a <= MCTS_DOWN; a++) {
+			if(b->type[BATCH_CELL(x + _action_dx[a], y + _action_dy[a])][k] ==
+			   OBJECT_TYPE_BOULDER) {
+				batch_player_action(b, k, p);
+				return;
+			}
+		}
+	}
+
+	/* in danger, the least dangerous neighbors; safe ones otherwise */
+	best = here > 0 ? here : 1;
+	closer = -1;
+
+	for(n = 0, a = MCTS_UP; a <= MCTS_DOWN; a++) {
+		int t, d, tx, ty;
+
+		tx = x + _action_dx[a];
+		ty = y + _action_dy[a];
+		t = b->type[BATCH_CELL(tx, ty)][k];
+
+		if(t != CELL_EMPTY && t != OBJECT_TYPE_ITEM) {
+			continue;
+		}
+
+		d = _danger(b, k, tx, ty);
+
+		if(d < best) {
+			best = d;
+			n = 0;
+		}
+
+		if(d == best || (here == 0 && d == 0)) {
+			dirs[n++] = a;
+
+			if(gx >= 0 && here == 0 &&
+			   dist_static(tx, ty, gx, gy) < dist_static(x, y, gx, gy)) {
+				closer = a;
+			}
+		}
+	}
+
+	if(closer >= 0 && rng_chance(rng, 75)) {
+		batch_player_move(b, k, p, _action_dx[closer], _action_dy[closer]);
+		return;
+	}
+
+	if(n > 0) {
+		a = dirs[rng_next(rng) % n];
+		batch_player_move(b, k, p, _action_dx[a], _action_dy[a]);
+	}
+
+	return;
+}
+
+/* actions that do something in the match in the scalar engine */
+static unsigned _legal_actions(const int p)
+{
+	unsigned legal;
+	player *pl;
+	int x, y;
+	int a;
+
+	pl = game_player_num(p);
+	x = obj_x(pl);
+	y = obj_y(pl);
+	legal = 1 << MCTS_STAY;
+
+	for(a = MCTS_UP; a <= MCTS_DOWN; a++) {
+		object *o;
+
+		o = game_object_at(x + _action_dx[a], y + _action_dy[a]);
+
+		if(!o || o->type == OBJECT_TYPE_ITEM) {
+			legal |= 1 << a;
+		}
+	}
+
+	if(game_player_can_plant(p) && !game_object_at(x, y)) {
+		legal |= 1 << MCTS_PLANT;
+	}
+
+	return(legal);
+}
+
+static float _ucb(const struct node *parent, const struct node *n)
+{
+	return(n->value / n->visits +
+		   UCB_C * sqrtf(logf((float)parent->visits) / n->visits));
+}
+
+/*
+ * Pick the AI's next action in lane k's playout: an action that wasn't
+ * tried yet at the lane's node if there is one, the best one by UCB1
+ * otherwise. Visits are counted right away, so that lanes of the same
+ * round that pass the node later prefer other actions.
+ */
+static mcts_action _tree_policy(mcts *m, const int k, const unsigned legal, uint32_t *rng)
+{
+	struct node *n;
+	int untried[MCTS_ACTIONS];
+	int nuntried;
+	float best;
+	int a, pick;
+
+	n = &(m->nodes[m->node[k]]);
+
+	for(nuntried = 0, a = 0; a < MCTS_ACTIONS; a++) {
+		if((legal & (1 << a)) && !n->child[a]) {
+			untried[nuntried++] = a;
+		}
+	}
+
+	if(nuntried > 0 && m->nnodes < MAX_NODES && m->depth[k] < MAX_DEPTH) {
+		struct node *c;
+
+		pick = untried[rng_next(rng) % nuntried];
+		n->child[pick] = m->nnodes++;
+
+		c = &(m->nodes[n->child[pick]]);
+		memset(c, 0, sizeof(*c));
+		c->visits = 1;
+
+		/* the rest of the playout is up to the rollout policy */
+		m->path[k][m->depth[k]++] = n->child[pick];
+		m->node[k] = -1;
+
+		return(pick);
+	}
+
+	for(pick = -1, best = 0, a = 0; a < MCTS_ACTIONS; a++) {
+		float u;
+
+		if(!(legal & (1 << a)) || !n->child[a]) {
+			continue;
+		}
+
+		u = _ucb(n, &(m->nodes[n->child[a]]));
+
+		if(pick < 0 || u > best) {
+			pick = a;
+			best = u;
+		}
+	}
+
+	if(pick < 0 || m->depth[k] >= MAX_DEPTH) {
+		m->node[k] = -1;
+		return(pick < 0 ? MCTS_STAY : pick);
+	}
+
+	m->node[k] = n->child[pick];
+	m->nodes[m->node[k]].visits++;
+	m->path[k][m->depth[k]++] = m->node[k];
+
+	return(pick);
+}
+
+static void _self(mcts *m, const int k, const int p, const unsigned legal, uint32_t *rng)
+{
+	batch *b;
+	mcts_action a;
+
+	b = m->play;
+
+	if(m->hold[k] > 0) {
+		m->hold[k]--;
+		return;
+	}
+
+	if(m->node[k] < 0) {
+		_rollout(b, k, p, m->goal_x, m->goal_y, rng);
+		return;
+	}
+
+	/* only the root is known to be the match itself */
+	a = _tree_policy(m, k, m->depth[k] == 1 ? legal : (1 << MCTS_ACTIONS) - 1, rng);
+
+	switch(a) {
+	case MCTS_STAY:
+		m->hold[k] = MCTS_STAY_TICKS - 1;
+		break;
+
+	case MCTS_PLANT:
+		batch_player_action(b, k, p);
+		break;
+
+	default:
+		batch_player_move(b, k, p, _action_dx[a], _action_dy[a]);
+		break;
+	}
+
+	return;
+}
+
+/* boulders that p's bombs in lane k will break once they go off */
+static int _pending(const batch *b, const int k, const int p)
+{
+	static const int dirs[4][2] = {
+		{ -1,  0 },
+		{  1,  0 },
+		{  0, -1 },
+		{  0,  1 }
+	};
+	int n, c, d;
+
+	for(n = 0, c = 0; c < BATCH_CELLS; c++) {
+		if(b->type[c][k] != OBJECT_TYPE_BOMB || b->owner[c][k] != p) {
+			continue;
+		}
+
+		for(d = 0; d < 4; d++) {
+			int tx, ty, dmg;
+
+			for(tx = c / HEIGHT + dirs[d][0], ty = c % HEIGHT + dirs[d][1],
+					dmg = b->strength[c][k] - BOMB_GRADIENT;
+				dmg > 0; tx += dirs[d][0], ty += dirs[d][1], dmg -= BOMB_GRADIENT) {
+				int t;
+
+				t = b->type[BATCH_CELL(tx, ty)][k];
+
+				if(t == OBJECT_TYPE_WALL || t == OBJECT_TYPE_PILLAR) {
+					break;
+				}
+
+				if(t == OBJECT_TYPE_BOULDER && b->strength[BATCH_CELL(tx, ty)][k] <= dmg) {
+					n++;
+				}
+			}
+		}
+	}
+
+	return(n);
+}
+
+/*
+ * How the playout in lane k went for player p, compared to the root: in
+ * (0, 1), with 0.5 if nothing happened. Bombs that are still ticking at
+ * the end count for most of what they will break, or planting would only
+ * pay off right at the start of a playout. Getting closer to the goal is
+ * worth a little, so that the AI doesn't idle while its bombs tick.
+ */
+static float _score(const mcts *m, const batch *b, const int k, const int p)
+{
+	const batch *root;
+
+	float score;
+	int lost;
+
+	root = m->root;
+	lost = (b->deaths[p][k] - root->deaths[p][0]) +
+		(b->suicides[p][k] - root->suicides[p][0]);
+
+	score = 1.0f * (b->frags[p][k] - root->frags[p][0]) +
+		0.25f * (b->boulders[p][k] - root->boulders[p][0]) +
+		0.25f * (b->items[p][k] - root->items[p][0]) -
+		1.5f * lost - (b->alive[p][k] ? 0.0f : 1.0f);
+
+	if(lost == 0) {
+		score += 0.2f * _pending(b, k, p);
+	}
+
+	if(lost == 0 && m->goal_x >= 0) {
+		score += 0.05f * (dist_static(root->x[p][0], root->y[p][0], m->goal_x, m->goal_y) -
+						  dist_static(b->x[p][k], b->y[p][k], m->goal_x, m->goal_y));
+	}
+
+	if(lost == 0) {
+		score += 0.5f * (b->health[p][k] - root->health[p][0]) / PLAYER_DEFAULT_HEALTH;
+	}
+
+	/* squash into (0, 1) without tilting it */
+	return(0.5f + 0.5f * score / (1.0f + fabsf(score)));
+}
+
+/*
+ * Start a search for what player p does next, from the match as it is
+ * now. (gx, gy) is where p's rollouts head for, e.g. the target the rules
+ * would pick, or -1 for none. hint is the action the rules would take
+ * next, or -1; see mcts_best(). Returns a negative error code if p can't
+ * do anything.
+ */
+int mcts_begin(mcts *m, const int p, const int gx, const int gy, const int hint)
+{
+	if(p < 0 || p >= game_num_players() ||
+	   !game_player_num(p)->alive || game_player_moving(p)) {
+		return(-EINVAL);
+	}
+
+	batch_load(m->root, 0);
+	m->self = p;
+	m->legal = _legal_actions(p);
+	m->lost = m->root->deaths[p][0] + m->root->suicides[p][0];
+	m->goal_x = gx;
+	m->goal_y = gy;
+	m->hint = hint >= 0 && hint < MCTS_ACTIONS && (m->legal & (1 << hint)) ? hint : -1;
+	m->done = 0;
+
+	memset(&(m->nodes[0]), 0, sizeof(m->nodes[0]));
+	m->nnodes = 1;
+
+	return(0);
+}
+
+/*
+ * Add up to `playouts' playouts to the search, in rounds of BATCH_LANES.
+ * Returns how many were added, 0 once the search is full. The match the
+ * search started from is kept, so this may as well be called again later.
+ */
+int mcts_run(mcts *m, const int playouts, uint32_t *rng)
+{
+	batch *b;
+	int done;
+	int p, k;
+
+	b = m->play;
+	p = m->self;
+
+	for(done = 0; done < playouts && m->done < MCTS_MAX_PLAYOUTS; done += BATCH_LANES) {
+		int t;
+
+		batch_fill(b, m->root, 0);
+
+		for(k = 0; k < BATCH_LANES; k++) {
+			m->node[k] = 0;
+			m->path[k][0] = 0;
+			m->depth[k] = 1;
+			m->hold[k] = 0;
+		}
+
+		m->nodes[0].visits += BATCH_LANES;
+
+		for(t = 0; t < MCTS_HORIZON && batch_live(b); t++) {
+			for(k = 0; k < BATCH_LANES; k++) {
+				int q;
+
+				if(!b->live[k]) {
+					continue;
+				}
+
+				/* the same order as ai_tick(), players can't do anything while moving */
+				for(q = 0; q < b->nplayers[k]; q++) {
+					if(!b->alive[q][k] || b->dx[q][k] || b->dy[q][k]) {
+						continue;
+					}
+
+					if(q == p) {
+						_self(m, k, q, m->legal, rng);
+					} else {
+						_rollout(b, k, q, -1, -1, rng);
+					}
+				}
+			}
+
+			batch_step(b);
+
+			/* nothing after that changes much for p */
+			for(k = 0; k < BATCH_LANES; k++) {
+				if(b->deaths[p][k] + b->suicides[p][k] != m->lost) {
+					b->live[k] = 0;
+				}
+			}
+		}
+
+		for(k = 0; k < BATCH_LANES; k++) {
+			float r;
+			int i;
+
+			r = _score(m, b, k, p);
+
+			for(i = 0; i < m->depth[k]; i++) {
+				m->nodes[m->path[k][i]].value += r;
+			}
+		}
+
+		m->done += BATCH_LANES;
+	}
+
+	return(done);
+}
+
+/* playouts of the search so far */
+int mcts_playouts(const mcts *m)
+{
+	return(m->done);
+}
+
+/*
+ * The best action so far: the one that was tried most, then the best one.
+ * The rules' action is taken instead unless its mean reward is more than
+ * MCTS_HINT_MARGIN below that of the best one, since a few hundred noisy
+ * playouts easily prefer some other action by a hair when the rules are
+ * right. The rewards are in (0, 1), so the margin is an absolute one.
+ */
+mcts_action mcts_best(const mcts *m)
+{
+	const struct node *best;
+	mcts_action action;
+	int a, k;
+
+	action = MCTS_STAY;
+
+	for(a = 0, k = -1; a < MCTS_ACTIONS; a++) {
+		const struct node *c;
+
+		if(!m->nodes[0].child[a]) {
+			continue;
+		}
+
+		c = &(m->nodes[m->nodes[0].child[a]]);
+		best = k < 0 ? NULL : &(m->nodes[k]);
+
+		if(!best || c->visits > best->visits ||
+		   (c->visits == best->visits && c->value > best->value)) {
+			k = m->nodes[0].child[a];
+			action = a;
+		}
+	}
+
+	if(k >= 0 && m->hint >= 0 && m->nodes[0].child[m->hint]) {
+		const struct node *h;
+
+		best = &(m->nodes[k]);
+		h = &(m->nodes[m->nodes[0].child[m->hint]]);
+
+		if(h->value / h->visits >= best->value / best->visits - MCTS_HINT_MARGIN) {
+			action = m->hint;
+		}
+	}
+
+	return(action);
+}
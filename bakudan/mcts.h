@@ -0,0 +1,54 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <stdint.h>
+#include "game.h"
+
+/*
+ * Monte Carlo tree search for CPU players
+ *
+ * At every decision the match is cloned into all lanes of a batch (see
+ * batch.h), which are then played out in lockstep for MCTS_HORIZON
+ * ticks. The tree holds the AI's own decisions: a playout follows it by
+ * UCB1 until it adds a new node, and from there on the AI moves by the
+ * same cheap rollout policy as every other player, except that it heads
+ * for a goal the caller picks. The action that was tried most often at
+ * the root is the one to take, unless the action the rules would take
+ * did about as well.
+ *
+ * Start with mcts_begin(), add playouts with mcts_run() for as long as
+ * there is time, possibly over several ticks, and take mcts_best()
+ * whenever it's needed.
+ */
+
+#define MCTS_HORIZON      (6 * FPS)  /* longer than a bomb's default fuse */
+#define MCTS_STAY_TICKS   16         /* how long the AI stays when it decides to */
+#define MCTS_MAX_PLAYOUTS 4096       /* per decision */
+#define MCTS_HINT_MARGIN  0.02f      /* on the mean reward in (0, 1), see mcts_best() */
+
+/* playouts per decision of the difficulty levels */
+#define MCTS_EASY   32
+#define MCTS_NORMAL 128
+#define MCTS_HARD   512
+
+typedef enum {
+	MCTS_STAY = 0,
+	MCTS_UP,
+	MCTS_LEFT,
+	MCTS_RIGHT,
+	MCTS_DOWN,
+	MCTS_PLANT,
+	MCTS_ACTIONS
+} mcts_action;
+
+typedef struct mcts mcts;
+
+mcts* mcts_new(void);
+void mcts_free(mcts*);
+int mcts_begin(mcts*, const int, const int, const int, const int);
+int mcts_run(mcts*, const int, uint32_t*);
+int mcts_playouts(const mcts*);
+mcts_action mcts_best(const mcts*);
+void mcts_action_dir(const mcts_action, int*, int*);
+
+#endif /* MCTS_H */
@@ -0,0 +1,209 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mem.h"
+
+#ifndef NO_MEM_ACCOUNTING
+
+/* in front of every allocation; 16 bytes keep malloc()'s alignment */
+struct header {
+	size_t size;
+	short tag;
+	unsigned short offset;  /* from what malloc() returned */
+	int magic;
+};
+
+#define HEADER_SIZE 16
+#define HEADER_MAGIC 0x6d656d21
+
+struct tick {
+	unsigned long allocs;
+	unsigned long frees;
+	size_t bytes;
+	size_t peak;
+};
+
+static const char *_names[MEM_NUM] = {
+	"object", "player", "anim", "list", "batch", "search"
+};
+
+static mem_stats _stats[MEM_NUM];
+static struct tick _cur[MEM_NUM];
+static unsigned long _ticks;
+static unsigned long _total_allocs[MEM_NUM];  /* in completed ticks */
+static unsigned long _dump_every;
+static FILE *_dump_fd;
+
+/* like mem_alloc(), at a multiple of align, a power of two of at most 4096 */
+void* mem_alloc_aligned(const mem_tag tag, const size_t align, const size_t size)
+{
+	struct header *h;
+	mem_stats *s;
+	char *p;
+	size_t offset;
+
+	assert(tag >= 0 && tag < MEM_NUM);
+	assert(align > 0 && align <= 4096 && !(align & (align - 1)));
+
+	p = malloc(HEADER_SIZE + size + align - 1);
+
+	if(!p) {
+		return(NULL);
+	}
+
+	offset = (align - (size_t)(p + HEADER_SIZE) % align) % align;
+	h = (struct header*)(p + offset);
+	h->size = size;
+	h->tag = tag;
+	h->offset = offset;
+	h->magic = HEADER_MAGIC;
+
+	s = &(_stats[tag]);
+	s->allocs++;
+	s->live++;
+	s->bytes += size;
+
+	if(s->bytes > s->peak) {
+		s->peak = s->bytes;
+	}
+
+	_cur[tag].allocs++;
+	_cur[tag].bytes += size;
+
+	if(s->bytes > _cur[tag].peak) {
+		_cur[tag].peak = s->bytes;
+	}
+
+	return((char*)h + HEADER_SIZE);
+}
+
+void* mem_alloc(const mem_tag tag, const size_t size)
+{
+	return(mem_alloc_aligned(tag, 1, size));
+}
+
+void mem_free(const mem_tag tag, void *ptr)
+{
+	struct header *h;
+
+	if(!ptr) {
+		return;
+	}
+
+	h = (struct header*)((char*)ptr - HEADER_SIZE);
+
+	/* catches frees of memory that didn't come from mem_alloc() */
+	assert(h->magic == HEADER_MAGIC && h->tag == (int)tag);
+
+	_stats[h->tag].frees++;
+	_stats[h->tag].live--;
+	_stats[h->tag].bytes -= h->size;
+	_cur[h->tag].frees++;
+
+	h->magic = 0;
+	free((char*)h - h->offset);
+
+	return;
+}
+
+void mem_tick(void)
+{
+	int i;
+
+	for(i = 0; i < MEM_NUM; i++) {
+		mem_stats *s;
+
+		s = &(_stats[i]);
+
+		s->tick_allocs = _cur[i].allocs;
+		s->tick_frees = _cur[i].frees;
+		s->tick_bytes = _cur[i].bytes;
+		s->tick_peak = _cur[i].peak > s->bytes ? _cur[i].peak : s->bytes;
+
+		if(s->tick_allocs > s->max_tick_allocs) {
+			s->max_tick_allocs = s->tick_allocs;
+		}
+
+		_total_allocs[i] += _cur[i].allocs;
+		memset(&(_cur[i]), 0, sizeof(_cur[i]));
+	}
+
+	_ticks++;
+
+	if(_dump_every > 0 && _ticks % _dump_every == 0) {
+		mem_dump(_dump_fd);
+	}
+
+	return;
+}
+
+const mem_stats* mem_get(const mem_tag tag)
+{
+	return(tag >= 0 && tag < MEM_NUM ? &(_stats[tag]) : NULL);
+}
+
+unsigned long mem_ticks(void)
+{
+	return(_ticks);
+}
+
+/* start counting from scratch; live allocations keep being tracked */
+void mem_reset(void)
+{
+	int i;
+
+	for(i = 0; i < MEM_NUM; i++) {
+		unsigned long live;
+		size_t bytes;
+
+		live = _stats[i].live;
+		bytes = _stats[i].bytes;
+		memset(&(_stats[i]), 0, sizeof(_stats[i]));
+		memset(&(_cur[i]), 0, sizeof(_cur[i]));
+		_stats[i].live = live;
+		_stats[i].bytes = bytes;
+		_stats[i].peak = bytes;
+		_total_allocs[i] = 0;
+	}
+
+	_ticks = 0;
+
+	return;
+}
+
+void mem_dump(FILE *fd)
+{
+	int i;
+
+	fprintf(fd, "mem: tick %lu\n", _ticks);
+	fprintf(fd, "%-8s %10s %10s %8s %10s %10s | %6s %6s %8s %6s %8s\n",
+			"tag", "allocs", "frees", "live", "bytes", "peak",
+			"allocs", "frees", "bytes", "max", "avg");
+
+	for(i = 0; i < MEM_NUM; i++) {
+		const mem_stats *s;
+
+		s = &(_stats[i]);
+
+		fprintf(fd, "%-8s %10lu %10lu %8lu %10zu %10zu | %6lu %6lu %8zu %6lu %8.2f\n",
+				_names[i], s->allocs, s->frees, s->live,
+				s->bytes, s->peak, s->tick_allocs, s->tick_frees,
+				s->tick_bytes, s->max_tick_allocs,
+				_ticks ? (double)_total_allocs[i] / _ticks : 0.0);
+	}
+
+	fflush(fd);
+
+	return;
+}
+
+/* dump the stats to fd every n ticks; 0 turns it off */
+void mem_set_dump(const unsigned long n, FILE *fd)
+{
+	_dump_every = n;
+	_dump_fd = fd ? fd : stderr;
+
+	return;
+}
+
+#endif /* NO_MEM_ACCOUNTING */
@@ -0,0 +1,81 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Heap accounting
+ *
+ * All of the engine's allocations go through mem_alloc() and mem_free()
+ * with a tag that says which subsystem they belong to. For every tag we
+ * count allocations, frees and live bytes, overall and per tick, so that
+ * per-tick heap churn can be tracked down and kept at zero. mem_tick()
+ * closes a tick and is called from game_logic().
+ *
+ * Building with -DNO_MEM_ACCOUNTING turns all of this into plain
+ * malloc() and free().
+ */
+
+typedef enum {
+	MEM_OBJECT = 0,  /* board objects (make_object) */
+	MEM_PLAYER,
+	MEM_ANIM,        /* animation instances (anim_get_inst) */
+	MEM_LIST,        /* list_append */
+	MEM_BATCH,       /* batched matches (batch_new) */
+	MEM_SEARCH,      /* the AIs' tree searches (mcts_new) */
+	MEM_NUM
+} mem_tag;
+
+typedef struct {
+	unsigned long allocs;
+	unsigned long frees;
+	unsigned long live;       /* allocations not freed yet */
+	size_t bytes;             /* currently allocated */
+	size_t peak;              /* high-water mark of bytes */
+
+	/* the last completed tick */
+	unsigned long tick_allocs;
+	unsigned long tick_frees;
+	size_t tick_bytes;        /* allocated during the tick */
+	size_t tick_peak;         /* high-water mark during the tick */
+
+	/* worst tick so far */
+	unsigned long max_tick_allocs;
+} mem_stats;
+
+#ifdef NO_MEM_ACCOUNTING
+
+#include <stdlib.h>
+
+static inline void* mem_alloc_aligned(const int tag, const size_t align, const size_t size)
+{
+	void *p;
+
+	return(posix_memalign(&p, align, size) ? NULL : p);
+}
+
+#define mem_alloc(tag, size) malloc(size)
+#define mem_free(tag, ptr)   free(ptr)
+#define mem_tick()
+#define mem_get(tag)         ((const mem_stats*)NULL)
+#define mem_ticks()          0UL
+#define mem_reset()
+#define mem_dump(fd)
+#define mem_set_dump(n, fd)
+
+#else /* NO_MEM_ACCOUNTING */
+
+void* mem_alloc(const mem_tag, const size_t);
+void* mem_alloc_aligned(const mem_tag, const size_t, const size_t);
+void mem_free(const mem_tag, void*);
+void mem_tick(void);
+const mem_stats* mem_get(const mem_tag);
+unsigned long mem_ticks(void);
+void mem_reset(void);
+void mem_dump(FILE*);
+void mem_set_dump(const unsigned long, FILE*);
+
+#endif /* NO_MEM_ACCOUNTING */
+
+#endif /* MEM_H */
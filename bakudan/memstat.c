@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "game.h"
+#include "mem.h"
+
+/*
+ * Plays headless matches and reports the heap accounting (see mem.h),
+ * to find out which subsystems allocate in the steady state.
+ */
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+		   "\n"
+		   "  -m num  matches to play (default: 1)\n"
+		   "  -p num  CPU players per match (default: 2)\n"
+		   "  -s num  seed of the first match (default: 1)\n"
+		   "  -t num  tick limit per match (default: %d)\n"
+		   "  -i num  print the stats every num ticks (default: only at the end)\n"
+		   "  -l num  fail if there are more than num allocations per tick on average\n",
+		   argv0, 3 * 60 * FPS);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned seed;
+	unsigned long every;
+	double limit, per_tick;
+	int matches, players, max_ticks;
+	int opt;
+	int i;
+
+#ifdef NO_MEM_ACCOUNTING
+	fprintf(stderr, "%s: built with NO_MEM_ACCOUNTING\n", argv[0]);
+	return(1);
+#endif /* NO_MEM_ACCOUNTING */
+
+	matches = 1;
+	players = 2;
+	seed = 1;
+	max_ticks = 3 * 60 * FPS;
+	every = 0;
+	limit = -1;
+
+	while((opt = getopt(argc, argv, "m:p:s:t:i:l:h")) != -1) {
+		switch(opt) {
+		case 'm':
+			matches = atoi(optarg);
+			break;
+
+		case 'p':
+			players = atoi(optarg);
+			break;
+
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+
+		case 't':
+			max_ticks = atoi(optarg);
+			break;
+
+		case 'i':
+			every = strtoul(optarg, NULL, 10);
+			break;
+
+		case 'l':
+			limit = atof(optarg);
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if(players < 2 || players > MAX_PLAYERS) {
+		_usage(argv[0]);
+		return(1);
+	}
+
+	mem_set_dump(every, stdout);
+
+	for(i = 0; i < matches; i++) {
+		int ticks;
+
+		game_seed(seed + i);
+
+		if(game_init(0, players) < 0) {
+			fprintf(stderr, "game_init failed\n");
+			return(1);
+		}
+
+		for(ticks = 0; ticks < max_ticks && !game_is_over(); ticks++) {
+			game_logic();
+			game_animate();
+		}
+
+		game_cleanup();
+	}
+
+	/* close the last tick so that it shows up in the totals */
+	mem_tick();
+	mem_dump(stdout);
+
+	for(per_tick = 0, i = 0; i < MEM_NUM; i++) {
+		per_tick += mem_get(i)->allocs;
+	}
+
+	per_tick /= mem_ticks();
+
+	if(limit >= 0 && per_tick > limit) {
+		fprintf(stderr, "%.2f allocations per tick, limit is %.2f\n", per_tick, limit);
+		return(1);
+	}
+
+	return(0);
+}
@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "game.h"
+#include "ai.h"
+#include "rng.h"
+#include "spatial.h"
+#include "tool.h"
+
+/*
+ * Benchmark for ai_find_path
+ *
+ * Searches from a spawn to every cell of the starting field, where all
+ * boulders are still in place, and reports calls per second. With -g the
+ * CPU players first play for a while, which opens the field up and makes
+ * the searches longer. The number of steps of all paths is printed as
+ * well, so that two versions of the search can be checked for returning
+ * paths of the same length. -S times ai_safe_path instead, from where
+ * the first player stands, around the bombs that are ticking on the field.
+ * -c times nothing: after every one of the -g ticks, it checks what the
+ * spatial index and ai_find_refugee return against scans of the field.
+ */
+
+/* the closest object by brute force, with the same ties as spatial_nearest() */
+static object* _scan_nearest(const object_type t, const int x, const int y)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	object *best;
+	int bd, i, j;
+
+	best = NULL;
+	bd = 0;
+
+	for(i = 0; i < WIDTH; i++) {
+		for(j = 0; j < HEIGHT; j++) {
+			int d;
+
+			d = abs(i - x) + abs(j - y);
+
+			if(objects[i][j] && objects[i][j]->type == t && d > 0 && (!best || d < bd)) {
+				best = objects[i][j];
+				bd = d;
+			}
+		}
+	}
+
+	return(best);
+}
+
+/* ai_find_refugee() the way it was, a cell at a time */
+static int _scan_refugee(const int x, const int y, const int tolerance, int *dx, int *dy)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	int dist;
+
+	for(dist = 1; dist < WIDTH + HEIGHT; dist++) {
+		int a, b, k;
+
+		for(a = dist, b = 0; a >= 0; a--, b++) {
+			for(k = 0; k < 4; k++) {
+				int cx, cy;
+				object *o;
+
+				cx = k < 2 ? x + a : x - a;
+				cy = k % 2 ? y - b : y + b;
+
+				if(cx <= 0 || cy <= 0 || cx >= WIDTH || cy >= HEIGHT) {
+					continue;
+				}
+
+				o = objects[cx][cy];
+
+				if((!o || (o->passable && o->type != OBJECT_TYPE_BOMB)) &&
+				   !game_location_dangerous(cx, cy, tolerance)) {
+					*dx = cx;
+					*dy = cy;
+					return(0);
+				}
+			}
+		}
+	}
+
+	return(-1);
+}
+
+/* the number of things the index got wrong about the field as it is */
+static int _check(uint32_t *rng)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	int errors, t, i;
+
+	errors = 0;
+
+	for(t = OBJECT_TYPE_WALL; t <= OBJECT_TYPE_BOMB; t++) {
+		spatial_iter it;
+		object *o;
+		int x0, y0, x1, y1;
+		int total, inside, found;
+		int x, y;
+
+		x0 = rng_range(rng, 0, WIDTH);
+		x1 = rng_range(rng, x0, WIDTH);
+		y0 = rng_range(rng, 0, HEIGHT);
+		y1 = rng_range(rng, y0, HEIGHT);
+		total = 0;
+		inside = 0;
+
+		for(x = 0; x < WIDTH; x++) {
+			for(y = 0; y < HEIGHT; y++) {
+				if(objects[x][y] && objects[x][y]->type == t) {
+					total++;
+					inside += x >= x0 && x <= x1 && y >= y0 && y <= y1;
+				}
+			}
+		}
+
+		found = 0;
+		spatial_begin(&it, t, x0, y0, x1, y1);
+
+		while((o = spatial_next(&it))) {
+			found++;
+
+			if(o != objects[obj_x(o)][obj_y(o)] || o->type != t ||
+			   obj_x(o) < x0 || obj_x(o) > x1 || obj_y(o) < y0 || obj_y(o) > y1) {
+				errors++;
+			}
+		}
+
+		errors += spatial_count(t) != total;
+		errors += found != inside;
+
+		for(i = 0; i < 4; i++) {
+			object *a, *b;
+
+			x = rng_range(rng, 0, WIDTH);
+			y = rng_range(rng, 0, HEIGHT);
+			a = spatial_nearest(t, x, y);
+			b = _scan_nearest(t, x, y);
+
+			/* another one just as close is fine */
+			if(!a != !b || (a && abs(obj_x(a) - x) + abs(obj_y(a) - y) !=
+							abs(obj_x(b) - x) + abs(obj_y(b) - y))) {
+				errors++;
+			}
+		}
+	}
+
+	for(i = 0; i < 4; i++) {
+		int x, y, tol, ax, ay, bx, by, a, b;
+
+		x = rng_range(rng, 1, WIDTH - 1);
+		y = rng_range(rng, 1, HEIGHT - 1);
+		tol = rng_range(rng, 0, PLAYER_DEFAULT_STRENGTH);
+		a = ai_find_refugee(x, y, tol, &ax, &ay);
+		b = _scan_refugee(x, y, tol, &bx, &by);
+
+		if((a < 0) != (b < 0) || (a >= 0 && (ax != bx || ay != by))) {
+			errors++;
+		}
+	}
+
+	return(errors);
+}
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+		   "\n"
+		   "  -t sec  how long to run (default: 2)\n"
+		   "  -s num  seed of the field (default: 1)\n"
+		   "  -g num  ticks to play before searching (default: 0)\n"
+		   "  -f      only ask for the first step (ai_find_step)\n"
+		   "  -S      search around the bombs' fuses (ai_safe_path)\n"
+		   "  -c      check the spatial index in every tick played instead\n",
+		   argv0);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long calls, found, length;
+	double seconds, start, elapsed;
+	unsigned seed;
+	ai_path path;
+	int first, safe, check;
+	int ticks;
+	int opt;
+
+	seconds = 2;
+	seed = 1;
+	ticks = 0;
+	first = 0;
+	safe = 0;
+	check = 0;
+
+	while((opt = getopt(argc, argv, "t:s:g:fSch")) != -1) {
+		switch(opt) {
+		case 't':
+			seconds = atof(optarg);
+			break;
+
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+
+		case 'g':
+			ticks = atoi(optarg);
+			break;
+
+		case 'f':
+			first = 1;
+			break;
+
+		case 'S':
+			safe = 1;
+			break;
+
+		case 'c':
+			check = 1;
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	game_seed(seed);
+
+	if(game_init(0, 2) < 0) {
+		fprintf(stderr, "game_init failed\n");
+		return(1);
+	}
+
+	if(check) {
+		unsigned long checked, errors;
+		uint32_t rng;
+
+		rng = rng_seed(seed);
+		checked = 0;
+		errors = 0;
+
+		while(ticks-- > 0 && !game_is_over()) {
+			game_logic();
+			game_animate();
+			errors += _check(&rng);
+			checked++;
+		}
+
+		printf("%lu ticks checked, %lu errors\n", checked, errors);
+		game_cleanup();
+
+		return(errors ? 1 : 0);
+	}
+
+	while(ticks-- > 0 && !game_is_over()) {
+		game_logic();
+		game_animate();
+	}
+
+	calls = 0;
+	found = 0;
+	length = 0;
+	start = tool_now();
+
+	do {
+		int x, y;
+
+		/* the way the AI looks for boulders: the last step may be blocked */
+		for(x = 0; x < WIDTH; x++) {
+			for(y = 0; y < HEIGHT; y++) {
+				int n, nx, ny;
+
+				if(safe) {
+					n = ai_safe_path(0, x, y, 0, &path);
+				} else if(first) {
+					n = ai_find_step(1, 1, x, y, 1, &nx, &ny);
+				} else {
+					n = ai_find_path(1, 1, x, y, 1, &path);
+				}
+
+				calls++;
+
+				if(n >= 0) {
+					found++;
+					length += n;
+				}
+			}
+		}
+
+		elapsed = tool_now() - start;
+	} while(elapsed < seconds);
+
+	printf("%lu calls in %.2fs: %.0f calls/s, %.2fus per call\n",
+		   calls, elapsed, calls / elapsed, elapsed * 1e6 / calls);
+	printf("%lu paths found, %lu steps per pass\n",
+		   found / (calls / (WIDTH * HEIGHT)),
+		   length / (calls / (WIDTH * HEIGHT)));
+
+	game_cleanup();
+
+	return(0);
+}
@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "pool.h"
+
+struct pool_shared {
+	int next;
+	char results[];
+};
+
+int pool_workers(void)
+{
+	long n;
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return(n > 0 ? (int)n : 1);
+}
+
+static void _pool_worker(struct pool_shared *sh, const int njobs, pool_job job,
+						 void *arg, const size_t size)
+{
+	int i;
+
+	while((i = __atomic_fetch_add(&(sh->next), 1, __ATOMIC_RELAXED)) < njobs) {
+		job(i, arg, sh->results + (size_t)i * size);
+	}
+
+	return;
+}
+
+/*
+ * Run job(i, arg, &results[i]) for 0 <= i < njobs on `workers' processes
+ * (all cores if workers <= 0). Each result is `size' bytes.
+ */
+int pool_run(const int njobs, const int nworkers, pool_job job, void *arg,
+			 void *results, const size_t size)
+{
+	struct pool_shared *sh;
+	size_t len;
+	pid_t *pids;
+	int ret_val;
+	int workers;
+	int i;
+
+	if(njobs <= 0) {
+		return(0);
+	}
+
+	workers = nworkers > 0 ? nworkers : pool_workers();
+
+	if(workers > njobs) {
+		workers = njobs;
+	}
+
+	len = sizeof(*sh) + (size_t)njobs * size;
+	sh = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if(sh == MAP_FAILED) {
+		return(-errno);
+	}
+
+	pids = malloc(sizeof(*pids) * workers);
+
+	if(!pids) {
+		munmap(sh, len);
+		return(-ENOMEM);
+	}
+
+	ret_val = 0;
+	sh->next = 0;
+
+	for(i = 0; i < workers; i++) {
+		pids[i] = fork();
+
+		if(pids[i] == 0) {
+			_pool_worker(sh, njobs, job, arg, size);
+			_exit(0);
+		}
+
+		if(pids[i] < 0) {
+			/* make do with the workers we have */
+			break;
+		}
+	}
+
+	if(i == 0) {
+		/* couldn't fork at all, so do the work here */
+		_pool_worker(sh, njobs, job, arg, size);
+	}
+
+	while(--i >= 0) {
+		int status;
+
+		if(waitpid(pids[i], &status, 0) < 0 ||
+		   !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			ret_val = -ECHILD;
+		}
+	}
+
+	if(ret_val == 0) {
+		memcpy(results, sh->results, (size_t)njobs * size);
+	}
+
+	free(pids);
+	munmap(sh, len);
+
+	return(ret_val);
+}
@@ -0,0 +1,19 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/*
+ * Runs independent jobs on all cores. Since the engine keeps its state
+ * in globals, the workers are forked processes rather than threads.
+ * Jobs are handed out one at a time, so long and short jobs balance
+ * out, and the results end up in the caller's array in job order no
+ * matter which worker ran them.
+ */
+
+typedef void (*pool_job)(const int, void*, void*);
+
+int pool_workers(void);
+int pool_run(const int, const int, pool_job, void*, void*, const size_t);
+
+#endif /* POOL_H */
@@ -0,0 +1,150 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include "record.h"
+
+/* clamp stats into the record's fields */
+static int16_t _s16(const int v)
+{
+	return(v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : (int16_t)v);
+}
+
+/* describe the current match; call before game_cleanup() */
+void record_from_game(match_record *rec)
+{
+	int i, n;
+
+	memset(rec, 0, sizeof(*rec));
+
+	n = game_num_players();
+
+	rec->magic = RECORD_MAGIC;
+	rec->version = RECORD_VERSION;
+	rec->size = sizeof(*rec);
+	rec->seed = game_get_seed();
+	rec->ticks = (int32_t)game_ticks();
+	rec->nplayers = (int8_t)n;
+	rec->winner = (int8_t)game_get_winner();
+	rec->over = (int8_t)game_is_over();
+
+	for(i = 0; i < n && i < MAX_PLAYERS; i++) {
+		record_player *rp;
+		ai_config cfg;
+		player *p;
+
+		rp = &(rec->player[i]);
+		p = game_player_num(i);
+
+		if(ai_get_config(i, &cfg) == 0) {
+			int j;
+
+			rp->cpu = 1;
+			rp->tolerance = cfg.tolerance;
+			rp->radius = _s16(cfg.radius);
+			rp->playouts = _s16(cfg.playouts);
+
+			for(j = 0; j < AI_TARGET_NUM; j++) {
+				rp->priority[j] = (int8_t)cfg.priority[j];
+			}
+		}
+
+		rp->alive = (int8_t)p->alive;
+		rp->frags = _s16(p->frags);
+		rp->deaths = _s16(p->deaths);
+		rp->suicides = _s16(p->suicides);
+		rp->boulders = _s16(p->boulders);
+		rp->items = _s16(p->items);
+		rp->lifes = _s16(p->lifes);
+	}
+
+	return;
+}
+
+void record_config(const record_player *rp, ai_config *cfg)
+{
+	int j;
+
+	ai_config_default(cfg);
+
+	cfg->tolerance = rp->tolerance;
+	cfg->radius = rp->radius;
+	cfg->playouts = rp->playouts;
+
+	for(j = 0; j < AI_TARGET_NUM; j++) {
+		cfg->priority[j] = rp->priority[j];
+	}
+
+	return;
+}
+
+/*
+ * Append n records to the file at path. O_APPEND and a single write
+ * keep records from concurrent writers from interleaving.
+ */
+int record_append(const char *path, const match_record *rec, const int n)
+{
+	ssize_t len;
+	int ret_val;
+	int fd;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+	if(fd < 0) {
+		return(-errno);
+	}
+
+	len = (ssize_t)sizeof(*rec) * n;
+	ret_val = 0;
+
+	if(write(fd, rec, len) != len) {
+		ret_val = errno ? -errno : -EIO;
+	}
+
+	if(close(fd) < 0 && ret_val == 0) {
+		ret_val = -errno;
+	}
+
+	return(ret_val);
+}
+
+/*
+ * Returns 1 if a record was read, 0 at the end of the file. Records of an
+ * older version are skipped with -EPROTO, since their layout differs.
+ */
+int record_read(FILE *fd, match_record *rec)
+{
+	size_t head, n;
+
+	head = offsetof(match_record, seed);
+	n = fread(rec, 1, head, fd);
+
+	if(n == 0 && feof(fd)) {
+		return(0);
+	}
+
+	if(n < head || rec->magic != RECORD_MAGIC || rec->size < head) {
+		return(-EINVAL);
+	}
+
+	if(rec->version < RECORD_VERSION || rec->size < sizeof(*rec)) {
+		if(fseek(fd, rec->size - head, SEEK_CUR) < 0) {
+			return(-errno);
+		}
+
+		return(-EPROTO);
+	}
+
+	if(fread((char*)rec + head, 1, sizeof(*rec) - head, fd) < sizeof(*rec) - head) {
+		return(-EINVAL);
+	}
+
+	/* newer records may be longer; skip what we don't know */
+	if(rec->size > sizeof(*rec) &&
+	   fseek(fd, rec->size - sizeof(*rec), SEEK_CUR) < 0) {
+		return(-errno);
+	}
+
+	return(1);
+}
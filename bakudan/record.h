@@ -0,0 +1,59 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "game.h"
+#include "ai.h"
+
+/*
+ * Match records
+ *
+ * One fixed-size binary record per finished match, appended to a file
+ * with a single write so that several processes can share one file.
+ * Records carry their own magic, version and size, so a reader can skip
+ * records written by a newer version and notice corrupted files.
+ */
+
+#define RECORD_MAGIC   0x4d4b4142  /* "BAKM" */
+#define RECORD_VERSION 2
+#define RECORD_ENV     "BAKUDAN_RECORDS"
+
+typedef struct {
+	/* configuration; only meaningful for CPU players */
+	float tolerance;
+	int16_t radius;
+	int8_t priority[AI_TARGET_NUM];
+	int8_t cpu;
+	int8_t alive;
+	int8_t reserved;
+	int16_t playouts;   /* of the tree search, 0 for the rules */
+
+	/* stats, as in the player struct */
+	int16_t frags;
+	int16_t deaths;
+	int16_t suicides;
+	int16_t boulders;
+	int16_t items;
+	int16_t lifes;
+} record_player;
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t size;
+	uint32_t seed;     /* 0 if the match wasn't seeded */
+	int32_t ticks;
+	int8_t nplayers;
+	int8_t winner;     /* -1 for a draw */
+	int8_t over;       /* 0 if the match hit a tick limit */
+	int8_t reserved;
+	record_player player[MAX_PLAYERS];
+} match_record;
+
+void record_from_game(match_record*);
+void record_config(const record_player*, ai_config*);
+int record_append(const char*, const match_record*, const int);
+int record_read(FILE*, match_record*);
+
+#endif /* RECORD_H */
@@ -0,0 +1,426 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include "record.h"
+
+/*
+ * Summarizes match records in a single pass with fixed memory, no
+ * matter how many records there are: per configuration, per seat and
+ * overall, with the match length distribution kept as a histogram of
+ * whole seconds.
+ */
+
+#define MAX_GROUPS   1024         /* power of two */
+#define LENGTH_BINS  1024         /* seconds */
+#define NUM_STATS    6
+
+enum {
+	STAT_FRAGS = 0,
+	STAT_DEATHS,
+	STAT_SUICIDES,
+	STAT_BOULDERS,
+	STAT_ITEMS,
+	STAT_TICKS
+};
+
+/* running mean and variance (Welford) */
+struct moments {
+	double mean;
+	double m2;
+};
+
+struct group {
+	int used;
+	record_player key;    /* configuration part only */
+	unsigned long games;
+	unsigned long wins;
+	unsigned long draws;
+	unsigned long losses;
+	struct moments stat[NUM_STATS];
+};
+
+struct seat {
+	unsigned long games;
+	unsigned long wins;
+};
+
+static struct group _groups[MAX_GROUPS];
+static struct group _other;  /* everything that didn't fit */
+static int _ngroups;
+static struct seat _seats[MAX_PLAYERS];
+static unsigned long _lengths[LENGTH_BINS];
+static unsigned long _records;
+static unsigned long _draws;
+static unsigned long _timeouts;
+static unsigned long _invalid;
+static struct moments _ticks;
+
+static void _moments_add(struct moments *m, const unsigned long n, const double v)
+{
+	double d;
+
+	/* n is the number of samples including this one */
+	d = v - m->mean;
+	m->mean += d / n;
+	m->m2 += d * (v - m->mean);
+
+	return;
+}
+
+static double _stddev(const struct moments *m, const unsigned long n)
+{
+	return(n > 1 ? sqrt(m->m2 / (n - 1)) : 0);
+}
+
+static void _key(const record_player *rp, record_player *key)
+{
+	memset(key, 0, sizeof(*key));
+
+	key->cpu = rp->cpu;
+
+	if(rp->cpu) {
+		key->tolerance = rp->tolerance;
+		key->radius = rp->radius;
+		key->playouts = rp->playouts;
+		memcpy(key->priority, rp->priority, sizeof(key->priority));
+	}
+
+	return;
+}
+
+static unsigned _hash(const record_player *key)
+{
+	const unsigned char *b;
+	unsigned h;
+	size_t i;
+
+	/* FNV-1a over the configuration */
+	b = (const unsigned char*)key;
+	h = 2166136261u;
+
+	for(i = 0; i < offsetof(record_player, frags); i++) {
+		h = (h ^ b[i]) * 16777619u;
+	}
+
+	return(h);
+}
+
+static struct group* _group(const record_player *rp)
+{
+	record_player key;
+	unsigned h;
+	int i;
+
+	_key(rp, &key);
+	h = _hash(&key);
+
+	for(i = 0; i < MAX_GROUPS; i++) {
+		struct group *g;
+
+		g = &(_groups[(h + i) & (MAX_GROUPS - 1)]);
+
+		if(!g->used) {
+			/* keep the table at most half full so that probes stay short */
+			if(_ngroups >= MAX_GROUPS / 2) {
+				break;
+			}
+
+			g->used = 1;
+			g->key = key;
+			_ngroups++;
+
+			return(g);
+		}
+
+		if(!memcmp(&(g->key), &key, offsetof(record_player, frags))) {
+			return(g);
+		}
+	}
+
+	return(&_other);
+}
+
+static void _add(const match_record *rec)
+{
+	unsigned bin;
+	int i;
+
+	_records++;
+	_draws += rec->winner < 0;
+	_timeouts += !rec->over;
+	_moments_add(&_ticks, _records, rec->ticks);
+
+	bin = rec->ticks / FPS;
+	_lengths[bin < LENGTH_BINS ? bin : LENGTH_BINS - 1]++;
+
+	for(i = 0; i < rec->nplayers && i < MAX_PLAYERS; i++) {
+		const record_player *rp;
+		struct group *g;
+		double v[NUM_STATS];
+		int j;
+
+		rp = &(rec->player[i]);
+		g = _group(rp);
+
+		g->games++;
+		g->wins += rec->winner == i;
+		g->draws += rec->winner < 0;
+		g->losses += rec->winner >= 0 && rec->winner != i;
+
+		v[STAT_FRAGS] = rp->frags;
+		v[STAT_DEATHS] = rp->deaths;
+		v[STAT_SUICIDES] = rp->suicides;
+		v[STAT_BOULDERS] = rp->boulders;
+		v[STAT_ITEMS] = rp->items;
+		v[STAT_TICKS] = rec->ticks;
+
+		for(j = 0; j < NUM_STATS; j++) {
+			_moments_add(&(g->stat[j]), g->games, v[j]);
+		}
+
+		_seats[i].games++;
+		_seats[i].wins += rec->winner == i;
+	}
+
+	return;
+}
+
+static void _dump(const match_record *rec)
+{
+	int i;
+
+	printf("{\"seed\":%u,\"ticks\":%d,\"over\":%d,\"winner\":%d,\"players\":[",
+		   rec->seed, rec->ticks, rec->over, rec->winner);
+
+	for(i = 0; i < rec->nplayers && i < MAX_PLAYERS; i++) {
+		const record_player *rp;
+
+		rp = &(rec->player[i]);
+
+		printf("%s{", i > 0 ? "," : "");
+
+		if(rp->cpu) {
+			ai_config cfg;
+			char spec[128];
+
+			record_config(rp, &cfg);
+			ai_config_format(&cfg, spec, sizeof(spec));
+			printf("\"config\":\"%s\",", spec);
+		}
+
+		printf("\"alive\":%d,\"frags\":%d,\"deaths\":%d,\"suicides\":%d,"
+			   "\"boulders\":%d,\"items\":%d,\"lifes\":%d}",
+			   rp->alive, rp->frags, rp->deaths, rp->suicides,
+			   rp->boulders, rp->items, rp->lifes);
+	}
+
+	printf("]}\n");
+
+	return;
+}
+
+static int _read(FILE *fd, const char *name, const int dump)
+{
+	match_record rec;
+	int ret;
+
+	while((ret = record_read(fd, &rec)) > 0 || ret == -EPROTO) {
+		if(ret < 0 || rec.nplayers < 1 || rec.nplayers > MAX_PLAYERS ||
+		   rec.winner >= rec.nplayers || rec.ticks < 0) {
+			_invalid++;
+			continue;
+		}
+
+		if(dump) {
+			_dump(&rec);
+		} else {
+			_add(&rec);
+		}
+	}
+
+	if(ret < 0) {
+		fprintf(stderr, "%s: %s\n", name, strerror(-ret));
+	}
+
+	return(ret);
+}
+
+static int _by_games(const void *a, const void *b)
+{
+	const struct group *ga, *gb;
+
+	ga = *(const struct group* const*)a;
+	gb = *(const struct group* const*)b;
+
+	return(ga->games < gb->games ? 1 : ga->games > gb->games ? -1 : 0);
+}
+
+static double _quantile(const double q)
+{
+	unsigned long target, sum;
+	int i;
+
+	target = (unsigned long)ceil(q * _records);
+
+	for(sum = 0, i = 0; i < LENGTH_BINS; i++) {
+		sum += _lengths[i];
+
+		if(sum >= target && sum > 0) {
+			break;
+		}
+	}
+
+	return(i);
+}
+
+static void _print_group(const struct group *g, const char *name)
+{
+	double n;
+
+	n = g->games;
+
+	printf("%-64s %8lu %5.1f%% %5.1f%% %5.1f%% %5.2f±%-5.2f %5.2f %6.2f %5.2f %7.0f\n",
+		   name, g->games,
+		   100.0 * g->wins / n, 100.0 * g->draws / n, 100.0 * g->losses / n,
+		   g->stat[STAT_FRAGS].mean, _stddev(&(g->stat[STAT_FRAGS]), g->games),
+		   g->stat[STAT_SUICIDES].mean, g->stat[STAT_BOULDERS].mean,
+		   g->stat[STAT_ITEMS].mean, g->stat[STAT_TICKS].mean);
+
+	return;
+}
+
+static void _report(const int top)
+{
+	struct group *sorted[MAX_GROUPS];
+	int i, n;
+
+	printf("%lu matches, %.1f%% draws, %.1f%% hit the tick limit",
+		   _records, _records ? 100.0 * _draws / _records : 0,
+		   _records ? 100.0 * _timeouts / _records : 0);
+
+	if(_invalid > 0) {
+		printf(", %lu invalid records skipped", _invalid);
+	}
+
+	printf("\nlength: mean %.0f±%.0f ticks, p50 %.0fs p90 %.0fs p99 %.0fs\n\n",
+		   _ticks.mean, _stddev(&_ticks, _records),
+		   _quantile(0.5), _quantile(0.9), _quantile(0.99));
+
+	for(n = 0, i = 0; i < MAX_GROUPS; i++) {
+		if(_groups[i].used) {
+			sorted[n++] = &(_groups[i]);
+		}
+	}
+
+	qsort(sorted, n, sizeof(sorted[0]), _by_games);
+
+	printf("%-64s %8s %6s %6s %6s %11s %5s %6s %5s %7s\n",
+		   "config", "games", "win", "draw", "loss", "frags", "sui", "blds",
+		   "items", "ticks");
+
+	for(i = 0; i < n && i < top; i++) {
+		char name[128];
+
+		if(sorted[i]->key.cpu) {
+			ai_config cfg;
+
+			record_config(&(sorted[i]->key), &cfg);
+			ai_config_format(&cfg, name, sizeof(name));
+		} else {
+			strcpy(name, "human");
+		}
+
+		_print_group(sorted[i], name);
+	}
+
+	if(n > top) {
+		printf("(%d more configs)\n", n - top);
+	}
+
+	if(_other.games > 0) {
+		_print_group(&_other, "(other)");
+	}
+
+	printf("\n%-6s %8s %6s\n", "seat", "games", "win");
+
+	for(i = 0; i < MAX_PLAYERS; i++) {
+		if(_seats[i].games > 0) {
+			printf("P%-5d %8lu %5.1f%%\n", i + 1, _seats[i].games,
+				   100.0 * _seats[i].wins / _seats[i].games);
+		}
+	}
+
+	return;
+}
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [options] [file...]\n"
+		   "\n"
+		   "Reads match records from the files, or stdin if there are none.\n"
+		   "\n"
+		   "  -d      print the records as JSON lines instead\n"
+		   "  -n num  configurations to list (default: 20)\n",
+		   argv0);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	int dump, top;
+	int ret_val;
+	int opt;
+	int i;
+
+	dump = 0;
+	top = 20;
+	ret_val = 0;
+
+	while((opt = getopt(argc, argv, "dn:h")) != -1) {
+		switch(opt) {
+		case 'd':
+			dump = 1;
+			break;
+
+		case 'n':
+			top = atoi(optarg);
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if(optind >= argc) {
+		ret_val = _read(stdin, "stdin", dump) < 0;
+	}
+
+	for(i = optind; i < argc; i++) {
+		FILE *fd;
+
+		fd = fopen(argv[i], "rb");
+
+		if(!fd) {
+			fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+			ret_val = 1;
+			continue;
+		}
+
+		if(_read(fd, argv[i], dump) < 0) {
+			ret_val = 1;
+		}
+
+		fclose(fd);
+	}
+
+	if(!dump) {
+		_report(top);
+	}
+
+	return(ret_val);
+}
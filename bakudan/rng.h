@@ -0,0 +1,48 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+ * Small deterministic PRNG (xorshift32) used whenever a match is
+ * seeded. Kept in a header so that the scalar engine and the batched
+ * engine draw exactly the same numbers for the same seed.
+ */
+
+static inline uint32_t rng_seed(const unsigned seed)
+{
+	uint32_t s;
+
+	/* scramble the seed a bit; xorshift must never be seeded with 0 */
+	s = (uint32_t)seed * 0x9e3779b9u + 0x7f4a7c15u;
+	s ^= s >> 16;
+
+	return(s ? s : 0x2545f491u);
+}
+
+static inline uint32_t rng_next(uint32_t *s)
+{
+	uint32_t x;
+
+	x = *s;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*s = x;
+
+	return(x);
+}
+
+/* same semantics as game_ask_universe(): 1 with a probability of prob% */
+static inline int rng_chance(uint32_t *s, const int prob)
+{
+	return((int)(rng_next(s) % 100) < prob ? 1 : 0);
+}
+
+/* same semantics as game_ask_universe2(): l <= rnd < u */
+static inline int rng_range(uint32_t *s, const int l, const int u)
+{
+	return(l + (int)(rng_next(s) % (uint32_t)(u - l)));
+}
+
+#endif /* RNG_H */
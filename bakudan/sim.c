@@ -0,0 +1,121 @@
+#include <string.h>
+#include <errno.h>
+#include "sim.h"
+
+void sim_config_default(sim_config *cfg)
+{
+	int i;
+
+	memset(cfg, 0, sizeof(*cfg));
+
+	cfg->seed = 1;
+	cfg->players = 2;
+	cfg->max_ticks = SIM_DEFAULT_TICKS;
+
+	for(i = 0; i < MAX_PLAYERS; i++) {
+		ai_config_default(&(cfg->ai[i]));
+	}
+
+	return;
+}
+
+/* -1, 0 or 1 as player a is behind, tied with or ahead of b, see sim.h */
+static int _ahead(const sim_player *a, const sim_player *b)
+{
+	if(a->alive != b->alive) {
+		return(a->alive ? 1 : -1);
+	}
+
+	if(a->lifes != b->lifes) {
+		return(a->lifes > b->lifes ? 1 : -1);
+	}
+
+	if(a->boulders != b->boulders) {
+		return(a->boulders > b->boulders ? 1 : -1);
+	}
+
+	if(a->items != b->items) {
+		return(a->items > b->items ? 1 : -1);
+	}
+
+	return(0);
+}
+
+static int _leader(const sim_result *res, const int n)
+{
+	int best, tied, i;
+
+	if(res->winner >= 0) {
+		return(res->winner);
+	}
+
+	best = 0;
+	tied = 0;
+
+	for(i = 1; i < n; i++) {
+		int d;
+
+		d = _ahead(&(res->player[i]), &(res->player[best]));
+
+		if(d > 0) {
+			best = i;
+			tied = 0;
+		} else if(d == 0) {
+			tied = 1;
+		}
+	}
+
+	return(tied ? -1 : best);
+}
+
+int sim_run(const sim_config *cfg, sim_result *res)
+{
+	int ret_val;
+	int i;
+
+	if(cfg->players < 2 || cfg->players > MAX_PLAYERS) {
+		return(-EINVAL);
+	}
+
+	memset(res, 0, sizeof(*res));
+
+	game_seed(cfg->seed);
+	ret_val = game_init(0, cfg->players);
+
+	if(ret_val < 0) {
+		return(ret_val);
+	}
+
+	for(i = 0; i < cfg->players; i++) {
+		ai_configure(i, &(cfg->ai[i]));
+	}
+
+	/* same order as _process() in the engine */
+	while(res->ticks < cfg->max_ticks && !game_is_over()) {
+		game_logic();
+		game_animate();
+		res->ticks++;
+	}
+
+	res->winner = game_get_winner();
+
+	for(i = 0; i < cfg->players; i++) {
+		player *p;
+
+		p = game_player_num(i);
+
+		res->player[i].frags = p->frags;
+		res->player[i].deaths = p->deaths;
+		res->player[i].suicides = p->suicides;
+		res->player[i].boulders = p->boulders;
+		res->player[i].items = p->items;
+		res->player[i].lifes = p->lifes;
+		res->player[i].alive = p->alive;
+	}
+
+	res->leader = _leader(res, cfg->players);
+	record_from_game(&(res->record));
+	game_cleanup();
+
+	return(0);
+}
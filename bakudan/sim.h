@@ -0,0 +1,50 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "game.h"
+#include "ai.h"
+#include "record.h"
+
+/*
+ * Headless matches between CPU players, for tools that need to play
+ * lots of games (tournaments, tuning). Only one match can be running
+ * per process, since the engine keeps its state in globals; see pool.h
+ * for running many of them in parallel.
+ *
+ * CPU players hardly ever die, so most matches hit the tick limit. The
+ * leader of such a match is the player who is ahead there: the one with
+ * the most lives left, then the most boulders cleared, then the most
+ * items picked up. Tools that rate configurations go by the leader.
+ */
+
+#define SIM_DEFAULT_TICKS (3 * 60 * FPS)
+
+typedef struct {
+	unsigned seed;
+	int players;
+	int max_ticks;
+	ai_config ai[MAX_PLAYERS];
+} sim_config;
+
+typedef struct {
+	int frags;
+	int deaths;
+	int suicides;
+	int boulders;
+	int items;
+	int lifes;
+	int alive;
+} sim_player;
+
+typedef struct {
+	int ticks;
+	int winner;     /* -1 if the match ended in a draw */
+	int leader;     /* the winner, or who's ahead at the tick limit; -1 if tied */
+	sim_player player[MAX_PLAYERS];
+	match_record record;
+} sim_result;
+
+void sim_config_default(sim_config*);
+int sim_run(const sim_config*, sim_result*);
+
+#endif /* SIM_H */
@@ -0,0 +1,257 @@
+#include <string.h>
+#include "spatial.h"
+
+#define CELLS   (WIDTH * HEIGHT)
+#define BUCKETS (SPATIAL_BUCKETS_X * SPATIAL_BUCKETS_Y)
+#define TYPES   (OBJECT_TYPE_PLAYER + 1)
+
+#define CELL(x,y)   ((x) * HEIGHT + (y))
+#define BUCKET(x,y) (((x) / SPATIAL_BUCKET) * SPATIAL_BUCKETS_Y + (y) / SPATIAL_BUCKET)
+
+/*
+ * Cells are kept plus one, so that 0 is the end of a list and an empty
+ * index needs no setting up.
+ */
+static struct {
+	int head[TYPES][BUCKETS];    /* first cell of the list */
+	int total[TYPES];
+	int next[CELLS];             /* in the list of the cell's bucket and type */
+	int prev[CELLS];
+	unsigned char type[CELLS];   /* of the object in the cell plus one, 0 if none */
+} _spatial;
+
+static void _remove(const int x, const int y)
+{
+	int c, t, b;
+
+	c = CELL(x, y);
+
+	if(!_spatial.type[c]) {
+		return;
+	}
+
+	t = _spatial.type[c] - 1;
+	b = BUCKET(x, y);
+
+	if(_spatial.prev[c]) {
+		_spatial.next[_spatial.prev[c] - 1] = _spatial.next[c];
+	} else {
+		_spatial.head[t][b] = _spatial.next[c];
+	}
+
+	if(_spatial.next[c]) {
+		_spatial.prev[_spatial.next[c] - 1] = _spatial.prev[c];
+	}
+
+	_spatial.total[t]--;
+	_spatial.type[c] = 0;
+
+	return;
+}
+
+static void _insert(const int x, const int y, const object_type t)
+{
+	int c, b;
+
+	c = CELL(x, y);
+	b = BUCKET(x, y);
+
+	_spatial.type[c] = t + 1;
+	_spatial.prev[c] = 0;
+	_spatial.next[c] = _spatial.head[t][b];
+
+	if(_spatial.head[t][b]) {
+		_spatial.prev[_spatial.head[t][b] - 1] = c + 1;
+	}
+
+	_spatial.head[t][b] = c + 1;
+	_spatial.total[t]++;
+
+	return;
+}
+
+/* forget everything, and index the object table as it is now */
+void spatial_reset(void)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	int x, y;
+
+	memset(&_spatial, 0, sizeof(_spatial));
+
+	for(x = 0; x < WIDTH; x++) {
+		for(y = 0; y < HEIGHT; y++) {
+			if(objects[x][y]) {
+				_insert(x, y, objects[x][y]->type);
+			}
+		}
+	}
+
+	return;
+}
+
+/* o is now at (x, y), or nothing if it's NULL */
+void spatial_set(const int x, const int y, const object *o)
+{
+	if(x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) {
+		return;
+	}
+
+	_remove(x, y);
+
+	if(o) {
+		_insert(x, y, o->type);
+	}
+
+	return;
+}
+
+int spatial_count(const object_type t)
+{
+	return(t >= 0 && t < TYPES ? _spatial.total[t] : 0);
+}
+
+/*
+ * The objects of type t from (x0, y0) to (x1, y1), both included, in no
+ * particular order; take them with spatial_next() until it returns NULL.
+ * The objects may not be changed in between.
+ */
+void spatial_begin(spatial_iter *it, const object_type t,
+				   const int x0, const int y0, const int x1, const int y1)
+{
+	it->type = t;
+	it->x0 = x0 < 0 ? 0 : x0;
+	it->y0 = y0 < 0 ? 0 : y0;
+	it->x1 = x1 >= WIDTH ? WIDTH - 1 : x1;
+	it->y1 = y1 >= HEIGHT ? HEIGHT - 1 : y1;
+	it->bx = it->x0 / SPATIAL_BUCKET;
+	it->by = it->y0 / SPATIAL_BUCKET;
+	it->cell = 0;
+
+	if(t < 0 || t >= TYPES || it->x0 > it->x1 || it->y0 > it->y1 ||
+	   !_spatial.total[t]) {
+		/* nothing to visit */
+		it->bx = SPATIAL_BUCKETS_X;
+	} else {
+		it->cell = _spatial.head[t][it->bx * SPATIAL_BUCKETS_Y + it->by];
+	}
+
+	return;
+}
+
+object* spatial_next(spatial_iter *it)
+{
+	extern object *objects[WIDTH][HEIGHT];
+
+	while(it->bx <= it->x1 / SPATIAL_BUCKET) {
+		while(it->cell) {
+			int x, y;
+
+			x = (it->cell - 1) / HEIGHT;
+			y = (it->cell - 1) % HEIGHT;
+			it->cell = _spatial.next[it->cell - 1];
+
+			if(x >= it->x0 && x <= it->x1 && y >= it->y0 && y <= it->y1) {
+				return(objects[x][y]);
+			}
+		}
+
+		if(++it->by > it->y1 / SPATIAL_BUCKET) {
+			it->by = it->y0 / SPATIAL_BUCKET;
+			it->bx++;
+		}
+
+		if(it->bx <= it->x1 / SPATIAL_BUCKET) {
+			it->cell = _spatial.head[it->type][it->bx * SPATIAL_BUCKETS_Y + it->by];
+		}
+	}
+
+	return(NULL);
+}
+
+struct nearest {
+	object_type type;
+	int x;
+	int y;
+	int best;       /* cell plus one, 0 if none yet */
+	int dist;
+	int seen;       /* objects of the type looked at */
+};
+
+static void _nearest_bucket(struct nearest *n, const int bx, const int by)
+{
+	int c;
+
+	if(bx < 0 || by < 0 || bx >= SPATIAL_BUCKETS_X || by >= SPATIAL_BUCKETS_Y) {
+		return;
+	}
+
+	for(c = _spatial.head[n->type][bx * SPATIAL_BUCKETS_Y + by]; c; c = _spatial.next[c - 1]) {
+		int x, y, d;
+
+		x = (c - 1) / HEIGHT;
+		y = (c - 1) % HEIGHT;
+		d = (x < n->x ? n->x - x : x - n->x) + (y < n->y ? n->y - y : y - n->y);
+		n->seen++;
+
+		/* the same one on ties, whatever order the list is in */
+		if(d > 0 && (!n->best || d < n->dist || (d == n->dist && c < n->best))) {
+			n->best = c;
+			n->dist = d;
+		}
+	}
+
+	return;
+}
+
+/*
+ * The object of type t with the fewest steps to (x, y), not counting
+ * walls, other than the one at (x, y). The buckets are visited in rings
+ * around the one of (x, y), until every object of the type was seen or
+ * the next ring is farther away than the closest one so far.
+ */
+object* spatial_nearest(const object_type t, const int x, const int y)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	struct nearest n;
+	int bx, by, r;
+
+	if(t < 0 || t >= TYPES || !_spatial.total[t]) {
+		return(NULL);
+	}
+
+	n.type = t;
+	n.x = x;
+	n.y = y;
+	n.best = 0;
+	n.dist = 0;
+	n.seen = 0;
+
+	bx = x / SPATIAL_BUCKET;
+	by = y / SPATIAL_BUCKET;
+
+	for(r = 0; n.seen < _spatial.total[t] &&
+			(r < SPATIAL_BUCKETS_X || r < SPATIAL_BUCKETS_Y); r++) {
+		int i;
+
+		if(!r) {
+			_nearest_bucket(&n, bx, by);
+		} else {
+			for(i = bx - r; i <= bx + r; i++) {
+				_nearest_bucket(&n, i, by - r);
+				_nearest_bucket(&n, i, by + r);
+			}
+
+			for(i = by - r + 1; i < by + r; i++) {
+				_nearest_bucket(&n, bx - r, i);
+				_nearest_bucket(&n, bx + r, i);
+			}
+		}
+
+		/* cells in the next ring are more than r buckets away */
+		if(n.best && n.dist <= r * SPATIAL_BUCKET) {
+			break;
+		}
+	}
+
+	return(n.best ? objects[(n.best - 1) / HEIGHT][(n.best - 1) % HEIGHT] : NULL);
+}
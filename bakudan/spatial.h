@@ -0,0 +1,41 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include "game.h"
+
+/*
+ * Objects on the field by type and area
+ *
+ * The field is cut into square buckets of SPATIAL_BUCKET cells, and every
+ * bucket keeps a list of the cells in it for each type of object. The
+ * lists are kept up to date by _set_object() through spatial_set(), so
+ * looking for objects of a type only visits buckets and the objects of
+ * that type in them, never the cells in between: a field with a handful
+ * of bombs costs a handful of steps to search, however large it is.
+ */
+
+#define SPATIAL_BUCKET 8
+
+#define SPATIAL_BUCKETS_X ((WIDTH + SPATIAL_BUCKET - 1) / SPATIAL_BUCKET)
+#define SPATIAL_BUCKETS_Y ((HEIGHT + SPATIAL_BUCKET - 1) / SPATIAL_BUCKET)
+
+/* the objects of a type in a rectangle, see spatial_begin() */
+typedef struct {
+	object_type type;
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+	int bx;          /* the bucket being visited */
+	int by;
+	int cell;        /* the next cell in it, -1 at the end of its list */
+} spatial_iter;
+
+void spatial_reset(void);
+void spatial_set(const int, const int, const object*);
+int spatial_count(const object_type);
+void spatial_begin(spatial_iter*, const object_type, const int, const int, const int, const int);
+object* spatial_next(spatial_iter*);
+object* spatial_nearest(const object_type, const int, const int);
+
+#endif /* SPATIAL_H */
@@ -0,0 +1,297 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "term.h"
+
+#define FRAME_SIZE  32768
+#define STATS_COL   (WIDTH * 2 + 4)
+#define STATS_LINES (2 * (MAX_PLAYERS + 2) + 2)
+#define LINE_SIZE   128
+
+/* what is shown in a cell, so that unchanged cells can be skipped */
+enum {
+	KEY_EMPTY = 0,
+	KEY_WALL,
+	KEY_PILLAR,
+	KEY_BOULDER,
+	KEY_ITEM = 100,
+	KEY_BOMB = 200,
+	KEY_PLAYER = 1000
+};
+
+static const char *_player_fg[MAX_PLAYERS] = {
+	"\033[1;31m", "\033[1;32m", "\033[1;34m", "\033[1;33m"
+};
+
+static const char *_player_bg[MAX_PLAYERS] = {
+	"\033[1;97;41m", "\033[1;97;42m", "\033[1;97;44m", "\033[1;30;43m"
+};
+
+static const char *_item_glyphs[ITEM_TYPE_NUM] = {
+	"Bg", "Lf", "Lk", "Po", "Pw", "Tm"
+};
+
+static char _frame[FRAME_SIZE];
+static int _len;
+static int _prev[WIDTH * HEIGHT];
+static char _prev_stats[STATS_LINES][LINE_SIZE];
+static int _prev_color[STATS_LINES];
+static int _active;
+
+static void _emit(const char *fmt, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, fmt);
+	n = vsnprintf(_frame + _len, sizeof(_frame) - _len, fmt, args);
+	va_end(args);
+
+	if(n > 0) {
+		_len += n;
+
+		if(_len >= (int)sizeof(_frame)) {
+			_len = sizeof(_frame) - 1;
+		}
+	}
+
+	return;
+}
+
+static void _flush(void)
+{
+	int off;
+
+	for(off = 0; off < _len; ) {
+		ssize_t n;
+
+		n = write(STDOUT_FILENO, _frame + off, _len - off);
+
+		if(n < 0 && errno != EINTR) {
+			break;
+		}
+
+		off += n > 0 ? n : 0;
+	}
+
+	_len = 0;
+
+	return;
+}
+
+static int _cell_key(const live_state *s, const int x, const int y)
+{
+	const live_cell *c;
+	int i;
+
+	for(i = 0; i < s->nplayers && i < MAX_PLAYERS; i++) {
+		if(s->player[i].alive && s->player[i].x == x && s->player[i].y == y) {
+			return(KEY_PLAYER + i);
+		}
+	}
+
+	c = &(s->board[LIVE_CELL(x, y)]);
+
+	switch(c->type) {
+	case OBJECT_TYPE_WALL:
+		return(KEY_WALL);
+
+	case OBJECT_TYPE_PILLAR:
+		return(KEY_PILLAR);
+
+	case OBJECT_TYPE_BOULDER:
+		return(KEY_BOULDER);
+
+	case OBJECT_TYPE_ITEM:
+		return(KEY_ITEM + c->item);
+
+	case OBJECT_TYPE_BOMB: {
+		int secs;
+
+		/* seconds left on the fuse */
+		secs = (c->timeout + FPS - 1) / FPS;
+		secs = secs < 0 ? 0 : secs > 9 ? 9 : secs;
+
+		return(KEY_BOMB + c->owner * 10 + secs);
+	}
+
+	default:
+		return(KEY_EMPTY);
+	}
+}
+
+static void _draw_cell(const int x, const int y, const int key)
+{
+	/* two columns per cell, so that the board comes out square */
+	_emit("\033[%d;%dH", y + 1, x * 2 + 1);
+
+	if(key >= KEY_PLAYER) {
+		_emit("%sP%d", _player_bg[key - KEY_PLAYER], key - KEY_PLAYER + 1);
+	} else if(key >= KEY_BOMB) {
+		_emit("%so%d", _player_fg[((key - KEY_BOMB) / 10) % MAX_PLAYERS],
+			  (key - KEY_BOMB) % 10);
+	} else if(key >= KEY_ITEM) {
+		_emit("\033[36m%s", key - KEY_ITEM < ITEM_TYPE_NUM ?
+			  _item_glyphs[key - KEY_ITEM] : "??");
+	} else if(key == KEY_WALL) {
+		_emit("\033[100m  ");
+	} else if(key == KEY_PILLAR) {
+		_emit("\033[47m  ");
+	} else if(key == KEY_BOULDER) {
+		_emit("\033[33m▒▒");
+	} else {
+		_emit("  ");
+	}
+
+	_emit("\033[0m");
+
+	return;
+}
+
+/* color is a player number or -1 */
+static void _stats_line(const int line, const int color, const char *fmt, ...)
+{
+	char text[LINE_SIZE];
+	va_list args;
+
+	va_start(args, fmt);
+	vsnprintf(text, sizeof(text), fmt, args);
+	va_end(args);
+
+	if(color == _prev_color[line] && !strcmp(text, _prev_stats[line])) {
+		return;
+	}
+
+	_emit("\033[%d;%dH%s%s\033[0m\033[K", line + 1, STATS_COL,
+		  color >= 0 ? _player_fg[color] : "", text);
+
+	strcpy(_prev_stats[line], text);
+	_prev_color[line] = color;
+
+	return;
+}
+
+/* the same tables as gfx_draw_stats() */
+static void _draw_stats(const live_state *s)
+{
+	int line;
+	int i;
+
+	line = 0;
+
+	_stats_line(line++, -1, "   殺   死   自   岩   物");
+
+	for(i = 0; i < MAX_PLAYERS; i++) {
+		const live_player *p;
+
+		p = &(s->player[i]);
+
+		if(i >= s->nplayers) {
+			_stats_line(line++, -1, "");
+			continue;
+		}
+
+		_stats_line(line++, i, " %4d %4d %4d %4d %4d",
+					p->frags, p->deaths, p->suicides, p->boulders, p->items);
+	}
+
+	_stats_line(line++, -1, "");
+	_stats_line(line++, -1, "   HP   弾   運   力   時   命");
+
+	for(i = 0; i < MAX_PLAYERS; i++) {
+		const live_player *p;
+
+		p = &(s->player[i]);
+
+		if(i >= s->nplayers) {
+			_stats_line(line++, -1, "");
+			continue;
+		}
+
+		_stats_line(line++, i, p->health < 0 ? "%+4d %4d %4d %4d %4d %4d" :
+					" %4d %4d %4d %4d %4d %4d",
+					p->health, p->bombs, p->probability,
+					p->bomb_strength, p->bomb_timeout, p->lifes);
+	}
+
+	_stats_line(line++, -1, "");
+
+	if(!s->over) {
+		_stats_line(line++, -1, "tick %llu", (unsigned long long)s->tick);
+	} else if(s->winner < 0) {
+		_stats_line(line++, -1, "tick %llu, draw", (unsigned long long)s->tick);
+	} else {
+		_stats_line(line++, s->winner % MAX_PLAYERS, "tick %llu, P%d won",
+					(unsigned long long)s->tick, s->winner + 1);
+	}
+
+	return;
+}
+
+int term_init(void)
+{
+	int i;
+
+	for(i = 0; i < WIDTH * HEIGHT; i++) {
+		_prev[i] = -1;
+	}
+
+	for(i = 0; i < STATS_LINES; i++) {
+		_prev_stats[i][0] = 0;
+		_prev_color[i] = -2;
+	}
+
+	/* hide the cursor and start with a blank screen */
+	_len = 0;
+	_emit("\033[?25l\033[2J");
+	_flush();
+	_active = 1;
+
+	return(0);
+}
+
+void term_draw(const live_state *s)
+{
+	int x, y;
+
+	if(!_active) {
+		return;
+	}
+
+	for(x = 0; x < WIDTH; x++) {
+		for(y = 0; y < HEIGHT; y++) {
+			int key;
+
+			key = _cell_key(s, x, y);
+
+			if(key != _prev[LIVE_CELL(x, y)]) {
+				_draw_cell(x, y, key);
+				_prev[LIVE_CELL(x, y)] = key;
+			}
+		}
+	}
+
+	_draw_stats(s);
+
+	if(_len > 0) {
+		_flush();
+	}
+
+	return;
+}
+
+void term_quit(void)
+{
+	if(!_active) {
+		return;
+	}
+
+	/* leave the cursor below the board */
+	_emit("\033[0m\033[%d;1H\033[?25h", HEIGHT + 1);
+	_flush();
+	_active = 0;
+
+	return;
+}
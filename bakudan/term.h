@@ -0,0 +1,19 @@
+#ifndef TERM_H
+#define TERM_H
+
+#include "live.h"
+
+/*
+ * Terminal renderer
+ *
+ * Draws a match snapshot (see live.h) with ANSI escape sequences, for
+ * hosts without a display. Only cells and stats lines that changed since
+ * the previous frame are sent, and every frame goes out with a single
+ * write, so watching a match costs next to nothing.
+ */
+
+int term_init(void);
+void term_draw(const live_state*);
+void term_quit(void);
+
+#endif /* TERM_H */
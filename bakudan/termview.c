@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include "game.h"
+#include "live.h"
+#include "term.h"
+#include "trace.h"
+#include "tool.h"
+
+/*
+ * Watches a match in the terminal: either one that is published through
+ * shared memory (see live.h), or one that is played right here.
+ */
+
+static volatile sig_atomic_t _stop;
+
+static void _on_signal(int sig)
+{
+	(void)sig;
+	_stop = 1;
+
+	return;
+}
+
+static void _sleep_until(const double t)
+{
+	double d;
+
+	d = t - tool_now();
+
+	if(d > 0) {
+		usleep((useconds_t)(d * 1e6));
+	}
+
+	return;
+}
+
+static int _watch(const char *name, const double rate)
+{
+	const live_state *live;
+	live_state snap;
+
+	live = live_attach(name);
+
+	if(!live) {
+		fprintf(stderr, "%s: %s\n", name, strerror(errno));
+		return(1);
+	}
+
+	term_init();
+
+	while(!_stop) {
+		if(live_read(live, &snap) == 0) {
+			term_draw(&snap);
+		}
+
+		_sleep_until(tool_now() + 1.0 / rate);
+	}
+
+	term_quit();
+	live_detach(live);
+
+	return(0);
+}
+
+/* the simulation runs at `speed' ticks per second, the screen at `rate' */
+static int _play(const unsigned seed, const int players, const double speed,
+				 const double rate)
+{
+	live_state snap;
+	double next_tick, next_frame;
+	int err;
+
+	memset(&snap, 0, sizeof(snap));
+	game_seed(seed);
+	err = game_init(0, players);
+
+	if(err < 0) {
+		fprintf(stderr, "game_init: %s\n", strerror(-err));
+		return(1);
+	}
+
+	term_init();
+	next_tick = next_frame = tool_now();
+
+	while(!_stop && !game_is_over()) {
+		TRACE_SCOPE("tick");
+
+		game_logic();
+		game_animate();
+
+		if(tool_now() >= next_frame) {
+			TRACE_SCOPE("draw");
+
+			live_snapshot(&snap);
+			term_draw(&snap);
+			next_frame += 1.0 / rate;
+		}
+
+		if(speed > 0) {
+			next_tick += 1.0 / speed;
+			_sleep_until(next_tick);
+		}
+	}
+
+	live_snapshot(&snap);
+	term_draw(&snap);
+	term_quit();
+
+	game_cleanup();
+
+	return(0);
+}
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [options]\n"
+		   "\n"
+		   "  -n name  watch the match published under this name (default: $%s or %s)\n"
+		   "  -p       play a match here instead\n"
+		   "  -s num   seed of that match (default: time)\n"
+		   "  -P num   number of CPU players in that match (default: 2)\n"
+		   "  -S num   ticks per second of that match, 0 for full speed (default: %d)\n"
+		   "  -r num   screen updates per second (default: 10)\n",
+		   argv0, LIVE_ENV, LIVE_DEFAULT_NAME, FPS);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *name;
+	unsigned seed;
+	double speed, rate;
+	int play, players;
+	int ret_val;
+	int opt;
+
+	name = getenv(LIVE_ENV);
+	seed = (unsigned)time(NULL);
+	speed = FPS;
+	rate = 10;
+	play = 0;
+	players = 2;
+
+	if(!name || !*name) {
+		name = LIVE_DEFAULT_NAME;
+	}
+
+	while((opt = getopt(argc, argv, "n:ps:P:S:r:h")) != -1) {
+		switch(opt) {
+		case 'n':
+			name = optarg;
+			break;
+
+		case 'p':
+			play = 1;
+			break;
+
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+
+		case 'P':
+			players = atoi(optarg);
+			break;
+
+		case 'S':
+			speed = atof(optarg);
+			break;
+
+		case 'r':
+			rate = atof(optarg);
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if(rate <= 0 || players < 2 || players > MAX_PLAYERS) {
+		_usage(argv[0]);
+		return(1);
+	}
+
+	signal(SIGINT, _on_signal);
+	signal(SIGTERM, _on_signal);
+
+	/* same as in the game: BAKUDAN_TRACE=file records trace spans */
+	if(getenv("BAKUDAN_TRACE") && trace_start(getenv("BAKUDAN_TRACE")) < 0) {
+		fprintf(stderr, "Could not start tracing\n");
+	}
+
+	if(play) {
+		ret_val = _play(seed, players, speed, rate);
+	} else {
+		ret_val = _watch(name, rate);
+	}
+
+	if(trace_stop() < 0) {
+		fprintf(stderr, "Could not write the trace\n");
+	}
+
+	return(ret_val);
+}
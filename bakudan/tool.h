@@ -0,0 +1,76 @@
+#ifndef TOOL_H
+#define TOOL_H
+
+#include <stdint.h>
+#include <time.h>
+#include "game.h"
+#include "rng.h"
+
+/*
+ * What the tools have in common: a clock, which the AI's time budget uses
+ * as well, and a field for the benchmarks that are built without the
+ * engine, with a WIDTH and HEIGHT of their own (see Makefile).
+ */
+
+/* seconds on the monotonic clock */
+static inline double tool_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+}
+
+/*
+ * An object of a kind, passable where it is in the game. There is only
+ * one of every kind, put on every cell that has one, so it doesn't know
+ * where it is.
+ */
+static inline object* tool_object(const object_type type)
+{
+	static object o[OBJECT_TYPE_PLAYER + 1];
+
+	o[type].type = type;
+	o[type].passable = type == OBJECT_TYPE_ITEM || type == OBJECT_TYPE_BOMB;
+
+	return(&(o[type]));
+}
+
+/* the walls and pillars of game.h, and boulders on boulders% of the rest */
+static inline void tool_field(uint32_t *rng, const int boulders)
+{
+	extern object *objects[WIDTH][HEIGHT];
+	int x, y;
+
+	for(x = 0; x < WIDTH; x++) {
+		for(y = 0; y < HEIGHT; y++) {
+			if(IS_WALL(x, y)) {
+				objects[x][y] = tool_object(OBJECT_TYPE_WALL);
+			} else if(IS_PILLAR(x, y)) {
+				objects[x][y] = tool_object(OBJECT_TYPE_PILLAR);
+			} else if(rng_chance(rng, boulders)) {
+				objects[x][y] = tool_object(OBJECT_TYPE_BOULDER);
+			} else {
+				objects[x][y] = NULL;
+			}
+		}
+	}
+
+	return;
+}
+
+/* a random cell with nothing on it */
+static inline void tool_random_free(uint32_t *rng, int *x, int *y)
+{
+	extern object *objects[WIDTH][HEIGHT];
+
+	do {
+		*x = rng_range(rng, 1, WIDTH - 2);
+		*y = rng_range(rng, 1, HEIGHT - 2);
+	} while(objects[*x][*y]);
+
+	return;
+}
+
+#endif /* TOOL_H */
@@ -0,0 +1,560 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include "sim.h"
+#include "pool.h"
+#include "tool.h"
+
+/*
+ * Tournaments between AI configurations
+ *
+ * Every pairing is played as pairs of games on the same seed with the
+ * seats swapped, so that neither side profits from a lucky spawn. The
+ * games of a round are spread over all cores. A game that hits the tick
+ * limit goes to whoever is ahead there (see sim.h), and only counts as a
+ * draw if they are even. Ratings are maximum likelihood Elo
+ * (Bradley-Terry) with a 95% confidence interval.
+ */
+
+#define MAX_CONFIGS     64
+#define DEFAULT_GAMES   10
+#define ELO_ITERATIONS  1000
+
+typedef enum {
+	FORMAT_ROUND_ROBIN,
+	FORMAT_SWISS
+} format;
+
+struct entry {
+	char name[32];
+	ai_config cfg;
+
+	int games;
+	int wins;
+	int draws;
+	int losses;
+	long frags;
+	long deaths;
+	long suicides;
+	long boulders;
+	long items;
+	long ticks;
+
+	double elo;
+	double ci;
+};
+
+struct game {
+	int a;
+	int b;
+	int swap;
+	unsigned seed;
+};
+
+static struct entry _entries[MAX_CONFIGS];
+static int _nentries;
+static int _played[MAX_CONFIGS][MAX_CONFIGS];
+static int _max_ticks = SIM_DEFAULT_TICKS;
+static const char *_records;
+
+static void _play(const int i, void *arg, void *result)
+{
+	struct game *g;
+	sim_config cfg;
+
+	g = (struct game*)arg + i;
+
+	sim_config_default(&cfg);
+	cfg.seed = g->seed;
+	cfg.players = 2;
+	cfg.max_ticks = _max_ticks;
+	cfg.ai[g->swap] = _entries[g->a].cfg;
+	cfg.ai[!g->swap] = _entries[g->b].cfg;
+
+	if(sim_run(&cfg, (sim_result*)result) < 0) {
+		memset(result, 0, sizeof(sim_result));
+		((sim_result*)result)->winner = -1;
+		((sim_result*)result)->leader = -1;
+	}
+
+	return;
+}
+
+static void _account(struct entry *e, const sim_player *p, const int ticks,
+					 const int won, const int lost)
+{
+	e->games++;
+	e->wins += won;
+	e->losses += lost;
+	e->draws += !won && !lost;
+	e->frags += p->frags;
+	e->deaths += p->deaths;
+	e->suicides += p->suicides;
+	e->boulders += p->boulders;
+	e->items += p->items;
+	e->ticks += ticks;
+
+	return;
+}
+
+/* play all games of one round; returns the number of ticks simulated */
+static long _play_round(struct game *games, const int n, const int workers)
+{
+	sim_result *res;
+	long ret_val;
+	int i, err;
+
+	res = malloc(sizeof(*res) * n);
+
+	if(!res) {
+		fprintf(stderr, "malloc: %s\n", strerror(ENOMEM));
+		exit(1);
+	}
+
+	err = pool_run(n, workers, _play, games, res, sizeof(*res));
+
+	if(err < 0) {
+		fprintf(stderr, "pool_run: %s\n", strerror(-err));
+		exit(1);
+	}
+
+	for(ret_val = 0, i = 0; i < n; i++) {
+		struct game *g;
+		int sa, sb;
+
+		g = &(games[i]);
+		sa = g->swap;
+		sb = !g->swap;
+
+		_account(&(_entries[g->a]), &(res[i].player[sa]), res[i].ticks,
+				 res[i].leader == sa, res[i].leader == sb);
+		_account(&(_entries[g->b]), &(res[i].player[sb]), res[i].ticks,
+				 res[i].leader == sb, res[i].leader == sa);
+
+		_played[g->a][g->b]++;
+		_played[g->b][g->a]++;
+
+		ret_val += res[i].ticks;
+	}
+
+	if(_records) {
+		match_record *recs;
+
+		recs = malloc(sizeof(*recs) * n);
+
+		if(recs) {
+			for(i = 0; i < n; i++) {
+				recs[i] = res[i].record;
+			}
+
+			err = record_append(_records, recs, n);
+			free(recs);
+		} else {
+			err = -ENOMEM;
+		}
+
+		if(err < 0) {
+			fprintf(stderr, "%s: %s\n", _records, strerror(-err));
+			exit(1);
+		}
+	}
+
+	free(res);
+
+	return(ret_val);
+}
+
+/* add `per_pair' games between a and b, in mirrored pairs */
+static int _schedule(struct game *games, int n, const int a, const int b,
+					 const int per_pair, unsigned *seed)
+{
+	int i;
+
+	for(i = 0; i < per_pair; i++) {
+		games[n].a = a;
+		games[n].b = b;
+		games[n].swap = i & 1;
+		games[n].seed = *seed;
+		n++;
+
+		if(i & 1) {
+			(*seed)++;
+		}
+	}
+
+	if(per_pair & 1) {
+		(*seed)++;
+	}
+
+	return(n);
+}
+
+static double _score(const struct entry *e)
+{
+	return(e->wins + 0.5 * e->draws);
+}
+
+static int _by_score(const void *a, const void *b)
+{
+	double sa, sb;
+
+	sa = _score(&(_entries[*(const int*)a]));
+	sb = _score(&(_entries[*(const int*)b]));
+
+	return(sa < sb ? 1 : sa > sb ? -1 : *(const int*)a - *(const int*)b);
+}
+
+/* pair players with similar scores that haven't met yet */
+static int _swiss_pairings(int (*pairs)[2])
+{
+	int order[MAX_CONFIGS];
+	int paired[MAX_CONFIGS];
+	int i, j, n;
+
+	for(i = 0; i < _nentries; i++) {
+		order[i] = i;
+		paired[i] = 0;
+	}
+
+	qsort(order, _nentries, sizeof(order[0]), _by_score);
+
+	for(n = 0, i = 0; i < _nentries; i++) {
+		int best;
+
+		if(paired[order[i]]) {
+			continue;
+		}
+
+		best = -1;
+
+		for(j = i + 1; j < _nentries; j++) {
+			if(paired[order[j]]) {
+				continue;
+			}
+
+			if(best < 0 || (_played[order[i]][order[j]] == 0 &&
+							_played[order[i]][order[best]] > 0)) {
+				best = j;
+			}
+
+			if(_played[order[i]][order[j]] == 0) {
+				break;
+			}
+		}
+
+		if(best < 0) {
+			/* odd number of players, this one gets a bye */
+			continue;
+		}
+
+		paired[order[i]] = 1;
+		paired[order[best]] = 1;
+		pairs[n][0] = order[i];
+		pairs[n][1] = order[best];
+		n++;
+	}
+
+	return(n);
+}
+
+/*
+ * Maximum likelihood ratings with the minorization-maximization
+ * algorithm for the Bradley-Terry model. Draws count as half a win, and
+ * every player gets one virtual win and loss against an average player
+ * so that unbeaten or winless players still have finite ratings.
+ */
+static void _elo(void)
+{
+	double gamma[MAX_CONFIGS];
+	double next[MAX_CONFIGS];
+	double k, mean;
+	int it, i, j;
+
+	for(i = 0; i < _nentries; i++) {
+		gamma[i] = 1.0;
+	}
+
+	for(it = 0; it < ELO_ITERATIONS; it++) {
+		double lg;
+
+		for(i = 0; i < _nentries; i++) {
+			double den;
+
+			den = 2.0 / (gamma[i] + 1.0);
+
+			for(j = 0; j < _nentries; j++) {
+				if(j != i && _played[i][j]) {
+					den += _played[i][j] / (gamma[i] + gamma[j]);
+				}
+			}
+
+			next[i] = (_score(&(_entries[i])) + 1.0) / den;
+		}
+
+		/* keep the geometric mean at 1 */
+		for(lg = 0, i = 0; i < _nentries; i++) {
+			lg += log(next[i]);
+		}
+
+		lg = exp(lg / _nentries);
+
+		for(i = 0; i < _nentries; i++) {
+			gamma[i] = next[i] / lg;
+		}
+	}
+
+	k = log(10.0) / 400.0;
+
+	for(mean = 0, i = 0; i < _nentries; i++) {
+		double info;
+
+		_entries[i].elo = log10(gamma[i]) * 400.0;
+		mean += _entries[i].elo;
+
+		/* Fisher information of the rating, for the standard error */
+		for(info = 0, j = 0; j < _nentries; j++) {
+			double p;
+
+			if(j == i || !_played[i][j]) {
+				continue;
+			}
+
+			p = gamma[i] / (gamma[i] + gamma[j]);
+			info += _played[i][j] * p * (1.0 - p) * k * k;
+		}
+
+		_entries[i].ci = info > 0 ? 1.96 / sqrt(info) : INFINITY;
+	}
+
+	mean /= _nentries;
+
+	for(i = 0; i < _nentries; i++) {
+		_entries[i].elo -= mean;
+	}
+
+	return;
+}
+
+static int _by_elo(const void *a, const void *b)
+{
+	double ea, eb;
+
+	ea = _entries[*(const int*)a].elo;
+	eb = _entries[*(const int*)b].elo;
+
+	return(ea < eb ? 1 : ea > eb ? -1 : 0);
+}
+
+static void _report(void)
+{
+	int order[MAX_CONFIGS];
+	int i;
+
+	for(i = 0; i < _nentries; i++) {
+		order[i] = i;
+	}
+
+	qsort(order, _nentries, sizeof(order[0]), _by_elo);
+
+	printf("%-3s %-20s %6s %6s %5s %5s %5s %6s %6s %6s %6s %7s\n",
+		   "#", "config", "elo", "+/-", "win", "draw", "loss", "score",
+		   "frags", "sui", "blds", "ticks");
+
+	for(i = 0; i < _nentries; i++) {
+		struct entry *e;
+		double g;
+
+		e = &(_entries[order[i]]);
+		g = e->games > 0 ? e->games : 1;
+
+		printf("%-3d %-20s %+6.0f %6.0f %5d %5d %5d %5.1f%% %6.2f %6.2f %6.2f %7.0f\n",
+			   i + 1, e->name, e->elo, e->ci, e->wins, e->draws, e->losses,
+			   100.0 * _score(e) / g, e->frags / g, e->suicides / g,
+			   e->boulders / g, e->ticks / g);
+	}
+
+	return;
+}
+
+static int _add_entry(const char *arg)
+{
+	struct entry *e;
+	const char *spec;
+	const char *colon;
+
+	if(_nentries >= MAX_CONFIGS) {
+		return(-ENOSPC);
+	}
+
+	e = &(_entries[_nentries]);
+	memset(e, 0, sizeof(*e));
+	ai_config_default(&(e->cfg));
+
+	/* "name:spec" or just "spec", which is then also the name */
+	colon = strchr(arg, ':');
+	spec = colon ? colon + 1 : arg;
+
+	snprintf(e->name, sizeof(e->name), "%.*s",
+			 colon ? (int)(colon - arg) : (int)strlen(arg), arg);
+
+	/* "@file" loads a config file, e.g. one written by the tuner */
+	if(spec[0] == '@' ? ai_config_load(&(e->cfg), spec + 1) < 0 :
+	   ai_config_parse(&(e->cfg), spec) < 0) {
+		return(-EINVAL);
+	}
+
+	_nentries++;
+
+	return(0);
+}
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [options] config config...\n"
+		   "\n"
+		   "Each config is an AI configuration like \"tolerance=0.3,radius=8\"\n"
+		   "or \"hunter\", optionally prefixed with a name (\"name:config\").\n"
+		   "\"@file\" loads the config from a file, as written by tune.\n"
+		   "\n"
+		   "  -S      swiss system instead of round robin\n"
+		   "  -r num  rounds (default: 1 for round robin, log2(configs) + 2 for swiss)\n"
+		   "  -g num  games per pairing and round (default: %d)\n"
+		   "  -j num  worker processes (default: all cores)\n"
+		   "  -s num  seed of the first game (default: 1)\n"
+		   "  -t num  tick limit per game, after which the leader wins (default: %d)\n"
+		   "  -o file append a record of every match to this file\n",
+		   argv0, DEFAULT_GAMES, SIM_DEFAULT_TICKS);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	struct game *games;
+	format fmt;
+	unsigned seed;
+	double start, elapsed;
+	long ticks;
+	int rounds, per_pair, workers;
+	int ngames;
+	int opt;
+	int r, i, j;
+
+	fmt = FORMAT_ROUND_ROBIN;
+	rounds = 0;
+	per_pair = DEFAULT_GAMES;
+	workers = 0;
+	seed = 1;
+
+	while((opt = getopt(argc, argv, "Sr:g:j:s:t:o:h")) != -1) {
+		switch(opt) {
+		case 'S':
+			fmt = FORMAT_SWISS;
+			break;
+
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+
+		case 'g':
+			per_pair = atoi(optarg);
+			break;
+
+		case 'j':
+			workers = atoi(optarg);
+			break;
+
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+
+		case 't':
+			_max_ticks = atoi(optarg);
+			break;
+
+		case 'o':
+			_records = optarg;
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	for(i = optind; i < argc; i++) {
+		if(_add_entry(argv[i]) < 0) {
+			fprintf(stderr, "Invalid configuration: %s\n", argv[i]);
+			return(1);
+		}
+	}
+
+	if(_nentries < 2 || per_pair < 1 || _max_ticks < 1) {
+		_usage(argv[0]);
+		return(1);
+	}
+
+	if(rounds <= 0) {
+		rounds = 1;
+
+		if(fmt == FORMAT_SWISS) {
+			for(i = 1; i < _nentries; i <<= 1) {
+				rounds++;
+			}
+
+			rounds++;
+		}
+	}
+
+	games = malloc(sizeof(*games) * per_pair * _nentries * _nentries);
+
+	if(!games) {
+		fprintf(stderr, "malloc: %s\n", strerror(ENOMEM));
+		return(1);
+	}
+
+	ticks = 0;
+	ngames = 0;
+	start = tool_now();
+
+	for(r = 0; r < rounds; r++) {
+		int n;
+
+		n = 0;
+
+		if(fmt == FORMAT_ROUND_ROBIN) {
+			for(i = 0; i < _nentries; i++) {
+				for(j = i + 1; j < _nentries; j++) {
+					n = _schedule(games, n, i, j, per_pair, &seed);
+				}
+			}
+		} else {
+			int pairs[MAX_CONFIGS][2];
+			int np;
+
+			np = _swiss_pairings(pairs);
+
+			for(i = 0; i < np; i++) {
+				n = _schedule(games, n, pairs[i][0], pairs[i][1], per_pair, &seed);
+			}
+		}
+
+		ticks += _play_round(games, n, workers);
+		ngames += n;
+	}
+
+	elapsed = tool_now() - start;
+	free(games);
+
+	_elo();
+	_report();
+
+	printf("\n%d games, %ld ticks in %.2fs on %d workers: %.1f games/s, %.0f ticks/s\n",
+		   ngames, ticks, elapsed, workers > 0 ? workers : pool_workers(),
+		   ngames / elapsed, ticks / elapsed);
+
+	return(0);
+}
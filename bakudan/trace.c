@@ -0,0 +1,203 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "trace.h"
+
+#ifdef TRACE
+
+#define MAX_THREADS   64
+#define BUFFER_EVENTS (1 << 20)
+
+struct event {
+	const char *name;
+	uint64_t start;
+	uint64_t duration;
+};
+
+/* one per thread; only its own thread writes to it */
+struct buffer {
+	int tid;
+	uint32_t n;
+	unsigned long dropped;
+	struct event events[BUFFER_EVENTS];
+};
+
+int trace_enabled;
+
+static struct buffer *_buffers[MAX_THREADS];
+static int _nbuffers;
+static __thread struct buffer *_mine;
+static __thread int _no_buffer;
+static uint64_t _epoch;
+static char *_path;
+
+uint64_t trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec);
+}
+
+static struct buffer* _register(void)
+{
+	struct buffer *b;
+	int i;
+
+	b = malloc(sizeof(*b));
+
+	if(!b) {
+		_no_buffer = 1;
+		return(NULL);
+	}
+
+	i = __atomic_fetch_add(&_nbuffers, 1, __ATOMIC_RELAXED);
+
+	if(i >= MAX_THREADS) {
+		free(b);
+		_no_buffer = 1;
+		return(NULL);
+	}
+
+	b->tid = i + 1;
+	b->n = 0;
+	b->dropped = 0;
+	__atomic_store_n(&(_buffers[i]), b, __ATOMIC_RELEASE);
+
+	return(b);
+}
+
+void trace_end(trace_span *s)
+{
+	struct buffer *b;
+	struct event *e;
+	uint64_t now;
+
+	if(!s->start) {
+		return;
+	}
+
+	now = trace_now();
+
+	if(!(b = _mine)) {
+		if(_no_buffer || !(b = _mine = _register())) {
+			return;
+		}
+	}
+
+	if(b->n >= BUFFER_EVENTS) {
+		b->dropped++;
+		return;
+	}
+
+	e = &(b->events[b->n]);
+	e->name = s->name;
+	e->start = s->start;
+	e->duration = now - s->start;
+	__atomic_store_n(&(b->n), b->n + 1, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/* start recording; the trace is written to path by trace_stop() */
+int trace_start(const char *path)
+{
+	int i, n;
+
+	free(_path);
+	_path = strdup(path);
+
+	if(!_path) {
+		return(-ENOMEM);
+	}
+
+	n = __atomic_load_n(&_nbuffers, __ATOMIC_ACQUIRE);
+
+	for(i = 0; i < n && i < MAX_THREADS; i++) {
+		if(_buffers[i]) {
+			_buffers[i]->n = 0;
+			_buffers[i]->dropped = 0;
+		}
+	}
+
+	_epoch = trace_now();
+	__atomic_store_n(&trace_enabled, 1, __ATOMIC_RELEASE);
+
+	return(0);
+}
+
+int trace_stop(void)
+{
+	unsigned long dropped;
+	FILE *fd;
+	int first;
+	int i, n;
+
+	if(!__atomic_exchange_n(&trace_enabled, 0, __ATOMIC_ACQ_REL) || !_path) {
+		return(0);
+	}
+
+	fd = fopen(_path, "w");
+
+	if(!fd) {
+		return(-errno);
+	}
+
+	fprintf(fd, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	n = __atomic_load_n(&_nbuffers, __ATOMIC_ACQUIRE);
+	first = 1;
+	dropped = 0;
+
+	for(i = 0; i < n && i < MAX_THREADS; i++) {
+		struct buffer *b;
+		uint32_t j, m;
+
+		b = __atomic_load_n(&(_buffers[i]), __ATOMIC_ACQUIRE);
+
+		if(!b) {
+			continue;
+		}
+
+		m = __atomic_load_n(&(b->n), __ATOMIC_ACQUIRE);
+		dropped += b->dropped;
+
+		fprintf(fd, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"name\":\"thread %d\"}}",
+				first ? "" : ",\n", b->tid, b->tid);
+		first = 0;
+
+		for(j = 0; j < m; j++) {
+			struct event *e;
+
+			e = &(b->events[j]);
+
+			/* spans that started before trace_start() are cut off */
+			if(e->start < _epoch) {
+				continue;
+			}
+
+			fprintf(fd, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+					"\"ts\":%.3f,\"dur\":%.3f}",
+					e->name, b->tid, (e->start - _epoch) / 1000.0,
+					e->duration / 1000.0);
+		}
+	}
+
+	fprintf(fd, "\n]}\n");
+
+	if(fclose(fd) != 0) {
+		return(-errno);
+	}
+
+	if(dropped > 0) {
+		fprintf(stderr, "trace: buffers were full, %lu spans were dropped\n", dropped);
+	}
+
+	return(0);
+}
+
+#endif /* TRACE */
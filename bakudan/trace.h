@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Trace spans in Chrome's trace event format
+ *
+ * TRACE_SCOPE("name") at the top of a block records how long the block
+ * took, including every way out of it. Spans go into a buffer owned by
+ * the calling thread, so recording never takes a lock; trace_stop()
+ * writes all buffers out as JSON that Perfetto and chrome://tracing can
+ * open, and must not race with threads that are still recording.
+ *
+ * Tracing is only compiled in with -DTRACE (make TRACE=1). Without it
+ * the macros expand to nothing. With it, spans cost one predictable
+ * branch until trace_start() is called.
+ */
+
+#ifdef TRACE
+
+typedef struct {
+	const char *name;
+	uint64_t start;  /* 0 if tracing was off when the span began */
+} trace_span;
+
+extern int trace_enabled;
+
+uint64_t trace_now(void);
+void trace_end(trace_span*);
+
+static inline trace_span trace_begin(const char *name)
+{
+	trace_span s;
+
+	s.name = name;
+	s.start = __builtin_expect(trace_enabled, 0) ? trace_now() : 0;
+
+	return(s);
+}
+
+#define _TRACE_CAT2(a,b) a##b
+#define _TRACE_CAT(a,b)  _TRACE_CAT2(a,b)
+
+#define TRACE_SCOPE(name)												\
+	trace_span _TRACE_CAT(_trace_, __LINE__)							\
+	__attribute__((cleanup(trace_end), unused)) = trace_begin(name)
+
+int trace_start(const char*);
+int trace_stop(void);
+
+#else /* TRACE */
+
+#define TRACE_SCOPE(name)
+#define trace_start(path) 0
+#define trace_stop()      0
+
+#endif /* TRACE */
+
+#endif /* TRACE_H */
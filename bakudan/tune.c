@@ -0,0 +1,495 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include "sim.h"
+#include "pool.h"
+#include "rng.h"
+#include "tool.h"
+
+/*
+ * Tunes the AI parameters with a simple evolution strategy
+ *
+ * Every generation samples candidates from a normal distribution around
+ * the current configuration, lets each of them play mirrored games
+ * against the current configuration and moves the distribution towards
+ * the better half. All games of a generation (plus a few games of the
+ * current configuration against the built-in default, to show progress)
+ * are played as one batch on all cores, and all candidates of a
+ * generation see the same seeds so that they are compared on the same
+ * maps and item drops.
+ *
+ * The state is checkpointed after every generation, and the current
+ * configuration is written to a file that `bakudan' and the other tools
+ * can load.
+ */
+
+#define NUM_PARAMS      5
+#define MAX_LAMBDA      256
+#define SIGMA_SMOOTHING 0.3
+
+struct param {
+	const char *name;
+	double lo;
+	double hi;
+	double sigma;  /* initial step size */
+};
+
+static const struct param _params[NUM_PARAMS] = {
+	{ "tolerance", 0.0, 1.0,                                   0.15 },
+	{ "radius",    1.0, WIDTH > HEIGHT ? WIDTH : HEIGHT,       4.0  },
+	{ "boulder",   0.0, 8.0,                                   2.0  },
+	{ "item",      0.0, 8.0,                                   2.0  },
+	{ "player",    0.0, 8.0,                                   2.0  }
+};
+
+struct state {
+	int generation;
+	uint32_t rng;
+	unsigned seed;
+	double mean[NUM_PARAMS];
+	double sigma[NUM_PARAMS];
+};
+
+struct game {
+	ai_config cfg[2];
+	int swap;
+	unsigned seed;
+};
+
+static int _max_ticks = SIM_DEFAULT_TICKS;
+
+static double _gauss(uint32_t *s)
+{
+	double u, v;
+
+	/* Box-Muller; u is never 0 */
+	u = ((double)rng_next(s) + 1.0) / 4294967297.0;
+	v = (double)rng_next(s) / 4294967296.0;
+
+	return(sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v));
+}
+
+static double _clamp(const int i, const double v)
+{
+	return(v < _params[i].lo ? _params[i].lo : v > _params[i].hi ? _params[i].hi : v);
+}
+
+static void _to_config(const double *x, ai_config *cfg)
+{
+	ai_config_default(cfg);
+
+	cfg->tolerance = (float)_clamp(0, x[0]);
+	cfg->radius = (int)lround(_clamp(1, x[1]));
+	cfg->priority[AI_TARGET_BOULDER] = (int)lround(_clamp(2, x[2]));
+	cfg->priority[AI_TARGET_ITEM] = (int)lround(_clamp(3, x[3]));
+	cfg->priority[AI_TARGET_PLAYER] = (int)lround(_clamp(4, x[4]));
+
+	return;
+}
+
+static void _from_config(const ai_config *cfg, double *x)
+{
+	x[0] = cfg->tolerance;
+	x[1] = cfg->radius;
+	x[2] = cfg->priority[AI_TARGET_BOULDER];
+	x[3] = cfg->priority[AI_TARGET_ITEM];
+	x[4] = cfg->priority[AI_TARGET_PLAYER];
+
+	return;
+}
+
+static void _play(const int i, void *arg, void *result)
+{
+	struct game *g;
+	sim_config cfg;
+	double *score;
+	sim_result res;
+
+	g = (struct game*)arg + i;
+	score = result;
+
+	sim_config_default(&cfg);
+	cfg.seed = g->seed;
+	cfg.players = 2;
+	cfg.max_ticks = _max_ticks;
+	cfg.ai[g->swap] = g->cfg[0];
+	cfg.ai[!g->swap] = g->cfg[1];
+
+	/*
+	 * score of the first configuration: 1 for a win, 0.5 for a draw;
+	 * matches at the tick limit go to the leader, or all candidates would
+	 * score the same
+	 */
+	if(sim_run(&cfg, &res) < 0 || res.leader < 0) {
+		*score = 0.5;
+	} else {
+		*score = res.leader == g->swap ? 1.0 : 0.0;
+	}
+
+	return;
+}
+
+static int _checkpoint_load(struct state *st, const char *path)
+{
+	FILE *fd;
+	int ret_val;
+	int i;
+
+	fd = fopen(path, "r");
+
+	if(!fd) {
+		return(-errno);
+	}
+
+	ret_val = fscanf(fd, "generation %d\nrng %u\nseed %u\nmean",
+					 &(st->generation), &(st->rng), &(st->seed)) == 3 ? 0 : -EINVAL;
+
+	for(i = 0; ret_val == 0 && i < NUM_PARAMS; i++) {
+		if(fscanf(fd, "%lf", &(st->mean[i])) != 1) {
+			ret_val = -EINVAL;
+		}
+	}
+
+	if(ret_val == 0 && fscanf(fd, " sigma") != 0) {
+		ret_val = -EINVAL;
+	}
+
+	for(i = 0; ret_val == 0 && i < NUM_PARAMS; i++) {
+		if(fscanf(fd, "%lf", &(st->sigma[i])) != 1) {
+			ret_val = -EINVAL;
+		}
+	}
+
+	fclose(fd);
+
+	return(ret_val);
+}
+
+static int _checkpoint_save(const struct state *st, const char *path)
+{
+	char tmp[256];
+	FILE *fd;
+	int i;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	fd = fopen(tmp, "w");
+
+	if(!fd) {
+		return(-errno);
+	}
+
+	fprintf(fd, "generation %d\nrng %u\nseed %u\nmean", st->generation,
+			(unsigned)st->rng, st->seed);
+
+	for(i = 0; i < NUM_PARAMS; i++) {
+		fprintf(fd, " %.17g", st->mean[i]);
+	}
+
+	fprintf(fd, "\nsigma");
+
+	for(i = 0; i < NUM_PARAMS; i++) {
+		fprintf(fd, " %.17g", st->sigma[i]);
+	}
+
+	fprintf(fd, "\n");
+
+	if(ferror(fd) | fclose(fd)) {
+		unlink(tmp);
+		return(-EIO);
+	}
+
+	/* never leave a half-written checkpoint behind */
+	return(rename(tmp, path) < 0 ? -errno : 0);
+}
+
+static int _by_fitness(const void *a, const void *b)
+{
+	double fa, fb;
+
+	fa = *(const double*)a;
+	fb = *(const double*)b;
+
+	return(fa < fb ? 1 : fa > fb ? -1 : 0);
+}
+
+/* one generation; returns the score of the current config against the default */
+static double _generation(struct state *st, const int lambda, const int games,
+						  const int probes, const int workers, long *played)
+{
+	static double cand[MAX_LAMBDA][NUM_PARAMS];
+	double fit[MAX_LAMBDA][2];  /* fitness, candidate */
+	double weights[MAX_LAMBDA];
+	double mean[NUM_PARAMS];
+	ai_config incumbent;
+	ai_config def;
+	struct game *g;
+	double *score;
+	double probe, wsum;
+	int njobs, mu;
+	int i, j, k;
+
+	njobs = lambda * games + probes;
+	g = malloc(sizeof(*g) * njobs);
+	score = malloc(sizeof(*score) * njobs);
+
+	if(!g || !score) {
+		fprintf(stderr, "malloc: %s\n", strerror(ENOMEM));
+		exit(1);
+	}
+
+	_to_config(st->mean, &incumbent);
+	ai_config_default(&def);
+
+	for(i = 0; i < lambda; i++) {
+		for(j = 0; j < NUM_PARAMS; j++) {
+			cand[i][j] = _clamp(j, st->mean[j] + st->sigma[j] * _gauss(&(st->rng)));
+		}
+
+		for(k = 0; k < games; k++) {
+			struct game *n;
+
+			n = &(g[i * games + k]);
+			_to_config(cand[i], &(n->cfg[0]));
+			n->cfg[1] = incumbent;
+			n->swap = k & 1;
+			n->seed = st->seed + k / 2;
+		}
+	}
+
+	for(k = 0; k < probes; k++) {
+		struct game *n;
+
+		n = &(g[lambda * games + k]);
+		n->cfg[0] = incumbent;
+		n->cfg[1] = def;
+		n->swap = k & 1;
+		n->seed = st->seed + (games + 1) / 2 + k / 2;
+	}
+
+	i = pool_run(njobs, workers, _play, g, score, sizeof(*score));
+
+	if(i < 0) {
+		fprintf(stderr, "pool_run: %s\n", strerror(-i));
+		exit(1);
+	}
+
+	for(i = 0; i < lambda; i++) {
+		fit[i][0] = 0;
+		fit[i][1] = i;
+
+		for(k = 0; k < games; k++) {
+			fit[i][0] += score[i * games + k];
+		}
+
+		fit[i][0] /= games;
+	}
+
+	for(probe = 0, k = 0; k < probes; k++) {
+		probe += score[lambda * games + k];
+	}
+
+	probe = probes > 0 ? probe / probes : 0.5;
+
+	qsort(fit, lambda, sizeof(fit[0]), _by_fitness);
+
+	/* log-linear weights for the better half */
+	mu = lambda / 2 > 0 ? lambda / 2 : 1;
+
+	for(wsum = 0, i = 0; i < mu; i++) {
+		weights[i] = log(mu + 0.5) - log(i + 1.0);
+		wsum += weights[i];
+	}
+
+	for(j = 0; j < NUM_PARAMS; j++) {
+		double var;
+
+		mean[j] = 0;
+		var = 0;
+
+		for(i = 0; i < mu; i++) {
+			double d;
+
+			d = cand[(int)fit[i][1]][j] - st->mean[j];
+			mean[j] += weights[i] / wsum * cand[(int)fit[i][1]][j];
+			var += weights[i] / wsum * d * d;
+		}
+
+		/* don't let the step size collapse to nothing */
+		st->sigma[j] = (1.0 - SIGMA_SMOOTHING) * st->sigma[j] +
+			SIGMA_SMOOTHING * sqrt(var);
+
+		if(st->sigma[j] < _params[j].sigma / 20.0) {
+			st->sigma[j] = _params[j].sigma / 20.0;
+		}
+	}
+
+	memcpy(st->mean, mean, sizeof(mean));
+	st->seed += (games + 1) / 2 + (probes + 1) / 2;
+	st->generation++;
+
+	*played += njobs;
+
+	free(score);
+	free(g);
+
+	return(probe);
+}
+
+static void _usage(const char *argv0)
+{
+	printf("Usage: %s [options] [start config]\n"
+		   "\n"
+		   "  -n num   generations to run (default: 30)\n"
+		   "  -l num   candidates per generation (default: 16)\n"
+		   "  -g num   games per candidate (default: 8)\n"
+		   "  -p num   games against the default config per generation (default: 8)\n"
+		   "  -j num   worker processes (default: all cores)\n"
+		   "  -s num   seed (default: 1)\n"
+		   "  -t num   tick limit per game (default: %d)\n"
+		   "  -c file  checkpoint, resumed from if it exists (default: tune.ckpt)\n"
+		   "  -o file  where to write the tuned config (default: ai.cfg)\n",
+		   argv0, SIM_DEFAULT_TICKS);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *checkpoint;
+	const char *output;
+	struct state st;
+	ai_config cfg;
+	double start;
+	long played;
+	int generations, lambda, games, probes, workers;
+	unsigned seed;
+	int opt, err;
+	int i;
+
+	checkpoint = "tune.ckpt";
+	output = "ai.cfg";
+	generations = 30;
+	lambda = 16;
+	games = 8;
+	probes = 8;
+	workers = 0;
+	seed = 1;
+
+	while((opt = getopt(argc, argv, "n:l:g:p:j:s:t:c:o:h")) != -1) {
+		switch(opt) {
+		case 'n':
+			generations = atoi(optarg);
+			break;
+
+		case 'l':
+			lambda = atoi(optarg);
+			break;
+
+		case 'g':
+			games = atoi(optarg);
+			break;
+
+		case 'p':
+			probes = atoi(optarg);
+			break;
+
+		case 'j':
+			workers = atoi(optarg);
+			break;
+
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+
+		case 't':
+			_max_ticks = atoi(optarg);
+			break;
+
+		case 'c':
+			checkpoint = optarg;
+			break;
+
+		case 'o':
+			output = optarg;
+			break;
+
+		default:
+			_usage(argv[0]);
+			return(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if(lambda < 2 || lambda > MAX_LAMBDA || games < 1 || probes < 0 ||
+	   _max_ticks < 1 || optind < argc - 1) {
+		_usage(argv[0]);
+		return(1);
+	}
+
+	ai_config_default(&cfg);
+
+	if(optind < argc && ai_config_parse(&cfg, argv[optind]) < 0) {
+		fprintf(stderr, "Invalid configuration: %s\n", argv[optind]);
+		return(1);
+	}
+
+	err = _checkpoint_load(&st, checkpoint);
+
+	if(err == 0) {
+		printf("Resuming from %s at generation %d\n", checkpoint, st.generation);
+	} else if(err == -ENOENT) {
+		st.generation = 0;
+		st.rng = rng_seed(seed);
+		st.seed = seed;
+		_from_config(&cfg, st.mean);
+
+		for(i = 0; i < NUM_PARAMS; i++) {
+			st.sigma[i] = _params[i].sigma;
+		}
+	} else {
+		fprintf(stderr, "%s: %s\n", checkpoint, strerror(-err));
+		return(1);
+	}
+
+	played = 0;
+	start = tool_now();
+
+	printf("%4s %6s", "gen", "vsdef");
+
+	for(i = 0; i < NUM_PARAMS; i++) {
+		printf(" %15s", _params[i].name);
+	}
+
+	printf(" %8s\n", "games/s");
+
+	while(generations-- > 0) {
+		double probe;
+
+		probe = _generation(&st, lambda, games, probes, workers, &played);
+
+		printf("%4d %5.1f%%", st.generation, 100.0 * probe);
+
+		for(i = 0; i < NUM_PARAMS; i++) {
+			printf(" %7.2f (%5.2f)", st.mean[i], st.sigma[i]);
+		}
+
+		printf(" %8.1f\n", played / (tool_now() - start));
+		fflush(stdout);
+
+		_to_config(st.mean, &cfg);
+
+		if((err = _checkpoint_save(&st, checkpoint)) < 0) {
+			fprintf(stderr, "%s: %s\n", checkpoint, strerror(-err));
+			return(1);
+		}
+
+		if((err = ai_config_save(&cfg, output)) < 0) {
+			fprintf(stderr, "%s: %s\n", output, strerror(-err));
+			return(1);
+		}
+	}
+
+	return(0);
+}